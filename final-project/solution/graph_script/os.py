@@ -3,11 +3,17 @@ import matplotlib.pyplot as plt
 from scipy.interpolate import make_interp_spline, BSpline
 import numpy as np
 
-df = pd.read_csv('test.txt', sep=" ", dtype={
-                 'ws_size': 'int64'}, header=None, error_bad_lines=False)
-df.columns = ["sorter", "ws_size"]
+# binary event log of PagingSimulation::workingSetData, see source/event-log.h
+EVENTS = 'working-set.events'
+WORKING_SET = 0
 
-df['ws_size'] = df['ws_size'].astype('int64')
+events = np.fromfile(EVENTS, dtype=np.dtype([('time', '<u8'), ('thread', '<u4'),
+                                              ('type', '<u4'), ('value', '<u8')]))
+names = open(EVENTS + '.names').read().split()
+
+events = events[events['type'] == WORKING_SET]
+df = pd.DataFrame({'sorter': np.array(names)[events['thread']],
+                   'ws_size': events['value'].astype('int64')})
 print(df.head(3))
 
 sorters = [0, 0, 0, 0]
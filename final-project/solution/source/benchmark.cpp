@@ -0,0 +1,337 @@
+/**
+ * microbenchmarks for the hot paths of the paging simulator.
+ * build with "make bench", runs without sanitizers and with optimizations.
+ *
+ * every measurement is one csv line with the following columns:
+ *  -> suite,algorithm,policy,frame_size,frames,workload,op,iterations,ns_per_op,fault_ratio,io_ns_per_op
+ * io_ns_per_op is the simulated disc time of the measured thread, @see disc-model.h
+ *
+ * suites:
+ *  -> access    : VirtualMemory::get/set when every access hits or every access faults.
+ *  -> algorithm : find, recordGet, recordSet and recordNew of each algorithm on a full resident set.
+ *  -> workload  : ns per access of the synthetic workloads, @see workload.h
+ *  -> disc      : one workload under each disc scheduler, the op column names the scheduler.
+ ***/
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "workload.h"
+
+#define FRAME_SIZE_BITS 6
+
+class Benchmark
+{
+public:
+    Benchmark(std::string output);
+    ~Benchmark();
+
+    void access(std::string algorithm, unsigned int frames);
+    void algorithm(std::string algorithm, unsigned int frames);
+    void workload(std::string algorithm, unsigned int frames, Workload &workload);
+    void disc(std::string scheduler, Workload &workload);
+
+    static const std::string ALGORITHM_NAMES[5];
+    static const unsigned int RESIDENT_SIZES[3];
+    static const std::string SCHEDULER_NAMES[4];
+
+private:
+    std::ofstream csv_;
+    volatile int sink_; /* keeps the compiler from dropping the measured reads */
+
+    static char kBench[];
+    static char kFill[];
+    static const char *kDisc;
+
+    void report(std::string suite, std::string algorithm, unsigned int frames, std::string workload,
+                std::string op, unsigned long iterations, double ns, double faultRatio, double ioNs);
+    VirtualMemory *createMemory(std::string algorithm, unsigned int frames);
+    PageReplAlgorithm *createAlgorithm(std::string algorithm, PageTable *table, int *memory, int disc);
+    unsigned int misses(VirtualMemory *memory, char *tName);
+    uint64_t ioTime(VirtualMemory *memory, char *tName);
+};
+
+typedef std::chrono::steady_clock Clock;
+
+const std::string Benchmark::ALGORITHM_NAMES[] = {"NRU", "FIFO", "SC", "LRU", "WSClock"};
+const unsigned int Benchmark::RESIDENT_SIZES[] = {16, 64, 256};
+const std::string Benchmark::SCHEDULER_NAMES[] = {"FCFS", "SSTF", "LOOK", "C-LOOK"};
+
+char Benchmark::kBench[] = "bench";
+char Benchmark::kFill[] = "fill";
+const char *Benchmark::kDisc = "benchmark.dat";
+
+Benchmark::Benchmark(std::string output) : csv_(output), sink_(0)
+{
+    if (!csv_)
+        throw std::logic_error("can't open " + output);
+    csv_ << "suite,algorithm,policy,frame_size,frames,workload,op,iterations,ns_per_op,fault_ratio,io_ns_per_op\n";
+}
+
+Benchmark::~Benchmark()
+{
+    csv_.close();
+    std::remove(kDisc);
+}
+
+void Benchmark::report(std::string suite, std::string algorithm, unsigned int frames, std::string workload,
+                       std::string op, unsigned long iterations, double ns, double faultRatio, double ioNs)
+{
+    csv_ << suite << "," << algorithm << ",global," << (1 << FRAME_SIZE_BITS) << "," << frames << ","
+         << workload << "," << op << "," << iterations << "," << ns / iterations << "," << faultRatio << ","
+         << ioNs / iterations << "\n";
+    std::cerr << suite << " " << algorithm << " " << frames << " " << workload << " " << op << ": "
+              << ns / iterations << " ns" << std::endl;
+}
+
+VirtualMemory *Benchmark::createMemory(std::string algorithm, unsigned int frames)
+{
+    /* four times bigger virtual memory, so a cyclic scan over it faults on every page */
+    return new VirtualMemory(1 << FRAME_SIZE_BITS, frames, frames * 4, algorithm, "global", -1, kDisc);
+}
+
+unsigned int Benchmark::misses(VirtualMemory *memory, char *tName)
+{
+    auto stats = memory->getStats();
+    return stats.count(tName) ? stats.at(tName).page_miss : 0;
+}
+
+uint64_t Benchmark::ioTime(VirtualMemory *memory, char *tName)
+{
+    auto stats = memory->getStats();
+    return stats.count(tName) ? stats.at(tName).io_time : 0;
+}
+
+void Benchmark::access(std::string algorithm, unsigned int frames)
+{
+    const unsigned int frame_size = 1 << FRAME_SIZE_BITS;
+    const unsigned long iterations = 1 << 18;
+    VirtualMemory *memory = createMemory(algorithm, frames);
+    memory->setPartition({kBench});
+
+    /* hits: cycle through the pages that are already resident */
+    for (unsigned int page = 0; page < frames; page++)
+        memory->set(page * frame_size, page, kBench);
+
+    unsigned int before = misses(memory, kBench);
+    uint64_t io_before = ioTime(memory, kBench);
+    auto start = Clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+        sink_ = memory->get((i % frames) * frame_size + (i % frame_size), kBench);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("access", algorithm, frames, "resident", "get_hit", iterations, ns,
+           (double)(misses(memory, kBench) - before) / iterations,
+           ioTime(memory, kBench) - io_before);
+
+    before = misses(memory, kBench);
+    io_before = ioTime(memory, kBench);
+    start = Clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+        memory->set((i % frames) * frame_size + (i % frame_size), i, kBench);
+    ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("access", algorithm, frames, "resident", "set_hit", iterations, ns,
+           (double)(misses(memory, kBench) - before) / iterations,
+           ioTime(memory, kBench) - io_before);
+
+    /* faults: cycle through all virtual pages, one access per page */
+    const unsigned long fault_iterations = 1 << 14;
+    before = misses(memory, kBench);
+    io_before = ioTime(memory, kBench);
+    start = Clock::now();
+    for (unsigned long i = 0; i < fault_iterations; i++)
+        sink_ = memory->get((i % (frames * 4)) * frame_size, kBench);
+    ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("access", algorithm, frames, "cyclic", "get_fault", fault_iterations, ns,
+           (double)(misses(memory, kBench) - before) / fault_iterations,
+           ioTime(memory, kBench) - io_before);
+
+    before = misses(memory, kBench);
+    io_before = ioTime(memory, kBench);
+    start = Clock::now();
+    for (unsigned long i = 0; i < fault_iterations; i++)
+        memory->set((i % (frames * 4)) * frame_size, i, kBench);
+    ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("access", algorithm, frames, "cyclic", "set_fault", fault_iterations, ns,
+           (double)(misses(memory, kBench) - before) / fault_iterations,
+           ioTime(memory, kBench) - io_before);
+
+    memory->resetPartition();
+    delete memory;
+}
+
+PageReplAlgorithm *Benchmark::createAlgorithm(std::string algorithm, PageTable *table, int *memory, int disc)
+{
+    if (algorithm == "NRU")
+        return new NRU(table, memory, disc, false);
+    else if (algorithm == "FIFO")
+        return new FIFO(table, memory, disc, false);
+    else if (algorithm == "SC")
+        return new SC(table, memory, disc, false);
+    else if (algorithm == "LRU")
+        return new LRU(table, memory, disc, false);
+    else if (algorithm == "WSClock")
+        return new WSClock(table, memory, disc, false);
+    throw std::logic_error("no such algorithm!");
+}
+
+void Benchmark::algorithm(std::string algorithm, unsigned int frames)
+{
+    const unsigned int frame_size = 1 << FRAME_SIZE_BITS;
+    const unsigned long iterations = 1 << 16;
+
+    /* the algorithm alone, without the virtual memory around it */
+    PageTable table(frame_size, frames, frames * 4);
+    int *memory = new int[frame_size * frames]();
+    int disc = open(kDisc, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (disc < 0)
+        throw std::logic_error("can't open " + std::string(kDisc));
+    PageReplAlgorithm *repl = createAlgorithm(algorithm, &table, memory, disc);
+    repl->addWorkingSet(kBench, 0, frames);
+
+    /* fill the resident set */
+    for (unsigned int page = 0; page < frames; page++)
+    {
+        table.set(page * frame_size, page);
+        repl->recordNew(page * frame_size);
+        repl->recordGet(page * frame_size, kBench);
+    }
+
+    auto start = Clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+        repl->recordGet((i % frames) * frame_size, kBench);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("algorithm", algorithm, frames, "resident", "recordGet", iterations, ns, 0, 0);
+
+    start = Clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+        repl->recordSet((i % frames) * frame_size, kBench);
+    ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("algorithm", algorithm, frames, "resident", "recordSet", iterations, ns, 0, 0);
+
+    /* find takes the victim out of the algorithm and recordNew puts a page in, so they are measured in
+       rounds: half of the resident set is evicted with find, then mapped back with recordNew */
+    const unsigned int round = frames / 2;
+    std::vector<address_t> victims(round);
+    double find_ns = 0, new_ns = 0;
+    for (unsigned long i = 0; i < iterations; i += round)
+    {
+        start = Clock::now();
+        for (unsigned int j = 0; j < round; j++)
+            victims[j] = repl->find();
+        auto middle = Clock::now();
+        for (unsigned int j = 0; j < round; j++)
+            repl->recordNew(victims[j] * frame_size);
+        auto end = Clock::now();
+
+        find_ns += std::chrono::duration<double, std::nano>(middle - start).count();
+        new_ns += std::chrono::duration<double, std::nano>(end - middle).count();
+
+        /* referenced again, like the access after a fault */
+        for (unsigned int j = 0; j < round; j++)
+            repl->recordGet(victims[j] * frame_size, kBench);
+    }
+    report("algorithm", algorithm, frames, "resident", "find", iterations, find_ns, 0, 0);
+    report("algorithm", algorithm, frames, "resident", "recordNew", iterations, new_ns, 0, 0);
+
+    delete repl;
+    delete[] memory;
+    close(disc);
+}
+
+void Benchmark::workload(std::string algorithm, unsigned int frames, Workload &workload)
+{
+    VirtualMemory *memory = createMemory(algorithm, frames);
+    unsigned int virtual_size = (1 << FRAME_SIZE_BITS) * frames * 4;
+
+    memory->setPartition({kFill});
+    memory->fill(kFill);
+    memory->resetPartition();
+
+    memory->setPartition({workload.getName()});
+    workload.bind(memory, nullptr, 0, virtual_size);
+
+    auto start = Clock::now();
+    workload.run();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("workload", algorithm, frames, workload.getName(), "access", workload.getAccessCount(), ns,
+           (double)misses(memory, workload.getName()) / workload.getAccessCount(),
+           ioTime(memory, workload.getName()));
+
+    memory->resetPartition();
+    delete memory;
+}
+
+void Benchmark::disc(std::string scheduler, Workload &workload)
+{
+    const unsigned int frames = 64;
+    VirtualMemory *memory = createMemory("LRU", frames);
+    memory->setDiscScheduler(scheduler);
+    unsigned int virtual_size = (1 << FRAME_SIZE_BITS) * frames * 4;
+
+    memory->setPartition({kFill});
+    memory->fill(kFill);
+    memory->resetPartition();
+
+    memory->setPartition({workload.getName()});
+    workload.bind(memory, nullptr, 0, virtual_size);
+
+    auto start = Clock::now();
+    workload.run();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    report("disc", "LRU", frames, workload.getName(), scheduler, workload.getAccessCount(), ns,
+           (double)misses(memory, workload.getName()) / workload.getAccessCount(),
+           ioTime(memory, workload.getName()));
+
+    memory->resetPartition();
+    delete memory;
+}
+
+int main(int argc, char const *argv[])
+{
+    try
+    {
+        Benchmark benchmark(argc > 1 ? argv[1] : "benchmark.csv");
+
+        for (auto &algorithm : Benchmark::ALGORITHM_NAMES)
+            for (auto &frames : Benchmark::RESIDENT_SIZES)
+            {
+                benchmark.access(algorithm, frames);
+                benchmark.algorithm(algorithm, frames);
+
+                unsigned int physical_size = (1 << FRAME_SIZE_BITS) * frames;
+                unsigned int virtual_size = physical_size * 4;
+                unsigned int n = std::min<unsigned int>(std::sqrt(virtual_size / 3), 48);
+
+                SequentialScan scan("scan", 2);
+                StridedScan stride("stride", (1 << FRAME_SIZE_BITS) + 1, virtual_size);
+                UniformRandom uniform("uniform", virtual_size, 0.3);
+                Zipfian zipf("zipf", virtual_size);
+                LoopingWorkingSet loop("loop", physical_size + physical_size / 2, 4);
+                PhaseChange phase("phase", 8, virtual_size / 8, physical_size / 2);
+                MatrixMultiply naive("matrix_naive", n);
+                MatrixMultiply tiled("matrix_tiled", n, 8);
+                HashJoin join("hash_join", virtual_size / 8, virtual_size / 4);
+
+                for (Workload *w : std::vector<Workload *>{&scan, &stride, &uniform, &zipf, &loop, &phase, &naive, &tiled, &join})
+                    benchmark.workload(algorithm, frames, *w);
+            }
+
+        /* random writes keep the write-behind queue full, so the schedulers have something to order */
+        for (auto &scheduler : Benchmark::SCHEDULER_NAMES)
+        {
+            const unsigned int virtual_size = (1 << FRAME_SIZE_BITS) * 64 * 4;
+            UniformRandom uniform("uniform", virtual_size, 0.5);
+            benchmark.disc(scheduler, uniform);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * fixed size vector of bits, one bit per frame of the physical memory. @see PageTable
+ * the words are aligned to and padded up to a whole vector register, so the bulk operations run over
+ * full registers without a scalar tail:
+ *  -> AVX2  : 4 words at a time, build with -mavx2 (make avx2).
+ *  -> SSE2  : 2 words at a time, the baseline of x86-64. the counts need SSSE3 for the table lookup,
+ *             build with -mssse3 (make ssse3), plain SSE2 counts one word at a time.
+ *  -> other : one word at a time.
+ ***/
+
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+class BitVector
+{
+public:
+    explicit BitVector(size_t bits);
+    ~BitVector();
+
+    BitVector(const BitVector &) = delete;
+    BitVector &operator=(const BitVector &) = delete;
+
+    size_t size() const;
+    bool test(size_t) const;
+    void set(size_t);
+    void reset(size_t);
+    void assign(size_t, bool);
+
+    /* bulk operations, vectorized */
+    void clear();
+    size_t count(size_t from, size_t to) const;     /* set bits in [from, to) */
+    size_t findFirst(size_t from, size_t to) const; /* first set bit in [from, to), to if there is none */
+
+    /* word i keeps the bits [64 * i, 64 * i + 64), the bits after size() are zero */
+    uint64_t word(size_t index) const;
+    static uint64_t rangeMask(size_t index, size_t from, size_t to); /* bits of word index in [from, to) */
+    static unsigned int popcount(uint64_t);
+    static unsigned int select(uint64_t word, unsigned int n); /* position of the nth set bit, n from 0 */
+
+    static const size_t kWordBits;
+
+private:
+    size_t bits_;
+    size_t count_; /* words, a multiple of kBlockWords */
+    uint64_t *words_;
+
+    static const size_t kBlockWords; /* words in a vector register */
+
+    size_t countWords(size_t from, size_t to) const; /* whole words */
+    size_t skipZeroWords(size_t from, size_t to) const;
+};
+
+const size_t BitVector::kWordBits = 64;
+#if defined(__AVX2__)
+const size_t BitVector::kBlockWords = 4;
+#elif defined(__SSE2__)
+const size_t BitVector::kBlockWords = 2;
+#else
+const size_t BitVector::kBlockWords = 1;
+#endif
+
+BitVector::BitVector(size_t bits) : bits_(bits)
+{
+    count_ = (bits + kWordBits * kBlockWords - 1) / (kWordBits * kBlockWords) * kBlockWords;
+    if (count_ == 0)
+        count_ = kBlockWords;
+
+    void *raw = nullptr;
+    if (posix_memalign(&raw, kBlockWords * sizeof(uint64_t), count_ * sizeof(uint64_t)) != 0)
+        throw std::bad_alloc();
+    words_ = (uint64_t *)raw;
+    memset(words_, 0, count_ * sizeof(uint64_t));
+}
+
+BitVector::~BitVector()
+{
+    free(words_);
+}
+
+size_t BitVector::size() const
+{
+    return bits_;
+}
+
+bool BitVector::test(size_t bit) const
+{
+    return (words_[bit / kWordBits] >> (bit % kWordBits)) & 1;
+}
+
+void BitVector::set(size_t bit)
+{
+    words_[bit / kWordBits] |= (uint64_t)1 << (bit % kWordBits);
+}
+
+void BitVector::reset(size_t bit)
+{
+    words_[bit / kWordBits] &= ~((uint64_t)1 << (bit % kWordBits));
+}
+
+void BitVector::assign(size_t bit, bool value)
+{
+    if (value)
+        set(bit);
+    else
+        reset(bit);
+}
+
+uint64_t BitVector::word(size_t index) const
+{
+    return words_[index];
+}
+
+uint64_t BitVector::rangeMask(size_t index, size_t from, size_t to)
+{
+    size_t first = index * kWordBits, last = first + kWordBits;
+    if (to <= first || last <= from)
+        return 0;
+    uint64_t mask = ~(uint64_t)0;
+    if (from > first)
+        mask &= mask << (from - first);
+    if (to < last)
+        mask &= ((uint64_t)1 << (to - first)) - 1;
+    return mask;
+}
+
+unsigned int BitVector::popcount(uint64_t word)
+{
+    return __builtin_popcountll(word);
+}
+
+unsigned int BitVector::select(uint64_t word, unsigned int n)
+{
+#if defined(__BMI2__)
+    return __builtin_ctzll(_pdep_u64((uint64_t)1 << n, word));
+#else
+    for (unsigned int i = 0; i < n; i++)
+        word &= word - 1; /* drops the lowest set bit */
+    return __builtin_ctzll(word);
+#endif
+}
+
+void BitVector::clear()
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (size_t i = 0; i < count_; i += kBlockWords)
+        _mm256_store_si256((__m256i *)(words_ + i), zero);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t i = 0; i < count_; i += kBlockWords)
+        _mm_store_si128((__m128i *)(words_ + i), zero);
+#else
+    memset(words_, 0, count_ * sizeof(uint64_t));
+#endif
+}
+
+size_t BitVector::count(size_t from, size_t to) const
+{
+    if (from >= to)
+        return 0;
+    size_t first = from / kWordBits, last = (to - 1) / kWordBits;
+    if (first == last)
+        return popcount(words_[first] & rangeMask(first, from, to));
+    return popcount(words_[first] & rangeMask(first, from, to)) + countWords(first + 1, last) +
+           popcount(words_[last] & rangeMask(last, from, to));
+}
+
+size_t BitVector::countWords(size_t from, size_t to) const
+{
+    size_t total = 0;
+    size_t i = from;
+    for (; i < to && i % kBlockWords != 0; i++)
+        total += popcount(words_[i]);
+
+#if defined(__AVX2__)
+    /* popcount of every nibble by a table lookup, summed up per 64 bits */
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    for (; i + kBlockWords <= to; i += kBlockWords)
+    {
+        __m256i v = _mm256_load_si256((const __m256i *)(words_ + i));
+        __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+                                         _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, sums);
+    total += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSSE3__)
+    /* the same with half the register */
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    __m128i sums = _mm_setzero_si128();
+    for (; i + kBlockWords <= to; i += kBlockWords)
+    {
+        __m128i v = _mm_load_si128((const __m128i *)(words_ + i));
+        __m128i counts = _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(v, low)),
+                                      _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(counts, _mm_setzero_si128()));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, sums);
+    total += lanes[0] + lanes[1];
+#endif
+
+    for (; i < to; i++)
+        total += popcount(words_[i]);
+    return total;
+}
+
+size_t BitVector::findFirst(size_t from, size_t to) const
+{
+    if (from >= to)
+        return to;
+    size_t last = (to - 1) / kWordBits;
+    for (size_t i = from / kWordBits; i <= last;)
+    {
+        uint64_t bits = words_[i] & rangeMask(i, from, to);
+        if (bits != 0)
+            return i * kWordBits + __builtin_ctzll(bits);
+        i = skipZeroWords(i + 1, last + 1);
+    }
+    return to;
+}
+
+size_t BitVector::skipZeroWords(size_t from, size_t to) const
+{
+    size_t i = from;
+    if (i % kBlockWords != 0)
+        return i;
+
+#if defined(__AVX2__)
+    for (; i + kBlockWords <= to; i += kBlockWords)
+    {
+        __m256i v = _mm256_load_si256((const __m256i *)(words_ + i));
+        if (!_mm256_testz_si256(v, v))
+            break;
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + kBlockWords <= to; i += kBlockWords)
+    {
+        __m128i v = _mm_load_si128((const __m128i *)(words_ + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xffff)
+            break;
+    }
+#else
+    while (i < to && words_[i] == 0)
+        i++;
+#endif
+    return i;
+}
+
+#endif
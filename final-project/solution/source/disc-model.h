@@ -0,0 +1,223 @@
+/**
+ * timing model of the disc of the simulation.
+ * only accounts time, the pages themselves are still read and written through the disc file at once.
+ * every swap slot is one sector, the slots are laid out in order kSlotsPerTrack on a track and one track
+ * on a cylinder. a request costs the seek of the head to its cylinder, the rotation until its sector is
+ * under the head and the transfer of one sector, on a clock of its own that only advances while the disc works.
+ *
+ * writes are write-behind: they are queued and the writer goes on, unless the queue is full.
+ * a read waits until the scheduler has served it, with every queued write the scheduler picks before it.
+ * the returned times are the simulated nanoseconds the caller waits for the disc.
+ * the threads may call it without the memory lock, the model has a lock of its own.
+ * @see PageReplAlgorithm::readFrame()
+ ***/
+
+#ifndef DISC_MODEL_H
+#define DISC_MODEL_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+
+enum class DiscScheduler
+{
+    FCFS,  /* in order of arrival */
+    SSTF,  /* shortest seek first */
+    LOOK,  /* elevator, sweeps up and down, turns at the last request */
+    CLOOK, /* sweeps up only, then jumps back to the lowest request */
+};
+
+class DiscModel
+{
+public:
+    DiscModel(std::string scheduler = "FCFS", unsigned int queueDepth = 8);
+
+    uint64_t read(uint64_t slot);
+    uint64_t write(uint64_t slot);
+
+    static DiscScheduler parseScheduler(std::string);
+
+    /* geometry and timing of a 7200 rpm disc */
+    static const uint64_t kSlotsPerTrack;
+    static const uint64_t kRotationNs;
+    static const uint64_t kSeekSettleNs;      /* any seek of at least one cylinder */
+    static const uint64_t kSeekPerCylinderNs; /* plus this for every cylinder crossed */
+    static const uint64_t kFullStrokeNs;      /* but never more than this */
+
+private:
+    struct Request
+    {
+        uint64_t slot;
+        bool read;
+    };
+
+    DiscScheduler scheduler_;
+    unsigned int queue_depth_;
+    std::vector<Request> queue_; /* in order of arrival */
+    uint64_t head_;              /* cylinder under the head */
+    bool upward_;                /* sweep direction of LOOK */
+    uint64_t clock_;
+    std::mutex mutex_;
+
+    static uint64_t cylinderOf(uint64_t slot);
+    size_t pick();
+    uint64_t service(size_t index);
+};
+
+const uint64_t DiscModel::kSlotsPerTrack = 64;
+const uint64_t DiscModel::kRotationNs = 8333333;
+const uint64_t DiscModel::kSeekSettleNs = 500000;
+const uint64_t DiscModel::kSeekPerCylinderNs = 10000;
+const uint64_t DiscModel::kFullStrokeNs = 15000000;
+
+DiscModel::DiscModel(std::string scheduler, unsigned int queueDepth)
+    : scheduler_(parseScheduler(scheduler)),
+      queue_depth_(queueDepth),
+      head_(0),
+      upward_(true),
+      clock_(0)
+{
+    if (queue_depth_ == 0)
+        throw std::invalid_argument("disc queue needs at least one request!");
+}
+
+DiscScheduler DiscModel::parseScheduler(std::string name)
+{
+    if (name == "FCFS")
+        return DiscScheduler::FCFS;
+    else if (name == "SSTF")
+        return DiscScheduler::SSTF;
+    else if (name == "LOOK")
+        return DiscScheduler::LOOK;
+    else if (name == "C-LOOK")
+        return DiscScheduler::CLOOK;
+    throw std::invalid_argument("no such disc scheduler!");
+}
+
+uint64_t DiscModel::cylinderOf(uint64_t slot)
+{
+    return slot / kSlotsPerTrack;
+}
+
+uint64_t DiscModel::read(uint64_t slot)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    /* the latest data of the slot is still in the queue, no need for the disc */
+    for (auto &request : queue_)
+        if (request.slot == slot && !request.read)
+            return 0;
+
+    queue_.push_back({slot, true});
+    uint64_t waited = 0;
+    while (true)
+    {
+        size_t index = pick();
+        bool done = queue_[index].read;
+        waited += service(index);
+        if (done) /* a read is queued only while its caller waits, so it is this one */
+            return waited;
+    }
+}
+
+uint64_t DiscModel::write(uint64_t slot)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    /* an older write of the same slot is overwritten in the queue */
+    for (auto &request : queue_)
+        if (request.slot == slot)
+            return 0;
+
+    queue_.push_back({slot, false});
+    if (queue_.size() <= queue_depth_)
+        return 0;
+    return service(pick()); /* full, the writer waits for one request */
+}
+
+size_t DiscModel::pick()
+{
+    size_t best = 0;
+    switch (scheduler_)
+    {
+    case DiscScheduler::FCFS:
+        return 0;
+
+    case DiscScheduler::SSTF:
+        for (size_t i = 1; i < queue_.size(); i++)
+        {
+            uint64_t cylinder = cylinderOf(queue_[i].slot), best_cylinder = cylinderOf(queue_[best].slot);
+            uint64_t distance = cylinder > head_ ? cylinder - head_ : head_ - cylinder;
+            uint64_t best_distance = best_cylinder > head_ ? best_cylinder - head_ : head_ - best_cylinder;
+            if (distance < best_distance) /* the older one on ties */
+                best = i;
+        }
+        return best;
+
+    case DiscScheduler::LOOK:
+        for (int turn = 0; turn < 2; turn++)
+        {
+            bool found = false;
+            for (size_t i = 0; i < queue_.size(); i++)
+            {
+                uint64_t cylinder = cylinderOf(queue_[i].slot);
+                if (upward_ ? cylinder < head_ : cylinder > head_) /* behind the head */
+                    continue;
+                if (!found || (upward_ ? cylinder < cylinderOf(queue_[best].slot)
+                                       : cylinder > cylinderOf(queue_[best].slot)))
+                    best = i;
+                found = true;
+            }
+            if (found)
+                return best;
+            upward_ = !upward_; /* nothing ahead, turn around */
+        }
+        return best;
+
+    case DiscScheduler::CLOOK:
+    {
+        bool ahead = false;
+        for (size_t i = 0; i < queue_.size(); i++)
+        {
+            uint64_t cylinder = cylinderOf(queue_[i].slot);
+            bool is_ahead = cylinder >= head_;
+            /* the nearest one ahead of the head, the lowest one if there is none */
+            if ((is_ahead && !ahead) || (is_ahead == ahead && cylinder < cylinderOf(queue_[best].slot)))
+                best = i;
+            ahead = ahead || is_ahead;
+        }
+        return best;
+    }
+    }
+    return best;
+}
+
+uint64_t DiscModel::service(size_t index)
+{
+    uint64_t slot = queue_[index].slot;
+    queue_.erase(queue_.begin() + index);
+
+    uint64_t start = clock_;
+    uint64_t cylinder = cylinderOf(slot);
+    if (cylinder != head_)
+    {
+        uint64_t distance = cylinder > head_ ? cylinder - head_ : head_ - cylinder;
+        if (distance >= (kFullStrokeNs - kSeekSettleNs) / kSeekPerCylinderNs) /* spare slots are far away */
+            clock_ += kFullStrokeNs;
+        else
+            clock_ += kSeekSettleNs + distance * kSeekPerCylinderNs;
+        head_ = cylinder;
+    }
+
+    /* wait for the sector, then read or write it */
+    uint64_t sector_ns = kRotationNs / kSlotsPerTrack;
+    uint64_t angle = clock_ % kRotationNs;
+    uint64_t target = (slot % kSlotsPerTrack) * sector_ns;
+    clock_ += (target + kRotationNs - angle) % kRotationNs;
+    clock_ += sector_ns;
+    return clock_ - start;
+}
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * binary event log of the simulation.
+ * threads append fixed size records into a ring buffer without locking and a background thread drains the
+ * ring into a file. a thread takes the lock of the names only the first time it records under a name buffer. if the ring is full the event is dropped and counted, the simulation never waits for disc.
+ *
+ * file:
+ *  -> one event after another, in host byte order.
+ *  -> [time | thread | type | value]
+ *  -> [8byte + 4byte + 4byte + 8byte] = 24 bytes.
+ *
+ *  time   : nanoseconds since the log is created.
+ *  thread : line number (from zero) of the tName in "<file>.names", that file is written when the log is closed.
+ *  type   : EventType.
+ *  value  : working set size for WORKING_SET, page key for the others (process above the page number).
+ * @see graph_script/os.py
+ ***/
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <stdexcept>
+#include <stdint.h>
+
+enum class EventType : uint32_t
+{
+    WORKING_SET = 0,
+    FAULT_FREE_FRAME = 1,
+    FAULT_CLEAN = 2, /* the faulting page evicted a not modified page */
+    FAULT_DIRTY = 3, /* the faulting page evicted a modified page */
+    EVICTION = 4,    /* value is the evicted page */
+};
+
+class EventLog
+{
+public:
+    /* capacity is rounded up to a power of two */
+    EventLog(std::string file, unsigned int samplePeriod = 1, size_t capacity = 1 << 16);
+    ~EventLog();
+
+    EventLog(const EventLog &) = delete;
+    EventLog &operator=(const EventLog &) = delete;
+
+    /* true once every sample_period calls, used for the per access events */
+    bool sample();
+    void record(EventType type, const char *tName, uint64_t value);
+
+    /* stops the drain thread, writes the rest of the ring and the names. called by the destructor too. */
+    void close();
+    uint64_t getDropped() const;
+
+    struct Event
+    {
+        uint64_t time;
+        uint32_t thread;
+        uint32_t type;
+        uint64_t value;
+    };
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence; /* position of the slot, +1 when it holds an event */
+        Event event;
+    };
+
+    Slot *ring_;
+    uint64_t mask_;
+    std::atomic<uint64_t> head_; /* next position to write, shared by producers */
+    uint64_t tail_;              /* next position to read, only the drain thread uses it */
+
+    unsigned int sample_period_;
+    std::atomic<uint64_t> sample_count_;
+    std::atomic<uint64_t> dropped_;
+
+    std::string file_;
+    std::ofstream out_;
+    std::thread drainer_;
+    std::atomic<bool> running_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex names_mutex_; /* for a new name and for the names file */
+    std::map<std::string, uint32_t> names_;
+    unsigned long id_;
+
+    struct NameCache
+    {
+        unsigned long owner;
+        const char *name; /* the buffer of the name, compared by address only */
+        uint32_t thread;
+    };
+    static std::atomic<unsigned long> next_id_;
+    static thread_local NameCache name_cache_; /* the last name this thread recorded under */
+
+    uint32_t threadId(const char *tName);
+    bool push(const Event &);
+    bool pop(Event &);
+    void drain();
+};
+
+std::atomic<unsigned long> EventLog::next_id_(1);
+thread_local EventLog::NameCache EventLog::name_cache_ = {0, nullptr, 0};
+
+EventLog::EventLog(std::string file, unsigned int samplePeriod, size_t capacity)
+    : head_(0),
+      tail_(0),
+      sample_period_(samplePeriod),
+      sample_count_(0),
+      dropped_(0),
+      file_(file),
+      running_(true),
+      start_(std::chrono::steady_clock::now()),
+      id_(next_id_++)
+{
+    static_assert(sizeof(Event) == 24, "event record must be 24 bytes");
+    if (sample_period_ == 0)
+        throw std::invalid_argument("sample period can't be zero!");
+
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    mask_ = size - 1;
+    ring_ = new Slot[size];
+    for (size_t i = 0; i < size; i++)
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+
+    out_.open(file_, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out_)
+        throw std::logic_error("can't open event log " + file_);
+    drainer_ = std::thread(&EventLog::drain, this);
+}
+
+EventLog::~EventLog()
+{
+    close();
+    delete[] ring_;
+}
+
+bool EventLog::sample()
+{
+    return sample_count_.fetch_add(1, std::memory_order_relaxed) % sample_period_ == 0;
+}
+
+uint32_t EventLog::threadId(const char *tName)
+{
+    /* fast path, the thread keeps passing the same name: no string is built and no lock is taken */
+    if (name_cache_.owner == id_ && name_cache_.name == tName)
+        return name_cache_.thread;
+
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    auto it = names_.insert({tName, (uint32_t)names_.size()}).first;
+    name_cache_ = NameCache{id_, tName, it->second};
+    return it->second;
+}
+
+void EventLog::record(EventType type, const char *tName, uint64_t value)
+{
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+    Event event{(uint64_t)time.count(), threadId(tName), (uint32_t)type, value};
+    if (!push(event))
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool EventLog::push(const Event &event)
+{
+    uint64_t position = head_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true)
+    {
+        slot = &ring_[position & mask_];
+        int64_t diff = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)position;
+        if (diff == 0)
+        {
+            if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) /* the slot is not drained yet, ring is full */
+            return false;
+        else
+            position = head_.load(std::memory_order_relaxed);
+    }
+
+    slot->event = event;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool EventLog::pop(Event &event)
+{
+    Slot &slot = ring_[tail_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1)
+        return false;
+
+    event = slot.event;
+    slot.sequence.store(tail_ + mask_ + 1, std::memory_order_release); /* free for the next round */
+    tail_++;
+    return true;
+}
+
+void EventLog::drain()
+{
+    std::vector<Event> batch;
+    batch.reserve(mask_ + 1);
+
+    while (true)
+    {
+        bool running = running_.load(std::memory_order_acquire);
+        Event event;
+        while (pop(event))
+            batch.push_back(event);
+
+        if (!batch.empty())
+        {
+            out_.write((char *)batch.data(), batch.size() * sizeof(Event));
+            batch.clear();
+        }
+        else if (!running)
+            break; /* the ring is empty after the stop request */
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void EventLog::close()
+{
+    if (!running_.exchange(false))
+        return;
+    drainer_.join();
+    out_.close();
+
+    /* names in the order of their ids */
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    std::vector<std::string> names(names_.size());
+    for (auto &name : names_)
+        names[name.second] = name.first;
+
+    std::ofstream names_out(file_ + ".names", std::ios::out | std::ios::trunc);
+    for (auto &name : names)
+        names_out << name << "\n";
+    names_out.close();
+}
+
+uint64_t EventLog::getDropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+#endif
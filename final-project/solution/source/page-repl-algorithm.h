@@ -7,8 +7,10 @@
 #define PAGE_REPL_ALGORITHM_H
 
 #include "page-table.h"
+#include "stats.h"
+#include "disc-model.h"
+#include "snapshot.h"
 #include <cmath>
-#include <fstream>
 #include <vector>
 #include <queue>
 #include <map>
@@ -17,73 +19,155 @@
 #include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <utility>
+#include <unistd.h>
 
 class PageReplAlgorithm
 {
 public:
-    PageReplAlgorithm(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
-    virtual ~PageReplAlgorithm();
+    friend class Benchmark; /* measures find() directly, @see benchmark.cpp */
 
-    void replace(unsigned int);
-    virtual void recordGet(unsigned int, std::string);
-    virtual void recordSet(unsigned int, std::string);
-    virtual void recordNew(unsigned int);
+    PageReplAlgorithm(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
+    virtual ~PageReplAlgorithm();
 
-    /* will only be implement for LRU to satisfy to bonus part */
-    virtual void workingSetSize() const {};
+    FaultType replace(address_t, address_t *victim = nullptr);
+    /* empties a frame for the caller: the victim and the sharers of its frame are unmapped.
+       a huge victim is demoted first and only its head page is evicted.
+       with writeBack, a modified victim is not written but its slot is given back, kNoPage if it is clean */
+    address_t evict(FaultType *type, address_t *victim = nullptr, address_t *writeBack = nullptr);
+    /* the name is known by its buffer, a thread passes the same one every time, @see enter() */
+    virtual void recordGet(address_t, const char *tName);
+    virtual void recordSet(address_t, const char *tName);
+    virtual void recordNew(address_t);
+
+    /* will only be implement for LRU to satisfy to bonus part, 0 if the algorithm doesn't keep it */
+    virtual unsigned int workingSetSize() const { return 0; };
+    virtual unsigned int workingSetSize(const std::string &) const { return 0; }; /* of the given thread */
+    /* pages in the frames of the partition of the thread, in the whole memory if global. a huge page once */
+    address_t residentPages(const std::string &tName) const;
 
     struct Stats /* keeps the count for each field */
     {
-        unsigned int read;
-        unsigned int write;
-        unsigned int page_miss;
-        unsigned int page_repl;
-        unsigned int disc_read;
-        unsigned int disc_write;
+        unsigned long read;
+        unsigned long write;
+        unsigned long page_miss;
+        unsigned long page_repl;
+        unsigned long disc_read;
+        unsigned long disc_write;
+        unsigned long tlb_hit;
+        unsigned long tlb_miss;
+        unsigned long huge_fault;
+        unsigned long promotion;
+        unsigned long demotion;
+        uint64_t io_time; /* simulated ns */
+        Histogram fault_latency[FAULT_TYPES]; /* fault service times, indexed by FaultType */
+
+        uint64_t faultLatency(double percentile) const; /* over all fault types */
     };
     void printStats() const;
-    const std::map<std::string, Stats> &getStats() const;
+    std::map<std::string, Stats> getStats() const;
+    void recordFault(FaultType, uint64_t ns);
+    void recordTlb(bool hit);
+    void recordPromotion();
 
     struct LocalReplacementInfo
     {
     public:
-        unsigned int lower_bound_, upper_bound_, local_free_index_;
+        address_t lower_bound_, upper_bound_, local_free_index_;
     };
 
-    virtual void addWorkingSet(std::string, unsigned int, unsigned int);
+    virtual void addWorkingSet(std::string, address_t, address_t);
     virtual void delWorkingSets();
-    int findIndex(std::string);
-    void writeFrame(unsigned int, unsigned int);
-    void readFrame(unsigned int);
+    address_t findIndex(const char *tName); /* kNoFrame if there is no free frame left */
+    /* count free frames aligned to count at once for a huge page, kNoFrame if the next free frame is not aligned */
+    address_t findBlock(const char *tName, address_t count);
+    bool canUse(address_t frame) const; /* in the working set of the current thread, always true if global */
+    void writeFrame(address_t, address_t);
+    void readFrame(address_t);
+    /* the disc io alone, without the page table. safe without the memory lock, the stats go to tName */
+    void writeSlot(address_t slot, address_t frame, const char *tName);
+    void readSlot(address_t slot, address_t frame, const char *tName);
+    /* maps a page read in by readSlot() into its frame, like replace() does */
+    void map(address_t index, address_t frame, const char *tName);
+    /* times the disc accesses of the threads, not owned. null turns it off */
+    void setDiscModel(DiscModel *);
+
+    /* snapshot of the free indices, the working sets and the structures of the algorithm.
+       load needs an algorithm of the same kind over the loaded page table. @see VirtualMemory::checkpoint() */
+    virtual void save(SnapshotWriter &) const;
+    virtual void load(SnapshotReader &);
+    /* the counters of every tName, loaded ones are added to the current ones */
+    void saveStats(SnapshotWriter &) const;
+    void loadStats(SnapshotReader &);
+
+    static const address_t kNoFrame;
 
 protected:
-    virtual unsigned int find() = 0;
+    virtual address_t find() = 0;
     PageTable *page_table_;
     int *memory_;
-    std::fstream *disc_;
+    int disc_; /* file descriptor, pread and pwrite need no lock */
+    DiscModel *disc_model_;
     bool local_;
-    std::string current_thread_;
-    std::string current_stat_;
-    unsigned int global_free_index_;
+    const std::string *current_thread_; /* name of the caller, kGlobal for the lists of a global policy */
+    StatBlock *current_block_;          /* counters of the caller */
+    address_t global_free_index_;
 
     /* pages are stored for local page replacement */
     std::map<std::string, LocalReplacementInfo> *threads_working_set_;
-    std::map<std::string, Stats> stats_;
 
-    bool inWorkingSet(unsigned int) const;
+    bool inWorkingSet(address_t) const;
+    /* the page may still be listed by a thread that read it through a shared frame of another thread */
+    bool isCandidate(address_t page) const;
+
+    /* the caller becomes the current thread, its name and counters are resolved once per thread */
+    void enter(const char *tName);
+    /* counters of the current thread, @see stats.h */
+    StatBlock &stat();
+
+    static const std::string kGlobal;
+
+private:
+    struct StatCache
+    {
+        unsigned long owner;
+        const char *name; /* the buffer of the name, compared by address only */
+        StatBlock *block;
+        const std::string *key; /* the name in stat_names_, which never drops a name */
+    };
+
+    /* the block of the calling thread for the name, without the current thread of the algorithm */
+    StatBlock &stat(const char *tName);
+    StatBlock &stat(const std::string &name); /* always by the maps */
+    void writeSlot(address_t slot, address_t frame, StatBlock &);
+    void readSlot(address_t slot, address_t frame, StatBlock &);
+
+    std::map<std::pair<std::thread::id, std::string>, StatBlock *> stat_blocks_;
+    std::map<std::string, std::vector<StatBlock *>> stat_names_;
+    mutable std::mutex stat_mutex_; /* guards the two maps above, the counters are never locked */
+    unsigned long id_;
+
+    static std::atomic<unsigned long> next_id_;
+    static thread_local StatCache stat_cache_; /* the last block used by this thread */
 };
 
 class NRU : public PageReplAlgorithm
 {
 public:
-    NRU(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
+    NRU(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
 
-    void recordGet(unsigned int, std::string);
-    void recordSet(unsigned int, std::string);
+    void recordGet(address_t, const char *tName);
+    void recordSet(address_t, const char *tName);
+    void save(SnapshotWriter &) const;
+    void load(SnapshotReader &);
 
 private:
-    unsigned int find();
+    address_t find();
     void handleTimer();
+    /* the frames of word index in each class, only the resident ones in [lowerBound, upperBound) */
+    void classWords(size_t index, address_t lowerBound, address_t upperBound, uint64_t classes[4]) const;
 
     unsigned int timer_;
     static const unsigned int kClockPeriod;
@@ -92,62 +176,72 @@ private:
 class FIFO : public PageReplAlgorithm
 {
 public:
-    FIFO(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
+    FIFO(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
 
-    void recordNew(unsigned int);
+    void recordNew(address_t);
     void delWorkingSets();
+    void save(SnapshotWriter &) const;
+    void load(SnapshotReader &);
 
 protected:
-    virtual unsigned int find();
-    std::map<std::string, std::queue<unsigned int>> queues_;
+    virtual address_t find();
+    std::map<std::string, std::queue<address_t>> queues_;
 };
 
 class SC : public FIFO
 {
 public:
-    SC(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
+    SC(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
 
 private:
-    unsigned int find();
+    address_t find();
 };
 
 class LRU : public PageReplAlgorithm
 {
 public:
-    LRU(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
+    LRU(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
 
-    void recordGet(unsigned int, std::string);
-    void recordSet(unsigned int, std::string);
+    void recordGet(address_t, const char *tName);
+    void recordSet(address_t, const char *tName);
+    void recordNew(address_t);
     void delWorkingSets();
-    void updateLists(unsigned int);
+    void updateLists(address_t);
+    void save(SnapshotWriter &) const;
+    void load(SnapshotReader &);
 
-    void workingSetSize() const;
+    unsigned int workingSetSize() const;
+    unsigned int workingSetSize(const std::string &) const;
 
 private:
-    unsigned int find();
-    std::map<std::string, std::vector<unsigned int>> lists_;
+    address_t find();
+    std::map<std::string, std::vector<address_t>> lists_;
 };
 
 class WSClock : public PageReplAlgorithm
 {
 public:
-    WSClock(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy);
+    WSClock(PageTable *pageTable, int *memory, int disc, bool allocPolicy);
 
-    void recordGet(unsigned int, std::string);
-    void recordSet(unsigned int, std::string);
+    void recordGet(address_t, const char *tName);
+    void recordSet(address_t, const char *tName);
+    void recordNew(address_t);
     void delWorkingSets();
-    void updateLists(unsigned int);
+    void updateLists(address_t);
+    /* the time points are saved as ages, so they are as old after the load as they were at the save */
+    void save(SnapshotWriter &) const;
+    void load(SnapshotReader &);
 
     struct WSClockEntry
     {
     public:
-        bool operator==(unsigned int _index) { return index == _index; };
-        unsigned int index;
+        bool operator==(address_t _index) { return index == _index; };
+        address_t index;
         std::chrono::steady_clock::time_point last_use;
     };
 
 private:
-    unsigned int find();
+    address_t find();
 
     /* to simulate circular linked list implementation */
     std::map<std::string, std::vector<WSClockEntry>> lists_;
@@ -157,12 +251,21 @@ private:
     bool isIdeal(WSClockEntry &);
 };
 
-PageReplAlgorithm::PageReplAlgorithm(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+const address_t PageReplAlgorithm::kNoFrame = ~(address_t)0;
+std::atomic<unsigned long> PageReplAlgorithm::next_id_(1);
+thread_local PageReplAlgorithm::StatCache PageReplAlgorithm::stat_cache_ = {0, nullptr, nullptr, nullptr};
+const std::string PageReplAlgorithm::kGlobal = "global";
+
+PageReplAlgorithm::PageReplAlgorithm(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : page_table_(pageTable),
       memory_(memory),
       disc_(disc),
+      disc_model_(nullptr),
       local_(allocPolicy),
-      global_free_index_(0)
+      current_thread_(&kGlobal),
+      current_block_(nullptr),
+      global_free_index_(0),
+      id_(next_id_++)
 {
     if (local_)
         threads_working_set_ = new std::map<std::string, LocalReplacementInfo>();
@@ -170,89 +273,214 @@ PageReplAlgorithm::PageReplAlgorithm(PageTable *pageTable, int *memory, std::fst
     srand(1000);
 }
 
-void PageReplAlgorithm::recordGet(unsigned int index, std::string tName)
+void PageReplAlgorithm::recordGet(address_t index, const char *tName)
 {
-    current_stat_ = current_thread_ = tName;
-    auto &entry = page_table_->getEntry(index);
-    entry.setReferenced(true);
-    stats_[current_stat_].read++;
+    enter(tName);
+    page_table_->referenced_.set(page_table_->getEntry(index).getFrameNumber());
+    StatBlock::bump(stat().read);
 }
 
 PageReplAlgorithm::~PageReplAlgorithm()
 {
     if (local_)
         delete threads_working_set_;
+
+    for (auto &block : stat_blocks_)
+        StatBlock::destroy(block.second);
 }
 
-void PageReplAlgorithm::recordSet(unsigned int index, std::string tName)
+void PageReplAlgorithm::recordSet(address_t index, const char *tName)
 {
-    current_stat_ = current_thread_ = tName;
-    auto &entry = page_table_->getEntry(index);
-    entry.setModified(true);
-    entry.setReferenced(true);
-    stats_[current_stat_].write++;
+    enter(tName);
+    address_t frame = page_table_->getEntry(index).getFrameNumber();
+    page_table_->modified_.set(frame);
+    page_table_->referenced_.set(frame);
+    StatBlock::bump(stat().write);
 }
 
-void PageReplAlgorithm::writeFrame(unsigned int virtual_high_order_bits, unsigned int physical_high_order_bits)
+void PageReplAlgorithm::writeFrame(address_t virtual_high_order_bits, address_t physical_high_order_bits)
 {
-    unsigned int frame_size = page_table_->frame_size_;
-    int *data = new int[frame_size];
-    for (size_t i = 0; i < frame_size; i++)
-        data[i] = memory_[physical_high_order_bits | i];
+    assert(virtual_high_order_bits % page_table_->frame_size_ == 0);
+    writeSlot(virtual_high_order_bits >> page_table_->low_order_size_,
+              physical_high_order_bits >> page_table_->low_order_size_, stat());
+}
+
+void PageReplAlgorithm::readFrame(address_t address)
+{
+    address_t index = page_table_->getHighOrder(address);
+    assert(index < page_table_->num_pages_);
+    auto &entry = page_table_->entryAt(index);
+    readSlot(page_table_->slotOf(index), entry.getFrameNumber(), stat());
+}
+
+void PageReplAlgorithm::writeSlot(address_t slot, address_t frame, const char *tName)
+{
+    writeSlot(slot, frame, stat(tName));
+}
 
+void PageReplAlgorithm::readSlot(address_t slot, address_t frame, const char *tName)
+{
+    readSlot(slot, frame, stat(tName));
+}
+
+void PageReplAlgorithm::writeSlot(address_t slot, address_t frame, StatBlock &block)
+{
     /* write one page */
-    disc_->seekp(std::ios::beg + (virtual_high_order_bits * sizeof(int)));
-    // assert(disc_->tellp() == virtual_high_order_bits * sizeof(int));
-    assert(virtual_high_order_bits % frame_size == 0);
-    disc_->write((char *)data, frame_size * sizeof(int));
-    delete[] data;
+    size_t bytes = page_table_->frame_size_ * sizeof(int);
+    off_t offset = (off_t)(slot * bytes);
+    if (pwrite(disc_, memory_ + (frame << page_table_->low_order_size_), bytes, offset) != (ssize_t)bytes)
+        throw std::logic_error("can't write the disc!");
+
+    if (disc_model_ != nullptr)
+        StatBlock::bump(block.io_time, disc_model_->write(slot));
 }
 
-void PageReplAlgorithm::readFrame(unsigned int address)
+void PageReplAlgorithm::readSlot(address_t slot, address_t frame, StatBlock &block)
 {
-    unsigned int index = page_table_->getHighOrder(address);
-    assert(index < page_table_->num_virtual_);
-    auto &entry = page_table_->table_[index];
-    unsigned int virtual_high_order_bits = index << page_table_->low_order_size_;
-    unsigned int physical_high_order_bits = entry.getFrameNumber() << page_table_->low_order_size_;
+    /* read one page, the part of the disc that was never written reads as zeros */
+    size_t bytes = page_table_->frame_size_ * sizeof(int);
+    off_t offset = (off_t)(slot * bytes);
+    if (pread(disc_, memory_ + (frame << page_table_->low_order_size_), bytes, offset) != (ssize_t)bytes)
+        throw std::logic_error("can't read the disc!");
+
+    StatBlock::bump(block.disc_read);
+    if (disc_model_ != nullptr)
+        StatBlock::bump(block.io_time, disc_model_->read(slot));
+}
 
-    disc_->seekg(std::ios::beg + (virtual_high_order_bits * sizeof(int)));
-    // assert(disc_->tellg() == virtual_high_order_bits);
-    disc_->read((char *)(memory_ + physical_high_order_bits), sizeof(int) * page_table_->frame_size_);
-    stats_[current_stat_].disc_read++;
+void PageReplAlgorithm::map(address_t index, address_t frame, const char *tName)
+{
+    enter(tName);
+    page_table_->set(index, frame);
+    recordNew(index);
 }
 
-void PageReplAlgorithm::replace(unsigned int index)
+void PageReplAlgorithm::setDiscModel(DiscModel *model)
 {
+    disc_model_ = model;
+}
 
-    stats_[current_stat_].page_repl++;
-    unsigned int replace_idx = find();
-    unsigned int frame_size = page_table_->frame_size_;
+void PageReplAlgorithm::save(SnapshotWriter &out) const
+{
+    out.put<uint64_t>(global_free_index_);
+    out.put<uint64_t>(local_ ? threads_working_set_->size() : 0);
+    if (!local_)
+        return;
+    for (auto &working_set : *threads_working_set_)
+    {
+        out.putString(working_set.first);
+        out.put<uint64_t>(working_set.second.lower_bound_);
+        out.put<uint64_t>(working_set.second.upper_bound_);
+        out.put<uint64_t>(working_set.second.local_free_index_);
+    }
+}
 
-    auto &entry = page_table_->table_[replace_idx];
-    assert(entry.isPresent());
-    entry.setPresent(false); /* replaced entry is no longer present in the table */
-    unsigned int virtual_high_order_bits = replace_idx << page_table_->low_order_size_;
-    unsigned int physical_high_order_bits = entry.getFrameNumber() << page_table_->low_order_size_;
+void PageReplAlgorithm::load(SnapshotReader &in)
+{
+    global_free_index_ = in.get<uint64_t>();
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        std::string name = in.getString();
+        address_t lower_bound = in.get<uint64_t>();
+        address_t upper_bound = in.get<uint64_t>();
+        address_t free_index = in.get<uint64_t>();
+        if (!local_ || upper_bound > page_table_->num_physical_ || lower_bound + free_index > upper_bound)
+            throw std::logic_error("snapshot doesn't fit the working sets!");
+        (*threads_working_set_)[name] = {lower_bound, upper_bound, free_index};
+    }
+}
 
-    if (entry.isModified()) /* write to disc if modified */
+void PageReplAlgorithm::saveStats(SnapshotWriter &out) const
+{
+    auto stats = getStats();
+    out.put<uint64_t>(stats.size());
+    for (auto &stat : stats)
+    {
+        out.putString(stat.first);
+        out.put<Stats>(stat.second);
+    }
+}
+
+void PageReplAlgorithm::loadStats(SnapshotReader &in)
+{
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
     {
-        writeFrame(virtual_high_order_bits, physical_high_order_bits);
-        entry.setModified(false);
-        stats_[current_stat_].disc_write++;
+        std::string name = in.getString();
+        Stats sum = in.get<Stats>();
+
+        /* into the block of the loading thread, getStats() sums it up with the others */
+        StatBlock &block = stat(name);
+        StatBlock::bump(block.read, sum.read);
+        StatBlock::bump(block.write, sum.write);
+        StatBlock::bump(block.page_miss, sum.page_miss);
+        StatBlock::bump(block.page_repl, sum.page_repl);
+        StatBlock::bump(block.disc_read, sum.disc_read);
+        StatBlock::bump(block.disc_write, sum.disc_write);
+        StatBlock::bump(block.tlb_hit, sum.tlb_hit);
+        StatBlock::bump(block.tlb_miss, sum.tlb_miss);
+        StatBlock::bump(block.huge_fault, sum.huge_fault);
+        StatBlock::bump(block.promotion, sum.promotion);
+        StatBlock::bump(block.demotion, sum.demotion);
+        StatBlock::bump(block.io_time, sum.io_time);
+        for (int type = 0; type < FAULT_TYPES; type++)
+            for (int j = 0; j < HISTOGRAM_BUCKETS; j++)
+                StatBlock::bump(block.fault_latency[type][j], sum.fault_latency[type].buckets[j]);
     }
+}
+
+FaultType PageReplAlgorithm::replace(address_t index, address_t *victim)
+{
+    FaultType type;
+    address_t frame = evict(&type, victim);
 
     /* read one page */
-    page_table_->set(index, entry.getFrameNumber());
-    virtual_high_order_bits = page_table_->getHighOrder(index) << page_table_->low_order_size_;
-    assert(physical_high_order_bits == page_table_->getEntry(index).getFrameNumber() << page_table_->low_order_size_);
-    disc_->seekg(std::ios::beg + (virtual_high_order_bits * sizeof(int)));
-    disc_->read((char *)(memory_ + physical_high_order_bits), sizeof(int) * frame_size);
+    page_table_->set(index, frame);
+    readFrame(index);
     recordNew(index);
-    stats_[current_stat_].disc_read++;
+    return type;
+}
+
+address_t PageReplAlgorithm::evict(FaultType *type, address_t *victim, address_t *writeBack)
+{
+    StatBlock::bump(stat().page_repl);
+    address_t replace_idx = find();
+    if (victim != nullptr)
+        *victim = replace_idx;
+
+    auto &entry = page_table_->entryAt(replace_idx);
+    assert(entry.isPresent());
+    if (entry.isHuge())
+    {
+        /* eviction pressure: the tails stay as base pages, the algorithm gets to know them */
+        page_table_->demote(replace_idx);
+        for (address_t i = 1; i < page_table_->hugePages(); i++)
+            recordNew((replace_idx + i) << page_table_->low_order_size_);
+        StatBlock::bump(stat().demotion);
+    }
+    address_t frame = entry.getFrameNumber();
+    bool modified = page_table_->modified_.test(frame);
+    *type = modified ? FaultType::DIRTY : FaultType::CLEAN;
+
+    if (writeBack != nullptr)
+        *writeBack = PageTable::kNoPage;
+    if (modified) /* write to disc if modified, into the slot the sharers use too */
+    {
+        if (writeBack != nullptr) /* left to the caller */
+            *writeBack = page_table_->slotOf(replace_idx);
+        else
+            writeFrame(page_table_->slotOf(replace_idx) << page_table_->low_order_size_,
+                       frame << page_table_->low_order_size_);
+        page_table_->modified_.reset(frame);
+        StatBlock::bump(stat().disc_write);
+    }
+
+    page_table_->evict(replace_idx); /* replaced entry is no longer present in the table */
+    return frame;
 }
 
-void PageReplAlgorithm::addWorkingSet(std::string thread_name, unsigned int lower_bound, unsigned int upper_bound)
+void PageReplAlgorithm::addWorkingSet(std::string thread_name, address_t lower_bound, address_t upper_bound)
 {
 
     if (local_)
@@ -264,9 +492,10 @@ void PageReplAlgorithm::addWorkingSet(std::string thread_name, unsigned int lowe
         };
         threads_working_set_->insert({thread_name, working_set});
     }
-    Stats stats{
-        0, 0, 0, 0, 0, 0};
-    stats_.insert({thread_name, stats});
+
+    /* listed in the stats even if the thread never touches the memory */
+    std::lock_guard<std::mutex> lock(stat_mutex_);
+    stat_names_[thread_name];
 }
 
 void PageReplAlgorithm::delWorkingSets()
@@ -276,18 +505,29 @@ void PageReplAlgorithm::delWorkingSets()
     else
         global_free_index_ = 0;
 
-    for (size_t i = 0; i < page_table_->num_virtual_; i++)
+    /* only the resident pages, the virtual address space may be too big to walk */
+    for (address_t frame = 0; frame < page_table_->num_physical_; frame++)
     {
-        auto &entry = page_table_->table_[i];
-        if (entry.isPresent())
-            writeFrame(i << page_table_->low_order_size_, entry.getFrameNumber() << page_table_->low_order_size_);
-        entry.setPresent(false);
+        address_t page = page_table_->pageOf(frame);
+        if (page == PageTable::kNoPage)
+            continue;
+        if (page_table_->isTail(page)) /* written with its head */
+            continue;
+
+        address_t pages = page_table_->entryAt(page).isHuge() ? page_table_->hugePages() : 1;
+        for (address_t i = 0; i < pages; i++)
+            writeFrame(page_table_->slotOf(page + i) << page_table_->low_order_size_,
+                       (frame + i) << page_table_->low_order_size_);
+        page_table_->evict(page);
     }
 }
 
 void PageReplAlgorithm::printStats() const
 {
-    for (auto it = stats_.begin(); it != stats_.end(); it++)
+    static const std::string fault_names[FAULT_TYPES] = {"free frame", "clean eviction", "dirty eviction"};
+    auto stats = getStats();
+
+    for (auto it = stats.begin(); it != stats.end(); it++)
     {
         std::cout << "{ Statistics for " + it->first + " }\n";
         std::cout << "\t* Number of reads " << it->second.read << "\n";
@@ -295,32 +535,149 @@ void PageReplAlgorithm::printStats() const
         std::cout << "\t* Number of page misses " << it->second.page_miss << "\n";
         std::cout << "\t* Number of page replacements " << it->second.page_repl << "\n";
         std::cout << "\t* Number of disk page reads " << it->second.disc_read << "\n";
-        std::cout << "\t* Number of disk page writes " << it->second.disc_write << "\n"
-                  << std::endl;
+        std::cout << "\t* Number of disk page writes " << it->second.disc_write << "\n";
+        std::cout << "\t* Simulated disk time " << it->second.io_time / 1e9 << " secs\n";
+        std::cout << "\t* TLB hits " << it->second.tlb_hit << ", misses " << it->second.tlb_miss << "\n";
+        if (page_table_->hugePages() > 1)
+            std::cout << "\t* Huge page faults " << it->second.huge_fault << ", promotions " << it->second.promotion
+                      << ", demotions " << it->second.demotion << "\n";
+        std::cout << "\t* Page fault latency p50 " << it->second.faultLatency(0.5)
+                  << " ns, p99 " << it->second.faultLatency(0.99) << " ns\n";
+        for (int type = 0; type < FAULT_TYPES; type++)
+        {
+            auto &histogram = it->second.fault_latency[type];
+            std::cout << "\t\t- " << fault_names[type] << ": " << histogram.count() << " faults, p50 "
+                      << histogram.percentile(0.5) << " ns, p99 " << histogram.percentile(0.99) << " ns\n";
+        }
+        std::cout << std::endl;
+    }
+}
+
+std::map<std::string, PageReplAlgorithm::Stats> PageReplAlgorithm::getStats() const
+{
+    std::lock_guard<std::mutex> lock(stat_mutex_);
+    std::map<std::string, Stats> stats;
+
+    /* sum up the blocks of every thread that used the same name */
+    for (auto &name : stat_names_)
+    {
+        Stats &sum = stats[name.first]; /* value initialized, all zeros */
+        for (auto block : name.second)
+        {
+            sum.read += block->read.load(std::memory_order_relaxed);
+            sum.write += block->write.load(std::memory_order_relaxed);
+            sum.page_miss += block->page_miss.load(std::memory_order_relaxed);
+            sum.page_repl += block->page_repl.load(std::memory_order_relaxed);
+            sum.disc_read += block->disc_read.load(std::memory_order_relaxed);
+            sum.disc_write += block->disc_write.load(std::memory_order_relaxed);
+            sum.tlb_hit += block->tlb_hit.load(std::memory_order_relaxed);
+            sum.tlb_miss += block->tlb_miss.load(std::memory_order_relaxed);
+            sum.huge_fault += block->huge_fault.load(std::memory_order_relaxed);
+            sum.promotion += block->promotion.load(std::memory_order_relaxed);
+            sum.demotion += block->demotion.load(std::memory_order_relaxed);
+            sum.io_time += block->io_time.load(std::memory_order_relaxed);
+            for (int type = 0; type < FAULT_TYPES; type++)
+                for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+                    sum.fault_latency[type].buckets[i] += block->fault_latency[type][i].load(std::memory_order_relaxed);
+        }
     }
+    return stats;
+}
+
+uint64_t PageReplAlgorithm::Stats::faultLatency(double percentile) const
+{
+    Histogram all = fault_latency[0];
+    for (int type = 1; type < FAULT_TYPES; type++)
+        all.merge(fault_latency[type]);
+    return all.percentile(percentile);
+}
+
+void PageReplAlgorithm::recordFault(FaultType type, uint64_t ns)
+{
+    stat().recordFault(type, ns);
 }
 
-const std::map<std::string, PageReplAlgorithm::Stats> &PageReplAlgorithm::getStats() const
+void PageReplAlgorithm::recordTlb(bool hit)
 {
-    return stats_;
+    StatBlock::bump(hit ? stat().tlb_hit : stat().tlb_miss);
 }
 
-bool PageReplAlgorithm::inWorkingSet(unsigned int physical_index) const
+void PageReplAlgorithm::recordPromotion()
+{
+    StatBlock::bump(stat().promotion);
+}
+
+void PageReplAlgorithm::enter(const char *tName)
+{
+    current_block_ = &stat(tName);
+    current_thread_ = stat_cache_.key;
+}
+
+StatBlock &PageReplAlgorithm::stat()
+{
+    if (current_block_ == nullptr) /* e.g. a partition reset right after a restore */
+        current_block_ = &stat(kGlobal);
+    return *current_block_;
+}
+
+StatBlock &PageReplAlgorithm::stat(const char *tName)
+{
+    /* fast path, the thread keeps passing the same name: no string is built or compared */
+    if (stat_cache_.owner == id_ && stat_cache_.name == tName)
+        return *stat_cache_.block;
+
+    StatBlock &block = stat(std::string(tName));
+    stat_cache_.name = tName;
+    return block;
+}
+
+StatBlock &PageReplAlgorithm::stat(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(stat_mutex_);
+    auto key = std::make_pair(std::this_thread::get_id(), name);
+    auto it = stat_blocks_.find(key);
+    StatBlock *block;
+    if (it != stat_blocks_.end())
+        block = it->second;
+    else
+    {
+        block = StatBlock::create();
+        stat_blocks_.insert({key, block});
+        stat_names_[name].push_back(block);
+    }
+
+    /* the name is cached by its buffer in stat(const char *) only */
+    stat_cache_.owner = id_;
+    stat_cache_.name = nullptr;
+    stat_cache_.block = block;
+    stat_cache_.key = &stat_names_.find(name)->first;
+    return *block;
+}
+
+bool PageReplAlgorithm::inWorkingSet(address_t physical_index) const
 {
     assert(local_);
 
-    auto &working_set = threads_working_set_->at(current_thread_);
+    auto &working_set = threads_working_set_->at(*current_thread_);
     return working_set.lower_bound_ <= physical_index && physical_index < working_set.upper_bound_;
 }
 
-int PageReplAlgorithm::findIndex(std::string tName)
+bool PageReplAlgorithm::isCandidate(address_t page) const
+{
+    auto &entry = page_table_->entryAt(page);
+    if (!entry.isPresent() || page_table_->pageOf(entry.getFrameNumber()) != page || page_table_->isTail(page))
+        return false;
+    return local_ ? inWorkingSet(entry.getFrameNumber()) : true;
+}
+
+address_t PageReplAlgorithm::findIndex(const char *tName)
 {
-    unsigned int lower_bound, upper_bound;
-    unsigned int *free_index = nullptr;
-    current_stat_ = current_thread_ = tName;
+    address_t lower_bound, upper_bound;
+    address_t *free_index = nullptr;
+    enter(tName);
     if (local_)
     {
-        auto &working_set = threads_working_set_->at(tName);
+        auto &working_set = threads_working_set_->at(*current_thread_);
         free_index = &working_set.local_free_index_;
         lower_bound = working_set.lower_bound_;
         upper_bound = working_set.upper_bound_;
@@ -332,11 +689,11 @@ int PageReplAlgorithm::findIndex(std::string tName)
         upper_bound = page_table_->num_physical_;
     }
 
-    stats_[current_stat_].page_miss++;
-    unsigned int index = lower_bound + *free_index;
+    StatBlock::bump(stat().page_miss);
+    address_t index = lower_bound + *free_index;
 
     if (index == upper_bound)
-        return -1;
+        return kNoFrame;
     else
     {
         (*free_index)++;
@@ -344,7 +701,52 @@ int PageReplAlgorithm::findIndex(std::string tName)
     }
 }
 
-void PageReplAlgorithm::recordNew(unsigned int index)
+address_t PageReplAlgorithm::findBlock(const char *tName, address_t count)
+{
+    address_t lower_bound, upper_bound;
+    address_t *free_index = nullptr;
+    enter(tName);
+    if (local_)
+    {
+        auto &working_set = threads_working_set_->at(*current_thread_);
+        free_index = &working_set.local_free_index_;
+        lower_bound = working_set.lower_bound_;
+        upper_bound = working_set.upper_bound_;
+    }
+    else
+    {
+        free_index = &global_free_index_;
+        lower_bound = 0;
+        upper_bound = page_table_->num_physical_;
+    }
+
+    /* frames are handed out in order, so a block is either at the free index or nowhere */
+    address_t index = lower_bound + *free_index;
+    if (index % count != 0 || upper_bound - index < count)
+        return kNoFrame;
+
+    StatBlock::bump(stat().page_miss);
+    StatBlock::bump(stat().huge_fault);
+    *free_index += count;
+    return index;
+}
+
+address_t PageReplAlgorithm::residentPages(const std::string &tName) const
+{
+    if (!local_)
+        return page_table_->resident_.count(0, page_table_->num_physical_);
+    auto it = threads_working_set_->find(tName);
+    if (it == threads_working_set_->end()) /* not partitioned now */
+        return 0;
+    return page_table_->resident_.count(it->second.lower_bound_, it->second.upper_bound_);
+}
+
+bool PageReplAlgorithm::canUse(address_t frame) const
+{
+    return local_ ? inWorkingSet(frame) : true;
+}
+
+void PageReplAlgorithm::recordNew(address_t index)
 {
     /* intentionally left blank for making this record optional. */
     index = index; /* dummy assignment to suppress warnings */
@@ -354,111 +756,132 @@ void PageReplAlgorithm::recordNew(unsigned int index)
 
 const unsigned int NRU::kClockPeriod = 10;
 
-NRU::NRU(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+NRU::NRU(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : PageReplAlgorithm(pageTable, memory, disc, allocPolicy), timer_(0)
 {
     /* intentionally left blank */
 }
 
-unsigned int NRU::find()
+address_t NRU::find()
 {
-    /* 4 different classes: cartesian product of (referenced, modified) */
-    std::vector<unsigned int> page_classes[4];
-
-    for (size_t i = 0; i < page_table_->num_virtual_; i++)
+    /* the frames to choose from, local page replacement policies applied if local */
+    address_t lower_bound = 0, upper_bound = page_table_->num_physical_;
+    if (local_)
     {
-        auto &entry = page_table_->table_[i];
-
-        bool cont = local_ ? inWorkingSet(entry.getFrameNumber()) : true; /* local page replacement policies applied if local */
-        if (cont && entry.isPresent())
-        {
-            if (entry.isReferenced())
-            {
-                if (entry.isModified())
-                    page_classes[3].push_back(i); /* class 3: referenced & modified */
-                else
-                    page_classes[2].push_back(i); /* class 2: referenced & not modified */
-            }
-            else
-            {
-                if (entry.isModified())
-                    page_classes[1].push_back(i); /* class 1: not referenced & modified */
-                else
-                    page_classes[0].push_back(i); /* class 0: not referenced & not modified */
-            }
-        }
+        auto &working_set = threads_working_set_->at(*current_thread_);
+        lower_bound = working_set.lower_bound_;
+        upper_bound = working_set.upper_bound_;
     }
+    size_t first = lower_bound / BitVector::kWordBits;
+    size_t last = (upper_bound + BitVector::kWordBits - 1) / BitVector::kWordBits;
 
-    bool found = false;
-    unsigned int replace_idx = 0;
-    for (auto &c : page_classes)
+    /* 4 different classes: cartesian product of (referenced, modified), counted 64 frames at a time */
+    size_t counts[4] = {0, 0, 0, 0};
+    for (size_t i = first; i < last; i++)
     {
-        if (!c.empty())
-        {
-            found = true;
-            /* pick a random item from the given class */
-            replace_idx = c[rand() % c.size()];
-            break;
-        }
+        uint64_t classes[4];
+        classWords(i, lower_bound, upper_bound, classes);
+        for (int c = 0; c < 4; c++)
+            counts[c] += BitVector::popcount(classes[c]);
     }
 
-    assert(found);
+    int c = 0;
+    while (c < 4 && counts[c] == 0)
+        c++;
+    assert(c < 4);
 
-    return replace_idx;
+    /* pick a random item from the given class, the nth one of the class in the order of the frames */
+    size_t n = rand() % counts[c];
+    for (size_t i = first; i < last; i++)
+    {
+        uint64_t classes[4];
+        classWords(i, lower_bound, upper_bound, classes);
+        size_t count = BitVector::popcount(classes[c]);
+        if (n < count)
+            return page_table_->pageOf(i * BitVector::kWordBits + BitVector::select(classes[c], n));
+        n -= count;
+    }
+    assert(false);
+    return 0;
+}
+
+void NRU::classWords(size_t index, address_t lowerBound, address_t upperBound, uint64_t classes[4]) const
+{
+    uint64_t resident = page_table_->resident_.word(index) & BitVector::rangeMask(index, lowerBound, upperBound);
+    uint64_t referenced = page_table_->referenced_.word(index), modified = page_table_->modified_.word(index);
+    classes[0] = resident & ~referenced & ~modified; /* class 0: not referenced & not modified */
+    classes[1] = resident & ~referenced & modified;  /* class 1: not referenced & modified */
+    classes[2] = resident & referenced & ~modified;  /* class 2: referenced & not modified */
+    classes[3] = resident & referenced & modified;   /* class 3: referenced & modified */
 }
 
 void NRU::handleTimer()
 {
     timer_++;
 
-    /* refresh reference bits in every clock period */
+    /* refresh reference bits in every clock period, of all frames at once */
     if (timer_ == kClockPeriod)
     {
-        for (size_t i = 0; i < page_table_->num_virtual_; i++)
-            page_table_->table_[i].setReferenced(false);
+        page_table_->referenced_.clear();
         timer_ = 0;
     }
 }
 
-void NRU::recordGet(unsigned int index, std::string tName)
+void NRU::save(SnapshotWriter &out) const
+{
+    PageReplAlgorithm::save(out);
+    out.put<uint32_t>(timer_);
+}
+
+void NRU::load(SnapshotReader &in)
+{
+    PageReplAlgorithm::load(in);
+    timer_ = in.get<uint32_t>();
+}
+
+void NRU::recordGet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordGet(index, tName);
     handleTimer();
 }
 
-void NRU::recordSet(unsigned int index, std::string tName)
+void NRU::recordSet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordSet(index, tName);
     handleTimer();
 }
 
 /* FIFO implementation */
-FIFO::FIFO(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+FIFO::FIFO(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : PageReplAlgorithm(pageTable, memory, disc, allocPolicy)
 {
     /* intentionally left blank */
 }
 
-void FIFO::recordNew(unsigned int index)
+void FIFO::recordNew(address_t index)
 {
     if (!local_)
-        current_thread_ = "global";
+        current_thread_ = &kGlobal;
 
-    if (queues_.find(current_thread_) == queues_.end()) /* first time */
-        queues_.insert({current_thread_, std::queue<unsigned int>()});
-    assert(queues_[current_thread_].front() != page_table_->getHighOrder(index));
-    queues_[current_thread_].push(page_table_->getHighOrder(index));
+    auto &queue = queues_[*current_thread_]; /* empty the first time */
+    address_t page = page_table_->getHighOrder(index);
+    if (queue.empty() || queue.back() != page) /* a tail of a demoted huge page may be queued from before */
+        queue.push(page);
 }
 
-unsigned int FIFO::find()
+address_t FIFO::find()
 {
     if (!local_)
-        current_thread_ = "global";
-    auto &queue = queues_[current_thread_];
-    assert(!queue.empty());
-    unsigned int index = queue.front();
-    queue.pop();
-    return index;
+        current_thread_ = &kGlobal;
+    auto &queue = queues_[*current_thread_];
+    while (true)
+    {
+        assert(!queue.empty());
+        address_t index = queue.front();
+        queue.pop();
+        if (isCandidate(index)) /* tails of huge pages and pages that moved away are dropped */
+            return index;
+    }
 }
 
 void FIFO::delWorkingSets()
@@ -467,22 +890,50 @@ void FIFO::delWorkingSets()
     queues_.clear();
 }
 
+void FIFO::save(SnapshotWriter &out) const
+{
+    PageReplAlgorithm::save(out);
+    out.put<uint64_t>(queues_.size());
+    for (auto &queue : queues_)
+    {
+        std::queue<address_t> copy = queue.second; /* a queue can only be walked by popping */
+        out.putString(queue.first);
+        out.put<uint64_t>(copy.size());
+        for (; !copy.empty(); copy.pop())
+            out.put<uint64_t>(copy.front());
+    }
+}
+
+void FIFO::load(SnapshotReader &in)
+{
+    PageReplAlgorithm::load(in);
+    queues_.clear();
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        auto &queue = queues_[in.getString()];
+        uint64_t pages = in.get<uint64_t>();
+        for (uint64_t j = 0; j < pages; j++)
+            queue.push(in.get<uint64_t>());
+    }
+}
+
 /* SC implementation */
-SC::SC(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+SC::SC(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : FIFO(pageTable, memory, disc, allocPolicy)
 {
     /* intentionally left blank */
 }
 
-unsigned int SC::find()
+address_t SC::find()
 {
-    unsigned int index = FIFO::find();
-    auto &entry = page_table_->table_[index];
+    address_t index = FIFO::find();
+    auto &entry = page_table_->entryAt(index);
     assert(entry.isPresent());
-    if (entry.isReferenced())
+    if (page_table_->referenced_.test(entry.getFrameNumber()))
     {
-        entry.setReferenced(false);
-        queues_[current_thread_].push(index); /* give a second change by putting back into line */
+        page_table_->referenced_.reset(entry.getFrameNumber());
+        queues_[*current_thread_].push(index); /* give a second change by putting back into line */
         return SC::find();
     }
     else
@@ -491,35 +942,38 @@ unsigned int SC::find()
 
 /* LRU implementation */
 
-LRU::LRU(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+LRU::LRU(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : PageReplAlgorithm(pageTable, memory, disc, allocPolicy)
 {
     /* intentionally left blank */
 }
 
-void LRU::recordGet(unsigned int index, std::string tName)
+void LRU::recordGet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordGet(index, tName);
     updateLists(index);
 }
 
-void LRU::recordSet(unsigned int index, std::string tName)
+void LRU::recordSet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordSet(index, tName);
     updateLists(index);
 }
 
-void LRU::updateLists(unsigned int index)
+void LRU::recordNew(address_t index)
 {
-    if (!local_)
-        current_thread_ = "global";
+    /* a frame split off by copy-on-write may not be accessed before it is a candidate */
+    updateLists(index);
+}
 
-    if (lists_.find(current_thread_) == lists_.end()) /* first time */
-        lists_.insert({current_thread_, std::vector<unsigned int>()});
+void LRU::updateLists(address_t index)
+{
+    if (!local_)
+        current_thread_ = &kGlobal;
 
-    // unsigned int real_index = index;
+    // address_t real_index = index;
     index = page_table_->getHighOrder(index);
-    auto &list = lists_[current_thread_];
+    auto &list = lists_[*current_thread_]; /* empty the first time */
     auto it = std::find(list.begin(), list.end(), index);
 
     if (it != list.end()) /* item exists */
@@ -527,16 +981,21 @@ void LRU::updateLists(unsigned int index)
     list.push_back(index);
 }
 
-unsigned int LRU::find()
+address_t LRU::find()
 {
     if (!local_)
-        current_thread_ = "global";
+        current_thread_ = &kGlobal;
 
-    auto &list = lists_[current_thread_];
+    auto &list = lists_[*current_thread_];
 
-    unsigned int index = list.front();
-    list.erase(list.begin());
-    return index;
+    while (true)
+    {
+        assert(!list.empty());
+        address_t index = list.front();
+        list.erase(list.begin());
+        if (isCandidate(index))
+            return index;
+    }
 }
 
 void LRU::delWorkingSets()
@@ -545,18 +1004,47 @@ void LRU::delWorkingSets()
     lists_.clear();
 }
 
-void LRU::workingSetSize() const
+void LRU::save(SnapshotWriter &out) const
 {
-    if (current_thread_ != "fill" && current_thread_ != "check")
+    PageReplAlgorithm::save(out);
+    out.put<uint64_t>(lists_.size());
+    for (auto &list : lists_)
     {
-        unsigned int ws_size = lists_.at(current_thread_).size();
-            std::cout << current_thread_ << " " << ws_size << std::endl;
+        out.putString(list.first);
+        out.put<uint64_t>(list.second.size());
+        out.write(list.second.data(), list.second.size() * sizeof(address_t));
     }
 }
 
+void LRU::load(SnapshotReader &in)
+{
+    PageReplAlgorithm::load(in);
+    lists_.clear();
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        auto &list = lists_[in.getString()];
+        uint64_t pages = in.get<uint64_t>();
+        list.resize(pages);
+        memcpy(list.data(), in.read(pages * sizeof(address_t)), pages * sizeof(address_t));
+    }
+}
+
+unsigned int LRU::workingSetSize() const
+{
+    auto it = lists_.find(*current_thread_);
+    return it == lists_.end() ? 0 : it->second.size();
+}
+
+unsigned int LRU::workingSetSize(const std::string &tName) const
+{
+    auto it = lists_.find(local_ ? tName : kGlobal);
+    return it == lists_.end() ? 0 : it->second.size();
+}
+
 /* WSClock implementation */
 
-WSClock::WSClock(PageTable *pageTable, int *memory, std::fstream *disc, bool allocPolicy)
+WSClock::WSClock(PageTable *pageTable, int *memory, int disc, bool allocPolicy)
     : PageReplAlgorithm(pageTable, memory, disc, allocPolicy)
 {
     /* intentionally left blank */
@@ -565,28 +1053,30 @@ WSClock::WSClock(PageTable *pageTable, int *memory, std::fstream *disc, bool all
 const double WSClock::kTau = 500;
 std::chrono::steady_clock WSClock::clock_;
 
-void WSClock::recordGet(unsigned int index, std::string tName)
+void WSClock::recordGet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordGet(index, tName);
     updateLists(index);
 }
 
-void WSClock::recordSet(unsigned int index, std::string tName)
+void WSClock::recordSet(address_t index, const char *tName)
 {
     PageReplAlgorithm::recordSet(index, tName);
     updateLists(index);
 }
 
-void WSClock::updateLists(unsigned int index)
+void WSClock::recordNew(address_t index)
 {
-    if (!local_)
-        current_thread_ = "global";
+    updateLists(index);
+}
 
-    if (lists_.find(current_thread_) == lists_.end()) /* first time */
-        lists_.insert({current_thread_, std::vector<WSClockEntry>()});
+void WSClock::updateLists(address_t index)
+{
+    if (!local_)
+        current_thread_ = &kGlobal;
 
     index = page_table_->getHighOrder(index);
-    auto &list = lists_[current_thread_];
+    auto &list = lists_[*current_thread_]; /* empty the first time */
     auto it = std::find(list.begin(), list.end(), index);
 
     if (it != list.end())
@@ -595,23 +1085,26 @@ void WSClock::updateLists(unsigned int index)
         list.push_back({index, clock_.now()});
 }
 
-unsigned int WSClock::find()
+address_t WSClock::find()
 {
     if (!local_)
-        current_thread_ = "global";
-
-    auto &list = lists_[current_thread_];
+        current_thread_ = &kGlobal;
 
-    auto &entry = list.front();
-    list.erase(list.begin());
+    auto &list = lists_[*current_thread_];
 
-    if (isIdeal(entry))
-        return entry.index;
-    else
+    while (true)
     {
-        /* repaat the process with next page */
+        assert(!list.empty());
+        WSClockEntry entry = list.front(); /* copied, since it is erased from the list */
+        list.erase(list.begin());
+
+        if (!isCandidate(entry.index)) /* dropped, it is listed where it belongs */
+            continue;
+        if (isIdeal(entry))
+            return entry.index;
+
+        /* repeat the process with next page */
         list.push_back(entry);
-        return WSClock::find();
     }
 }
 
@@ -621,12 +1114,48 @@ void WSClock::delWorkingSets()
     lists_.clear();
 }
 
+void WSClock::save(SnapshotWriter &out) const
+{
+    PageReplAlgorithm::save(out);
+    auto now = clock_.now();
+    out.put<uint64_t>(lists_.size());
+    for (auto &list : lists_)
+    {
+        out.putString(list.first);
+        out.put<uint64_t>(list.second.size());
+        for (auto &entry : list.second)
+        {
+            out.put<uint64_t>(entry.index);
+            out.put<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - entry.last_use).count());
+        }
+    }
+}
+
+void WSClock::load(SnapshotReader &in)
+{
+    PageReplAlgorithm::load(in);
+    auto now = clock_.now();
+    lists_.clear();
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        auto &list = lists_[in.getString()];
+        uint64_t pages = in.get<uint64_t>();
+        for (uint64_t j = 0; j < pages; j++)
+        {
+            address_t index = in.get<uint64_t>();
+            std::chrono::nanoseconds age(in.get<int64_t>());
+            list.push_back({index, now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age)});
+        }
+    }
+}
+
 bool WSClock::isIdeal(WSClockEntry &clock_entry)
 {
-    auto &table_entry = page_table_->table_[clock_entry.index];
-    if (table_entry.isReferenced())
+    address_t frame = page_table_->entryAt(clock_entry.index).getFrameNumber();
+    if (page_table_->referenced_.test(frame))
     {
-        table_entry.setReferenced(false);
+        page_table_->referenced_.reset(frame);
         return false;
     }
     else
@@ -4,8 +4,40 @@
 #include <cmath>
 #include <cassert>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
 #include "page-repl-algorithm.h"
-
+#include "snapshot.h"
+#include "bit-vector.h"
+
+/* virtual and physical addresses, page numbers and frame numbers of the simulation */
+typedef uint64_t address_t;
+
+/**
+ * page table of the simulation.
+ * entries are kept in a sparse radix tree like the x86-64 page tables: every level resolves
+ * kLevelBits bits of the page number and a leaf of entries is allocated only when one of its pages is mapped.
+ * so the table costs memory in proportion to the touched pages, not to the size of the virtual address space.
+ * a frame table with one slot per physical frame keeps the page mapped into each frame,
+ * so resident pages can be visited without walking the virtual address space.
+ *
+ * processes: every process has its own radix tree over the same frame table. pages are named by keys,
+ * the process id above the page number: [process | page]. addresses given to the table carry the process
+ * the same way, @see tag(). so the replacement algorithms see one flat key space shared by every process.
+ *
+ * copy-on-write: after fork() a frame may be mapped by more than one page. the page in the frame table is the
+ * primary one, it is the only page the replacement algorithm knows and it keeps the R/M bits of the frame.
+ * the others are listed in sharers_. the same way a swap slot may back more than one page, slot_refs_ counts
+ * them. a write to a shared page splits it first, @see VirtualMemory::breakCow()
+ *
+ * huge pages: 2^huge_bits_ base pages aligned in the virtual space, mapped to as many aligned contiguous frames.
+ * every base page keeps its entry with the huge flag set. the head page (the first one) is the only one the
+ * replacement algorithm knows and it keeps the R/M bits of the whole huge page, like the primary page of a
+ * shared frame. the other pages are the tails.
+ * pages that are unmapped or moved to another frame are queued for the tlb shootdown, @see takeShootdowns()
+ ***/
 class PageTable
 {
 public:
@@ -16,18 +48,22 @@ public:
     friend class LRU;
     friend class WSClock;
 
-    PageTable(unsigned int, unsigned int, unsigned int);
+    PageTable(address_t, address_t, address_t, unsigned int numProcesses = 1);
     ~PageTable();
 
+    PageTable(const PageTable &) = delete;
+    PageTable &operator=(const PageTable &) = delete;
+
     /* address oriented in page-table */
-    bool isPresent(unsigned int) const;
-    void setModified(unsigned int address);
+    bool isPresent(address_t) const;
+    void setModified(address_t address);
 
     void print() const;
 
-    unsigned int get(unsigned int) const;
-    void set(unsigned int, unsigned int);
+    address_t get(address_t) const;
+    void set(address_t, address_t);
 
+    /* the R/M bits are kept by frame in the page table, @see referenced_ */
     class Entry
     {
         friend class PageTable;
@@ -35,184 +71,859 @@ public:
     public:
         Entry();
 
-        void setReferenced(bool);
-        void setModified(bool);
         void setPresent(bool);
 
-        bool isReferenced() const;
-        bool isModified() const;
         bool isPresent() const;
+        bool isHuge() const;
 
-        unsigned int getFrameNumber() const;
+        address_t getFrameNumber() const;
 
     private:
-        bool referenced_;
-        bool modified_;
         bool present_;
-        unsigned int page_frame_number_;
+        address_t page_frame_number_;
+        address_t swap_slot_; /* kNoPage if the page is swapped into its own slot */
+        bool huge_;
     };
 
+    static const address_t kNoPage;
+
+    /* address of the table for the virtual address of the process, and the process of a page key */
+    address_t tag(unsigned int process, address_t address) const;
+    unsigned int processOf(address_t page) const;
+
+    /* floor of log2, exact for 64 bits */
+    static unsigned int log2(address_t);
+
+    /* copy-on-write */
+    void fork(unsigned int parent, unsigned int child); /* child must have no pages yet */
+    bool isShared(address_t) const;                     /* frame or swap slot is used by another page too */
+    bool isFrameShared(address_t) const;
+    address_t primary(address_t) const; /* same address in the primary page of the frame */
+    /* moves one side of the shared frame to the given empty frame, returns the address of its primary page */
+    address_t split(address_t address, address_t frame);
+    void privateSlot(address_t address); /* a swap slot of its own, the frame becomes modified */
+    address_t slotOf(address_t page) const;
+    unsigned int frameRefs(address_t frame) const;
+
+    /* huge pages, page keys unless stated otherwise */
+    void setHugeBits(unsigned int);
+    address_t hugePages() const; /* base pages in a huge page, 1 if huge pages are off */
+    address_t headOf(address_t page) const;
+    bool isHuge(address_t address) const;
+    bool isTail(address_t page) const;
+    bool isRegionEmpty(address_t head) const; /* no page of the region is present */
+    bool isHot(address_t head) const;         /* every page is present, referenced and not shared */
+    void mapHuge(address_t head, address_t frame);
+    void makeHuge(address_t head); /* the pages must already be in their frames */
+    void demote(address_t head);
+    void swapFrames(address_t frame1, address_t frame2);
+    address_t frameOf(address_t page) const;
+    bool isMovable(address_t frame) const; /* holds one private base page, @see swapFrames() */
+    void takeShootdowns(std::vector<address_t> &pages);
+
+    /* snapshot of the entries, the frame table, the swap slots and the huge page size.
+       load needs a table with no mapping yet */
+    void save(SnapshotWriter &) const;
+    void load(SnapshotReader &);
+
 private:
-    unsigned int frame_size_;
-    unsigned int num_virtual_;
-    unsigned int num_physical_;
+    address_t frame_size_;
+    address_t num_virtual_; /* pages of one process */
+    address_t num_physical_;
+    unsigned int num_processes_;
+    unsigned int process_bits_;
+    address_t num_pages_; /* keys of all processes */
     unsigned int high_order_size_;
     unsigned int low_order_size_;
 
-    unsigned int high_order_mask_;
-    unsigned int low_order_mask_;
+    address_t high_order_mask_;
+    address_t low_order_mask_;
 
     unsigned int virtual_address_bits_;
     unsigned int physical_address_bits_;
 
-    Entry *table_;
+    /* radix trees of the entries, one per process */
+    static const unsigned int kLevelBits;
+    unsigned int depth_; /* number of levels, the last one holds the entries */
+    std::vector<void **> roots_;
+    static const Entry kAbsent; /* stands for the entries of leaves that are not allocated */
+
+    address_t *frames_; /* page number mapped into each frame, may be stale once the page is not present */
+
+    /* bits of the page in each frame, structure of arrays so the algorithms clear and scan 64 frames a word.
+       the R/M bits of a shared frame are the ones of its primary page, of a huge page the ones of its head.
+       resident: the frame holds a candidate for eviction, a present primary page that is not a tail */
+    BitVector referenced_;
+    BitVector modified_;
+    BitVector resident_;
+
+    std::map<address_t, std::vector<address_t>> sharers_; /* frame -> pages mapping it besides the primary one */
+    std::map<address_t, unsigned int> slot_refs_;         /* slots with more than one page, one is implicit */
+    std::vector<address_t> free_slots_;
+    address_t next_slot_; /* spare slots come after the slots of all keys */
+
+    unsigned int huge_bits_;
+    std::vector<address_t> shootdowns_;
 
     void initHighOrderMask();
     void initLowOrderMask();
-    unsigned int getHighOrder(unsigned int) const;
-    unsigned int getLowOrder(unsigned int) const;
+    address_t getHighOrder(address_t) const;
+    address_t getLowOrder(address_t) const;
+
+    void setNthBit(address_t &, unsigned int);
+
+    Entry &getEntry(address_t);
+    const Entry &getEntry(address_t) const;
+
+    /* entries by page number */
+    Entry &entryAt(address_t page);
+    const Entry &entryAt(address_t page) const;
+    Entry *findLeaf(address_t page, bool allocate) const;
+    void freeLevel(void **node, unsigned int level);
+    void printLevel(void **node, unsigned int level, address_t base) const;
+
+    struct EntryRecord /* an entry in the snapshot */
+    {
+        uint64_t page;
+        uint64_t frame;
+        uint64_t slot;
+        uint8_t flags; /* present, referenced, modified and huge from the lowest bit */
+        uint8_t padding[7];
+    };
+    void saveLevel(void **node, unsigned int level, address_t base, unsigned int process,
+                   std::vector<EntryRecord> &records) const;
 
-    void setNthBit(unsigned int &, unsigned int);
+    /* page number mapped into the frame, kNoPage if the frame is empty */
+    address_t pageOf(address_t frame) const;
 
-    Entry &getEntry(unsigned int);
-    const Entry &getEntry(unsigned int) const;
+    /* unmaps the page and every sharer of its frame */
+    void evict(address_t page);
+
+    void forkLevel(void **node, unsigned int level, address_t base, unsigned int parent, unsigned int child);
+    void share(address_t page, address_t source);
+    void refSlot(address_t slot);
+    void unrefSlot(address_t slot);
+    address_t newSlot();
 };
 
-PageTable::PageTable(unsigned int frameSize, unsigned int numPhysical, unsigned int numVirtual)
+const address_t PageTable::kNoPage = ~(address_t)0;
+const unsigned int PageTable::kLevelBits = 9;
+const PageTable::Entry PageTable::kAbsent;
+
+PageTable::PageTable(address_t frameSize, address_t numPhysical, address_t numVirtual, unsigned int numProcesses)
     : frame_size_(frameSize),
       num_virtual_(numVirtual),
-      num_physical_(numPhysical)
+      num_physical_(numPhysical),
+      num_processes_(numProcesses),
+      referenced_(numPhysical),
+      modified_(numPhysical),
+      resident_(numPhysical)
 {
-    physical_address_bits_ = std::log2(numPhysical * frame_size_);
-    virtual_address_bits_ = std::log2(numVirtual * frame_size_);
+    if (num_processes_ == 0)
+        throw std::logic_error("page table needs at least one process!");
+    process_bits_ = log2(num_processes_);
+    if (((address_t)1 << process_bits_) < num_processes_) /* rounded up */
+        process_bits_++;
+
+    low_order_size_ = log2(frame_size_);
+    if (low_order_size_ + log2(num_virtual_) + process_bits_ > 64 || low_order_size_ + log2(num_physical_) > 64)
+        throw std::logic_error("address space can't be greater than 64 bits!");
 
-    low_order_size_ = std::log2(frame_size_);
-    high_order_size_ = virtual_address_bits_ - high_order_size_;
+    physical_address_bits_ = low_order_size_ + log2(num_physical_);
+    virtual_address_bits_ = low_order_size_ + log2(num_virtual_);
+    high_order_size_ = virtual_address_bits_ - low_order_size_;
+    num_pages_ = (address_t)num_processes_ << high_order_size_;
 
     initHighOrderMask();
     initLowOrderMask();
 
-    table_ = new Entry[num_virtual_];
+    /* enough levels to resolve all bits of a page number, one level at least */
+    depth_ = (high_order_size_ + kLevelBits - 1) / kLevelBits;
+    if (depth_ == 0)
+        depth_ = 1;
+    roots_.assign(num_processes_, nullptr);
+    next_slot_ = num_pages_;
+    huge_bits_ = 0;
+
+    frames_ = new address_t[num_physical_];
+    for (address_t i = 0; i < num_physical_; i++)
+        frames_[i] = kNoPage;
+}
+
+unsigned int PageTable::log2(address_t n)
+{
+    unsigned int bits = 0;
+    while (n > 1)
+    {
+        n >>= 1;
+        bits++;
+    }
+    return bits;
 }
 
-bool PageTable::isPresent(unsigned int address) const
+bool PageTable::isPresent(address_t address) const
 {
     return getEntry(address).present_;
 }
 
-void PageTable::setModified(unsigned int address)
+void PageTable::setModified(address_t address)
 {
-    getEntry(address).modified_ = true;
+    assert(getEntry(address).present_);
+    modified_.set(getEntry(address).page_frame_number_);
 }
 
-unsigned int PageTable::get(unsigned int address) const
+address_t PageTable::get(address_t address) const
 {
     assert(getEntry(address).present_);
-    unsigned int high_order_bits = getEntry(address).page_frame_number_ << low_order_size_;
-    unsigned int low_order_bits = getLowOrder(address);
+    address_t high_order_bits = getEntry(address).page_frame_number_ << low_order_size_;
+    address_t low_order_bits = getLowOrder(address);
     return high_order_bits | low_order_bits;
 }
 
-void PageTable::set(unsigned int virtual_address, unsigned int physical_index)
+void PageTable::set(address_t virtual_address, address_t physical_index)
 {
     assert(physical_index < num_physical_);
-    unsigned int virtual_index = getHighOrder(virtual_address);
-    assert(virtual_index < num_virtual_);
-    table_[virtual_index].page_frame_number_ = physical_index;
-    table_[virtual_index].present_ = true;
+    address_t virtual_index = getHighOrder(virtual_address);
+    assert(virtual_index < num_pages_);
+    Entry &entry = entryAt(virtual_index);
+    entry.page_frame_number_ = physical_index;
+    entry.present_ = true;
+
+    modified_.reset(physical_index);
+    referenced_.reset(physical_index);
+    resident_.set(physical_index);
+    frames_[physical_index] = virtual_index;
+    assert(sharers_.count(physical_index) == 0); /* the frame is evicted before, with its sharers */
+}
 
-    table_[virtual_index].modified_ = false;
-    table_[virtual_index].referenced_ = false;
+PageTable::Entry &PageTable::getEntry(address_t address)
+{
+    address_t index = getHighOrder(address);
+    assert(index < num_pages_);
+    return entryAt(index);
+}
+
+const PageTable::Entry &PageTable::getEntry(address_t address) const
+{
+    address_t index = getHighOrder(address);
+    assert(index < num_pages_);
+    return entryAt(index);
+}
+
+PageTable::Entry &PageTable::entryAt(address_t page)
+{
+    return findLeaf(page, true)[page & (num_virtual_ - 1) & (((address_t)1 << kLevelBits) - 1)];
+}
+
+const PageTable::Entry &PageTable::entryAt(address_t page) const
+{
+    Entry *leaf = findLeaf(page, false);
+    if (leaf == nullptr) /* never mapped */
+        return kAbsent;
+    return leaf[page & (num_virtual_ - 1) & (((address_t)1 << kLevelBits) - 1)];
+}
+
+PageTable::Entry *PageTable::findLeaf(address_t page, bool allocate) const
+{
+    const address_t fanout = (address_t)1 << kLevelBits;
+    assert(page < num_pages_);
+    /* the process picks the root, the levels resolve the page in the process */
+    void **const *slot = &roots_[page >> high_order_size_];
+    const address_t index = page & (num_virtual_ - 1);
+
+    for (unsigned int level = 0; level < depth_; level++)
+    {
+        if (*slot == nullptr)
+        {
+            if (!allocate)
+                return nullptr;
+            void **node;
+            if (level + 1 == depth_)
+                node = (void **)new Entry[fanout];
+            else
+                node = new void *[fanout]();
+            *const_cast<void ***>(slot) = node;
+        }
+        if (level + 1 == depth_)
+            break;
+
+        unsigned int shift = kLevelBits * (depth_ - 1 - level);
+        slot = (void **const *)&(*slot)[(index >> shift) & (fanout - 1)];
+    }
+    return (Entry *)*slot;
+}
+
+address_t PageTable::pageOf(address_t frame) const
+{
+    assert(frame < num_physical_);
+    address_t page = frames_[frame];
+    if (page == kNoPage)
+        return kNoPage;
+
+    /* the frame may be given to another page or the page may be evicted since */
+    const Entry &entry = entryAt(page);
+    if (!entry.present_ || entry.page_frame_number_ != frame)
+        return kNoPage;
+    return page;
+}
+
+void PageTable::evict(address_t page)
+{
+    Entry &entry = entryAt(page);
+    assert(entry.present_ && !isTail(page));
+
+    /* a huge page leaves as a whole */
+    address_t pages = entry.huge_ ? hugePages() : 1;
+    for (address_t i = 0; i < pages; i++)
+    {
+        Entry &member = entryAt(page + i);
+        resident_.reset(member.page_frame_number_);
+        member.present_ = false;
+        member.huge_ = false;
+        shootdowns_.push_back(page + i);
+
+        /* the sharers have the same slot, they are read back from there */
+        auto it = sharers_.find(member.page_frame_number_);
+        if (it == sharers_.end())
+            continue;
+        for (auto sharer : it->second)
+        {
+            entryAt(sharer).present_ = false;
+            shootdowns_.push_back(sharer);
+        }
+        sharers_.erase(it);
+    }
+}
+
+void PageTable::setHugeBits(unsigned int bits)
+{
+    for (auto root : roots_)
+        if (root != nullptr)
+            throw std::logic_error("huge pages must be set before the first mapping!");
+    if (bits > high_order_size_ || ((address_t)1 << bits) > num_physical_)
+        throw std::logic_error("huge page can't be bigger than the memory!");
+    huge_bits_ = bits;
+}
+
+address_t PageTable::hugePages() const
+{
+    return (address_t)1 << huge_bits_;
+}
+
+address_t PageTable::headOf(address_t page) const
+{
+    return page & ~(hugePages() - 1);
+}
+
+bool PageTable::isHuge(address_t address) const
+{
+    return getEntry(address).huge_;
+}
+
+bool PageTable::isTail(address_t page) const
+{
+    return entryAt(page).huge_ && page != headOf(page);
+}
+
+address_t PageTable::frameOf(address_t page) const
+{
+    assert(entryAt(page).present_);
+    return entryAt(page).page_frame_number_;
+}
+
+bool PageTable::isRegionEmpty(address_t head) const
+{
+    for (address_t i = 0; i < hugePages(); i++)
+        if (entryAt(head + i).present_)
+            return false;
+    return true;
+}
+
+bool PageTable::isHot(address_t head) const
+{
+    for (address_t i = 0; i < hugePages(); i++)
+    {
+        const Entry &entry = entryAt(head + i);
+        if (!entry.present_ || entry.huge_ || !referenced_.test(entry.page_frame_number_) ||
+            sharers_.count(entry.page_frame_number_) != 0)
+            return false;
+        if (frames_[entry.page_frame_number_] != head + i) /* a sharer of another frame */
+            return false;
+    }
+    return true;
+}
+
+void PageTable::mapHuge(address_t head, address_t frame)
+{
+    assert(frame % hugePages() == 0);
+    for (address_t i = 0; i < hugePages(); i++)
+    {
+        set((head + i) << low_order_size_, frame + i);
+        entryAt(head + i).huge_ = true;
+        if (i != 0) /* the tails go with their head */
+            resident_.reset(frame + i);
+    }
+}
+
+void PageTable::makeHuge(address_t head)
+{
+    address_t frame = entryAt(head).page_frame_number_;
+    assert(frame % hugePages() == 0);
+    for (address_t i = 0; i < hugePages(); i++)
+    {
+        Entry &entry = entryAt(head + i);
+        assert(entry.present_ && entry.page_frame_number_ == frame + i);
+        entry.huge_ = true;
+        shootdowns_.push_back(head + i);
+    }
+
+    /* the head takes the bits of the whole block */
+    if (referenced_.findFirst(frame, frame + hugePages()) != frame + hugePages())
+        referenced_.set(frame);
+    if (modified_.findFirst(frame, frame + hugePages()) != frame + hugePages())
+        modified_.set(frame);
+    for (address_t i = 1; i < hugePages(); i++)
+        resident_.reset(frame + i);
+}
+
+void PageTable::demote(address_t head)
+{
+    Entry &head_entry = entryAt(head);
+    assert(head_entry.huge_ && head == headOf(head));
+
+    /* the bits of the huge page hold for every base page of it */
+    address_t frame = head_entry.page_frame_number_;
+    for (address_t i = 0; i < hugePages(); i++)
+    {
+        entryAt(head + i).huge_ = false;
+        if (modified_.test(frame))
+            modified_.set(frame + i);
+        if (referenced_.test(frame))
+            referenced_.set(frame + i);
+        resident_.set(frame + i);
+    }
+    shootdowns_.push_back(head);
+}
+
+void PageTable::swapFrames(address_t frame1, address_t frame2)
+{
+    address_t page1 = pageOf(frame1), page2 = pageOf(frame2);
+    assert(page1 != kNoPage && page2 != kNoPage);
+    assert(sharers_.count(frame1) == 0 && sharers_.count(frame2) == 0);
+
+    entryAt(page1).page_frame_number_ = frame2;
+    entryAt(page2).page_frame_number_ = frame1;
+    frames_[frame1] = page2;
+    frames_[frame2] = page1;
+
+    /* the bits go with the pages, both frames stay resident */
+    bool referenced = referenced_.test(frame1), modified = modified_.test(frame1);
+    referenced_.assign(frame1, referenced_.test(frame2));
+    modified_.assign(frame1, modified_.test(frame2));
+    referenced_.assign(frame2, referenced);
+    modified_.assign(frame2, modified);
+    shootdowns_.push_back(page1);
+    shootdowns_.push_back(page2);
+}
+
+bool PageTable::isMovable(address_t frame) const
+{
+    address_t page = pageOf(frame);
+    return page != kNoPage && !entryAt(page).huge_ && sharers_.count(frame) == 0;
 }
 
-PageTable::Entry &PageTable::getEntry(unsigned int address)
+void PageTable::takeShootdowns(std::vector<address_t> &pages)
 {
-    unsigned int index = getHighOrder(address);
-    assert(index < num_virtual_);
-    return table_[index];
+    pages.clear();
+    pages.swap(shootdowns_);
 }
 
-const PageTable::Entry &PageTable::getEntry(unsigned int address) const
+address_t PageTable::slotOf(address_t page) const
 {
-    unsigned int index = getHighOrder(address);
-    assert(index < num_virtual_);
-    return table_[index];
+    const Entry &entry = entryAt(page);
+    return entry.swap_slot_ == kNoPage ? page : entry.swap_slot_;
+}
+
+unsigned int PageTable::frameRefs(address_t frame) const
+{
+    if (pageOf(frame) == kNoPage)
+        return 0;
+    auto it = sharers_.find(frame);
+    return it == sharers_.end() ? 1 : 1 + it->second.size();
+}
+
+void PageTable::refSlot(address_t slot)
+{
+    auto it = slot_refs_.find(slot);
+    if (it == slot_refs_.end())
+        slot_refs_.insert({slot, 2});
+    else
+        it->second++;
+}
+
+void PageTable::unrefSlot(address_t slot)
+{
+    auto it = slot_refs_.find(slot);
+    if (it != slot_refs_.end())
+    {
+        if (--it->second == 1)
+            slot_refs_.erase(it);
+    }
+    else if (slot >= num_pages_) /* the last page of a spare slot is gone */
+        free_slots_.push_back(slot);
+}
+
+address_t PageTable::newSlot()
+{
+    if (free_slots_.empty())
+        return next_slot_++;
+    address_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+}
+
+void PageTable::fork(unsigned int parent, unsigned int child)
+{
+    assert(parent < num_processes_ && child < num_processes_);
+    if (parent == child || roots_[child] != nullptr)
+        throw std::logic_error("fork needs an empty child process!");
+    if (roots_[parent] != nullptr)
+        forkLevel(roots_[parent], 0, 0, parent, child);
+}
+
+void PageTable::forkLevel(void **node, unsigned int level, address_t base, unsigned int parent, unsigned int child)
+{
+    const address_t fanout = (address_t)1 << kLevelBits;
+    for (address_t i = 0; i < fanout; i++)
+    {
+        address_t index = (base << kLevelBits) | i;
+        if (level + 1 == depth_)
+        {
+            if (index >= num_virtual_)
+                break;
+            share(((address_t)child << high_order_size_) | index, ((address_t)parent << high_order_size_) | index);
+        }
+        else if (node[i] != nullptr) /* pages that were never mapped are zero in both */
+            forkLevel((void **)node[i], level + 1, index, parent, child);
+    }
+}
+
+void PageTable::share(address_t page, address_t source)
+{
+    address_t slot = slotOf(source);
+    Entry &copy = entryAt(page);
+    const Entry &original = entryAt(source);
+
+    copy.swap_slot_ = slot;
+    refSlot(slot);
+    if (original.present_)
+    {
+        copy.present_ = true;
+        copy.page_frame_number_ = original.page_frame_number_;
+        sharers_[original.page_frame_number_].push_back(page);
+    }
+}
+
+bool PageTable::isFrameShared(address_t address) const
+{
+    const Entry &entry = getEntry(address);
+    return entry.present_ && sharers_.count(entry.page_frame_number_) != 0;
+}
+
+bool PageTable::isShared(address_t address) const
+{
+    return isFrameShared(address) || slot_refs_.count(slotOf(getHighOrder(address))) != 0;
+}
+
+address_t PageTable::primary(address_t address) const
+{
+    const Entry &entry = getEntry(address);
+    assert(entry.present_);
+    address_t page = frames_[entry.page_frame_number_];
+    if (entryAt(page).huge_) /* the huge page itself or a sharer of one of its frames */
+        page = headOf(page);
+    return (page << low_order_size_) | getLowOrder(address);
+}
+
+address_t PageTable::split(address_t address, address_t frame)
+{
+    address_t page = getHighOrder(address);
+    Entry &entry = entryAt(page);
+    address_t old = entry.page_frame_number_;
+    assert(sharers_.count(old) != 0 && pageOf(frame) == kNoPage);
+
+    std::vector<address_t> sharers = sharers_[old];
+    sharers_.erase(old);
+    /* the R/M bits of a huge page are in the frame of its head */
+    address_t bits = entryAt(frames_[old]).huge_ ? entryAt(headOf(frames_[old])).page_frame_number_ : old;
+
+    for (auto sharer : sharers)
+        shootdowns_.push_back(sharer);
+    shootdowns_.push_back(frames_[old]);
+
+    address_t moved; /* primary page in the new frame */
+    if (frames_[old] == page)
+    {
+        /* the writer keeps the frame and its place in the algorithm, the readers move */
+        moved = sharers.front();
+        for (auto sharer : sharers)
+            entryAt(sharer).page_frame_number_ = frame;
+        sharers.erase(sharers.begin());
+        if (!sharers.empty())
+            sharers_[frame] = sharers;
+    }
+    else
+    {
+        /* the writer moves alone */
+        moved = page;
+        sharers.erase(std::find(sharers.begin(), sharers.end(), page));
+        if (!sharers.empty())
+            sharers_[old] = sharers;
+        entry.page_frame_number_ = frame;
+    }
+
+    /* the copy is as dirty as the frame it comes from */
+    modified_.assign(frame, modified_.test(bits));
+    referenced_.assign(frame, referenced_.test(bits));
+    resident_.set(frame);
+    frames_[frame] = moved;
+    return moved << low_order_size_;
+}
+
+void PageTable::privateSlot(address_t address)
+{
+    address_t page = getHighOrder(address);
+    address_t slot = slotOf(page);
+    if (slot_refs_.count(slot) == 0)
+        return;
+
+    /* no copy on disc, the frame is written into the new slot when it is evicted */
+    unrefSlot(slot);
+    Entry &entry = entryAt(page);
+    assert(entry.present_);
+    entry.swap_slot_ = newSlot();
+    modified_.set(entry.page_frame_number_);
+}
+
+void PageTable::save(SnapshotWriter &out) const
+{
+    std::vector<EntryRecord> records;
+    for (unsigned int process = 0; process < num_processes_; process++)
+        if (roots_[process] != nullptr)
+            saveLevel(roots_[process], 0, 0, process, records);
+    out.put<uint64_t>(records.size());
+    out.write(records.data(), records.size() * sizeof(EntryRecord));
+
+    out.write(frames_, num_physical_ * sizeof(address_t));
+    out.put<uint64_t>(sharers_.size());
+    for (auto &sharers : sharers_)
+    {
+        out.put<uint64_t>(sharers.first);
+        out.put<uint64_t>(sharers.second.size());
+        out.write(sharers.second.data(), sharers.second.size() * sizeof(address_t));
+    }
+    out.put<uint64_t>(slot_refs_.size());
+    for (auto &refs : slot_refs_)
+    {
+        out.put<uint64_t>(refs.first);
+        out.put<uint64_t>(refs.second);
+    }
+    out.put<uint64_t>(free_slots_.size());
+    out.write(free_slots_.data(), free_slots_.size() * sizeof(address_t));
+    out.put<uint64_t>(next_slot_);
+    out.put<uint32_t>(huge_bits_);
+}
+
+void PageTable::saveLevel(void **node, unsigned int level, address_t base, unsigned int process,
+                          std::vector<EntryRecord> &records) const
+{
+    const address_t fanout = (address_t)1 << kLevelBits;
+    for (address_t i = 0; i < fanout; i++)
+    {
+        address_t index = (base << kLevelBits) | i;
+        if (level + 1 == depth_)
+        {
+            if (index >= num_virtual_)
+                break;
+            address_t page = ((address_t)process << high_order_size_) | index;
+            auto &entry = ((Entry *)node)[i];
+            if (!entry.present_ && !entry.huge_ && entry.swap_slot_ == kNoPage)
+                continue; /* same as an entry that is not allocated */
+            EntryRecord record = {page, entry.page_frame_number_, entry.swap_slot_, 0, {0}};
+            record.flags = entry.present_ | entry.huge_ << 3;
+            if (entry.present_)
+                record.flags |= referenced_.test(entry.page_frame_number_) << 1 | modified_.test(entry.page_frame_number_) << 2;
+            records.push_back(record);
+        }
+        else if (node[i] != nullptr)
+            saveLevel((void **)node[i], level + 1, index, process, records);
+    }
+}
+
+void PageTable::load(SnapshotReader &in)
+{
+    for (auto root : roots_)
+        if (root != nullptr)
+            throw std::logic_error("snapshot can only be loaded into an empty page table!");
+
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        EntryRecord record = in.get<EntryRecord>();
+        if (record.page >= num_pages_ || (record.flags & 1 && record.frame >= num_physical_))
+            throw std::logic_error("snapshot doesn't fit the page table!");
+        Entry &entry = entryAt(record.page);
+        entry.page_frame_number_ = record.frame;
+        entry.swap_slot_ = record.slot;
+        entry.present_ = record.flags & 1;
+        entry.huge_ = record.flags & 8;
+        if (entry.present_) /* the sharers of a frame carry the same bits */
+        {
+            referenced_.assign(record.frame, record.flags & 2);
+            modified_.assign(record.frame, record.flags & 4);
+        }
+    }
+
+    memcpy(frames_, in.read(num_physical_ * sizeof(address_t)), num_physical_ * sizeof(address_t));
+    for (address_t frame = 0; frame < num_physical_; frame++)
+    {
+        address_t page = pageOf(frame);
+        resident_.assign(frame, page != kNoPage && !isTail(page));
+    }
+    count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        address_t frame = in.get<uint64_t>();
+        uint64_t pages = in.get<uint64_t>();
+        auto &sharers = sharers_[frame];
+        for (uint64_t j = 0; j < pages; j++)
+            sharers.push_back(in.get<uint64_t>());
+    }
+    count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        address_t slot = in.get<uint64_t>();
+        slot_refs_[slot] = in.get<uint64_t>();
+    }
+    count = in.get<uint64_t>();
+    for (uint64_t i = 0; i < count; i++)
+        free_slots_.push_back(in.get<uint64_t>());
+    next_slot_ = in.get<uint64_t>();
+    huge_bits_ = in.get<uint32_t>();
+    if (huge_bits_ > high_order_size_ || hugePages() > num_physical_)
+        throw std::logic_error("snapshot doesn't fit the page table!");
 }
 
 void PageTable::initLowOrderMask()
 {
-    low_order_mask_ = ((unsigned int)1 << low_order_size_) - 1;
+    low_order_mask_ = ((address_t)1 << low_order_size_) - 1;
 }
 
 void PageTable::initHighOrderMask()
 {
     // high_order_mask_ = ~(frame_size_-1);
     high_order_mask_ = 0;
-    for (size_t i = low_order_size_; i < virtual_address_bits_; i++)
+    for (size_t i = low_order_size_; i < virtual_address_bits_ + process_bits_; i++)
         setNthBit(high_order_mask_, i);
 }
 
-void PageTable::setNthBit(unsigned int &number, unsigned int n)
+void PageTable::setNthBit(address_t &number, unsigned int n)
 {
-    number = ((1 << n) | number);
+    assert(n < 64);
+    number = (((address_t)1 << n) | number);
 }
 
-unsigned int PageTable::getHighOrder(unsigned int address) const
+address_t PageTable::getHighOrder(address_t address) const
 {
     return (address & high_order_mask_) >> low_order_size_;
 }
 
-unsigned int PageTable::getLowOrder(unsigned int address) const
+address_t PageTable::getLowOrder(address_t address) const
 {
     return address & low_order_mask_;
 }
 
-void PageTable::print() const
+address_t PageTable::tag(unsigned int process, address_t address) const
 {
-    std::cout << "{ Page Table }\n";
-    for (size_t i = 0; i < num_virtual_; i++)
-    {
-        auto &entry = table_[i];
-        std::cout << "\tindex: " << i << "\t[ referenced: " << entry.referenced_;
-        std::cout << " modified: " << entry.modified_;
-        std::cout << " present: "<<  entry.present_;
-        std::cout << " page frame: " << entry.page_frame_number_ << " ]\n";
-    }
-    
+    assert(process < num_processes_);
+    if (process_bits_ == 0)
+        return address;
+    return ((address_t)process << virtual_address_bits_) | address;
 }
 
-PageTable::~PageTable()
+unsigned int PageTable::processOf(address_t page) const
 {
-    delete[] table_;
+    return page >> high_order_size_;
 }
 
-PageTable::Entry::Entry() : referenced_(false), modified_(false), present_(false), page_frame_number_(0)
+void PageTable::print() const
 {
-    /** intentionally left blank **/
+    std::cout << "{ Page Table }\n";
+    for (unsigned int process = 0; process < num_processes_; process++)
+    {
+        if (roots_[process] == nullptr)
+            continue;
+        if (num_processes_ > 1)
+            std::cout << "  process " << process << "\n";
+        printLevel(roots_[process], 0, 0);
+    }
 }
 
-bool PageTable::Entry::isReferenced() const
+void PageTable::printLevel(void **node, unsigned int level, address_t base) const
 {
-    return referenced_;
+    const address_t fanout = (address_t)1 << kLevelBits;
+    for (address_t i = 0; i < fanout; i++)
+    {
+        address_t index = (base << kLevelBits) | i;
+        if (level + 1 == depth_)
+        {
+            if (index >= num_virtual_)
+                break;
+            auto &entry = ((Entry *)node)[i];
+            bool referenced = entry.present_ && referenced_.test(entry.page_frame_number_);
+            bool modified = entry.present_ && modified_.test(entry.page_frame_number_);
+            std::cout << "\tindex: " << index << "\t[ referenced: " << referenced;
+            std::cout << " modified: " << modified;
+            std::cout << " present: " << entry.present_;
+            std::cout << " page frame: " << entry.page_frame_number_ << " ]\n";
+        }
+        else if (node[i] != nullptr) /* sub-trees that were never mapped are skipped */
+            printLevel((void **)node[i], level + 1, index);
+    }
 }
 
-bool PageTable::Entry::isModified() const
+void PageTable::freeLevel(void **node, unsigned int level)
 {
-    return modified_;
+    if (level + 1 == depth_)
+    {
+        delete[](Entry *) node;
+        return;
+    }
+
+    const address_t fanout = (address_t)1 << kLevelBits;
+    for (address_t i = 0; i < fanout; i++)
+        if (node[i] != nullptr)
+            freeLevel((void **)node[i], level + 1);
+    delete[] node;
 }
 
-unsigned int PageTable::Entry::getFrameNumber() const
+PageTable::~PageTable()
 {
-    return page_frame_number_;
+    for (auto root : roots_)
+        if (root != nullptr)
+            freeLevel(root, 0);
+    delete[] frames_;
 }
 
-void PageTable::Entry::setReferenced(bool val)
+PageTable::Entry::Entry()
+    : present_(false), page_frame_number_(0), swap_slot_(kNoPage), huge_(false)
 {
-    referenced_ = val;
+    /** intentionally left blank **/
 }
-void PageTable::Entry::setModified(bool val)
+
+address_t PageTable::Entry::getFrameNumber() const
 {
-    modified_ = val;
+    return page_frame_number_;
 }
 
 void PageTable::Entry::setPresent(bool present)
@@ -225,4 +936,9 @@ bool PageTable::Entry::isPresent() const
     return present_;
 }
 
-#endif
\ No newline at end of file
+bool PageTable::Entry::isHuge() const
+{
+    return huge_;
+}
+
+#endif
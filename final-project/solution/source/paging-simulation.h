@@ -4,7 +4,11 @@
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <queue>
+#include <sstream>
+#include <functional>
 #include "virtual-memory.h"
+#include "workload.h"
 
 #define THREAD_NUM 4
 
@@ -22,6 +26,12 @@ public:
     void findOptimalSize();
     void findOptimalAlgorithm();
     void workingSetData();
+    void runWorkloads(std::vector<Workload *> workloads);
+    void runProcesses(std::vector<Workload *> workloads);
+
+    /* the sorter of every quarter by name: its own one of QUARTER_NAMES or a page aware one of
+       PAGE_AWARE_NAMES, which can sort any quarter. a sorter can sort one quarter only */
+    void setSorters(std::vector<std::string>);
 
     enum class Quarter
     {
@@ -35,6 +45,11 @@ private:
     std::thread sorter_threads_[THREAD_NUM]; /* 4 different sorting threads */
     std::mutex *memory_mutex_;
     VirtualMemory *memory_;
+    StatsSeries *stats_series_; /* null unless an interval is given */
+    WorkingSet *working_set_;   /* measures the working set column of the series, for any algorithm */
+    char *sorters_[THREAD_NUM]; /* names of the threads sorting the quarters */
+    std::string checkpoint_file_; /* the filled memory is saved here, unless empty */
+    std::string resume_file_;     /* the filled memory is restored from here instead of filling it, unless empty */
 
     unsigned int memory_size_;
 
@@ -43,6 +58,14 @@ private:
     void mergeSort();
     void indexSort();
 
+    /* page aware sorters, they know the frame size and move whole pages at once */
+    void blockMergeSort(Quarter);
+    void funnelSort(Quarter); /* cache-oblivious, doesn't know the frame size */
+    void bulkQuickSort(Quarter);
+
+    void runSorter(Quarter);
+    void sortQuarters(); /* the sorters of all quarters in parallel, under their partition */
+
     /* helper functions for sorting algorithms */
     void swap(unsigned int, unsigned int, char *tName);
     void getBounds(Quarter, unsigned int &, unsigned int &);
@@ -55,11 +78,59 @@ private:
     void merge(int low, int high, int mid);
     void mergeSortHelper(int l, int r);
 
+    /* page aware helpers, the blocks are read and written a page at a time under the lock */
+    void readBlock(unsigned int index, int *buffer, unsigned int count, char *tName);
+    void writeBlock(unsigned int index, const int *buffer, unsigned int count, char *tName);
+    void mergeRuns(unsigned int low, unsigned int high, unsigned int run);
+    void bulkQuickSortHelper(unsigned int low, unsigned int high);
+    unsigned int bulkPartition(unsigned int low, unsigned int high);
+    void funnelSortHelper(unsigned int low, unsigned int high);
+
+    /* k-merger of the funnel sort, a binary tree over the sorted segments. a node merges its children into
+       its buffer when the buffer runs empty, a leaf reads its segment from the memory */
+    struct FunnelNode
+    {
+        int left;  /* -1 for a leaf */
+        int right;
+        unsigned int next; /* of the segment of a leaf */
+        unsigned int end;
+        std::vector<int> buffer;
+        size_t head; /* the next one to take from the buffer */
+        size_t capacity;
+        bool done; /* nothing left below */
+    };
+    int buildFunnel(std::vector<FunnelNode> &, const std::vector<std::pair<unsigned int, unsigned int>> &segments,
+                    size_t first, size_t last);
+
+    /* output of a merge in place, a page at a time. the slots are the pages of the merged group counted from its
+       low end, a full output page goes to its own slot or to any other slot whose input is read already, and
+       the pages are moved to their own slots at the end. so the host keeps a page of output, not the group */
+    struct MergeOutput
+    {
+        unsigned int low;
+        unsigned int high;
+        std::vector<unsigned int> unread; /* elements of every slot not read yet */
+        std::vector<unsigned int> held;   /* the output page in every slot, kNoPage if none */
+        std::vector<unsigned int> free;   /* slots read up, not all of them still empty */
+        std::vector<int> page;            /* the output page being merged */
+        std::queue<std::vector<int>> pending; /* full pages waiting for a slot */
+        unsigned int written;             /* output pages in the slots */
+    };
+    void fillFunnel(std::vector<FunnelNode> &, int node, MergeOutput &);
+
+    void initOutput(MergeOutput &, unsigned int low, unsigned int high);
+    unsigned int slotSize(const MergeOutput &, unsigned int slot);
+    void markRead(MergeOutput &, unsigned int index, unsigned int count);
+    void pushOutput(MergeOutput &, int value, char *tName);
+    void flushOutput(MergeOutput &, char *tName);
+    void finishOutput(MergeOutput &, char *tName);
+
     void initMemory(int argc, char const *argv[]);
 
     bool check();
     static const Quarter QUARTERS[THREAD_NUM];
     static const std::string QUARTER_NAMES[THREAD_NUM];
+    static const std::string PAGE_AWARE_NAMES[3];
     static const std::string ALGORITHM_NAMES[5];
 
     void startSorters(std::vector<Stats> sorters[THREAD_NUM], unsigned int, std::string, std::string, int);
@@ -72,6 +143,15 @@ private:
     static char kMerge[];
     static char kIndex[];
     static char kCheck[];
+    static char kBlockMerge[];
+    static char kFunnel[];
+    static char kBulkQuick[];
+    static const char *kWorkingSetLog;
+    static const char *kStatsSeries;
+    static const std::vector<uint64_t> kWorkingSetWindows; /* in accesses of a thread, the first one is reported */
+    static const unsigned int kMergeWays;  /* runs merged at once by the block merge sort */
+    static const unsigned int kFunnelBase; /* the funnel sort sorts smaller segments directly */
+    static const unsigned int kNoPage;
 };
 
 const PagingSimulation::Quarter PagingSimulation::QUARTERS[] = {
@@ -82,6 +162,7 @@ const PagingSimulation::Quarter PagingSimulation::QUARTERS[] = {
 };
 
 const std::string PagingSimulation::QUARTER_NAMES[] = {"bubble", "quick", "merge", "index"};
+const std::string PagingSimulation::PAGE_AWARE_NAMES[] = {"block-merge", "funnel", "bulk-quick"};
 const std::string PagingSimulation::ALGORITHM_NAMES[] = {"NRU", "FIFO", "SC", "LRU", "WSClock"};
 
 char PagingSimulation::kFill[] = "fill";
@@ -90,17 +171,83 @@ char PagingSimulation::kQuick[] = "quick";
 char PagingSimulation::kMerge[] = "merge";
 char PagingSimulation::kIndex[] = "index";
 char PagingSimulation::kCheck[] = "check";
-
-PagingSimulation::PagingSimulation() : memory_mutex_(new std::mutex()), memory_(nullptr)
+char PagingSimulation::kBlockMerge[] = "block-merge";
+char PagingSimulation::kFunnel[] = "funnel";
+char PagingSimulation::kBulkQuick[] = "bulk-quick";
+const char *PagingSimulation::kWorkingSetLog = "working-set.events";
+const char *PagingSimulation::kStatsSeries = "stats-series.csv";
+const std::vector<uint64_t> PagingSimulation::kWorkingSetWindows = {1000, 100, 10000};
+const unsigned int PagingSimulation::kMergeWays = 8;
+const unsigned int PagingSimulation::kFunnelBase = 16;
+const unsigned int PagingSimulation::kNoPage = -1;
+
+PagingSimulation::PagingSimulation() : memory_mutex_(new std::mutex()), memory_(nullptr), stats_series_(nullptr), working_set_(nullptr)
 {
-    /* */
+    setSorters(std::vector<std::string>(QUARTER_NAMES, QUARTER_NAMES + THREAD_NUM));
 }
 
-PagingSimulation::PagingSimulation(int argc, char const *argv[]) : memory_mutex_(new std::mutex())
+PagingSimulation::PagingSimulation(int argc, char const *argv[])
+    : memory_mutex_(new std::mutex()), stats_series_(nullptr), working_set_(nullptr)
 {
+    setSorters(std::vector<std::string>(QUARTER_NAMES, QUARTER_NAMES + THREAD_NUM));
     initMemory(argc, argv);
 }
 
+void PagingSimulation::setSorters(std::vector<std::string> names)
+{
+    if (names.size() != THREAD_NUM)
+        throw std::invalid_argument("a sorter for each of the 4 quarters is needed!");
+
+    char *own[THREAD_NUM] = {kBubble, kQuick, kMerge, kIndex};
+    char *page_aware[] = {kBlockMerge, kFunnel, kBulkQuick};
+    char *sorters[THREAD_NUM];
+    for (size_t i = 0; i < THREAD_NUM; i++)
+    {
+        if (names[i] == QUARTER_NAMES[i])
+            sorters[i] = own[i];
+        else
+        {
+            auto it = std::find(PAGE_AWARE_NAMES, PAGE_AWARE_NAMES + 3, names[i]);
+            if (it == PAGE_AWARE_NAMES + 3)
+                throw std::invalid_argument("no such sorter for the quarter " + std::to_string(i + 1) + ": " + names[i]);
+            sorters[i] = page_aware[it - PAGE_AWARE_NAMES];
+        }
+        if (std::find(sorters, sorters + i, sorters[i]) != sorters + i)
+            throw std::invalid_argument("a sorter can sort one quarter only: " + names[i]);
+    }
+    std::copy(sorters, sorters + THREAD_NUM, sorters_);
+}
+
+void PagingSimulation::runSorter(Quarter quarter)
+{
+    char *name = sorters_[(size_t)quarter];
+    if (name == kBlockMerge)
+        blockMergeSort(quarter);
+    else if (name == kFunnel)
+        funnelSort(quarter);
+    else if (name == kBulkQuick)
+        bulkQuickSort(quarter);
+    else if (quarter == Quarter::FIRST)
+        bubbleSort();
+    else if (quarter == Quarter::SECOND)
+        quickSort();
+    else if (quarter == Quarter::THIRD)
+        mergeSort();
+    else
+        indexSort();
+}
+
+void PagingSimulation::sortQuarters()
+{
+    memory_->setPartition(std::vector<char *>(sorters_, sorters_ + THREAD_NUM));
+    for (size_t i = 0; i < THREAD_NUM; i++)
+        sorter_threads_[i] = std::thread(&PagingSimulation::runSorter, this, QUARTERS[i]);
+
+    /* wait for all quarters to finish */
+    for (size_t i = 0; i < THREAD_NUM; i++)
+        sorter_threads_[i].join();
+}
+
 void PagingSimulation::getBounds(PagingSimulation::Quarter quarter,
                                  unsigned int &lower_bound, unsigned int &upper_bound)
 {
@@ -180,24 +327,28 @@ void PagingSimulation::simulate()
     std::chrono::steady_clock sc;
     auto start = sc.now();
 
-    /* random filling */
-    std::cout << "Filling the array...\n";
-    memory_->setPartition({kFill});
-    memory_->fill(kFill);
-    memory_->resetPartition();
+    /* random filling, or the filled array of an earlier run */
+    if (resume_file_.empty())
+    {
+        std::cout << "Filling the array...\n";
+        memory_->setPartition({kFill});
+        memory_->fill(kFill);
+        memory_->resetPartition();
+    }
+    else
+    {
+        std::cout << "Resuming from " << resume_file_ << "...\n";
+        memory_->restore(resume_file_);
+    }
+    if (!checkpoint_file_.empty())
+    {
+        memory_->checkpoint(checkpoint_file_);
+        std::cout << "Checkpoint is written to " << checkpoint_file_ << "\n";
+    }
 
     /* sorting quarters */
-    memory_->setPartition({kBubble, kQuick, kMerge, kIndex});
-
     std::cout << "Sorting...\n";
-    sorter_threads_[0] = std::thread(&PagingSimulation::bubbleSort, this);
-    sorter_threads_[1] = std::thread(&PagingSimulation::quickSort, this);
-    sorter_threads_[2] = std::thread(&PagingSimulation::mergeSort, this);
-    sorter_threads_[3] = std::thread(&PagingSimulation::indexSort, this);
-
-    /* wait for all quarters to finish */
-    for (size_t i = 0; i < THREAD_NUM; i++)
-        sorter_threads_[i].join();
+    sortQuarters();
     memory_->resetPartition();
 
     /* scan the array */
@@ -211,6 +362,8 @@ void PagingSimulation::simulate()
     /* print page table stats */
     // TODO. get stats and compare stuff.
     memory_->printStats();
+    if (stats_series_ != nullptr)
+        std::cout << stats_series_->getSamples() << " samples of the counters are written to " << kStatsSeries << "\n";
 
     std::cout << "Simulation finished!\nElapsed time:\t";
     auto end = sc.now();
@@ -301,30 +454,503 @@ void PagingSimulation::mergeSort()
     std::cout << "Merge Sort finished!" << std::endl;
 }
 
+void PagingSimulation::readBlock(unsigned int index, int *buffer, unsigned int count, char *tName)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    while (count > 0)
+    {
+        /* a page at a time, the other sorters get the lock in between */
+        unsigned int chunk = std::min(count, frame_size - index % frame_size);
+        memory_mutex_->lock();
+        memory_->read(index, buffer, chunk, tName);
+        memory_mutex_->unlock();
+        index += chunk;
+        buffer += chunk;
+        count -= chunk;
+    }
+}
+
+void PagingSimulation::writeBlock(unsigned int index, const int *buffer, unsigned int count, char *tName)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    while (count > 0)
+    {
+        unsigned int chunk = std::min(count, frame_size - index % frame_size);
+        memory_mutex_->lock();
+        memory_->write(index, buffer, chunk, tName);
+        memory_mutex_->unlock();
+        index += chunk;
+        buffer += chunk;
+        count -= chunk;
+    }
+}
+
+void PagingSimulation::blockMergeSort(Quarter quarter)
+{
+    unsigned int lower_bound, upper_bound;
+    getBounds(quarter, lower_bound, upper_bound);
+    unsigned int frame_size = memory_->getFrameSize();
+
+    /* the first runs are the pages, each one sorted in a buffer */
+    std::vector<int> page(frame_size);
+    for (unsigned int low = lower_bound; low < upper_bound; low += frame_size)
+    {
+        unsigned int count = std::min(frame_size, upper_bound - low);
+        readBlock(low, page.data(), count, kBlockMerge);
+        std::sort(page.begin(), page.begin() + count);
+        writeBlock(low, page.data(), count, kBlockMerge);
+    }
+
+    /* then every pass merges kMergeWays runs into one, so the array is read log_k(pages) times */
+    for (unsigned int run = frame_size; run < upper_bound - lower_bound; run *= kMergeWays)
+        for (unsigned int low = lower_bound; low < upper_bound; low += run * kMergeWays)
+            mergeRuns(low, low + std::min(run * kMergeWays, upper_bound - low), run);
+
+    std::cout << "Block Merge Sort finished!" << std::endl;
+}
+
+void PagingSimulation::mergeRuns(unsigned int low, unsigned int high, unsigned int run)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    unsigned int runs = (high - low + run - 1) / run;
+
+    /* a buffer of a page for every run, refilled with its next page when it runs empty */
+    std::vector<std::vector<int>> buffers(runs, std::vector<int>(frame_size));
+    std::vector<unsigned int> next(runs), end(runs), head(runs), size(runs);
+    MergeOutput output;
+    initOutput(output, low, high);
+    auto refill = [&](unsigned int r) {
+        size[r] = std::min(frame_size - (next[r] - low) % frame_size, end[r] - next[r]); /* one slot */
+        readBlock(next[r], buffers[r].data(), size[r], kBlockMerge);
+        markRead(output, next[r], size[r]);
+        next[r] += size[r];
+        head[r] = 0;
+    };
+
+    std::priority_queue<std::pair<int, unsigned int>, std::vector<std::pair<int, unsigned int>>,
+                        std::greater<std::pair<int, unsigned int>>>
+        heads; /* the smallest head of the runs on top */
+    for (unsigned int r = 0; r < runs; r++)
+    {
+        next[r] = low + r * run;
+        end[r] = std::min(next[r] + run, high);
+        refill(r);
+        heads.push({buffers[r][0], r});
+    }
+
+    /* the runs are read from the memory they are written back to, the output pages take the slots the runs
+       are read out of. every run reads a slot ahead of what it gives, so a slot is free for every full page */
+    while (!heads.empty())
+    {
+        unsigned int r = heads.top().second;
+        pushOutput(output, heads.top().first, kBlockMerge);
+        heads.pop();
+        if (++head[r] == size[r] && next[r] < end[r])
+            refill(r);
+        if (head[r] < size[r])
+            heads.push({buffers[r][head[r]], r});
+    }
+    finishOutput(output, kBlockMerge);
+}
+
+void PagingSimulation::initOutput(MergeOutput &output, unsigned int low, unsigned int high)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    unsigned int slots = (high - low + frame_size - 1) / frame_size;
+    output.low = low;
+    output.high = high;
+    output.unread.resize(slots);
+    for (unsigned int slot = 0; slot < slots; slot++)
+        output.unread[slot] = slotSize(output, slot);
+    output.held.assign(slots, kNoPage);
+    output.free.clear();
+    output.page.clear();
+    output.page.reserve(frame_size);
+    output.written = 0;
+}
+
+unsigned int PagingSimulation::slotSize(const MergeOutput &output, unsigned int slot)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    return std::min(frame_size, output.high - output.low - slot * frame_size);
+}
+
+void PagingSimulation::markRead(MergeOutput &output, unsigned int index, unsigned int count)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    while (count > 0)
+    {
+        unsigned int slot = (index - output.low) / frame_size;
+        unsigned int chunk = std::min(count, output.low + (slot + 1) * frame_size - index);
+        output.unread[slot] -= chunk;
+        /* a short last slot only fits the last page, which takes its own slot anyway */
+        if (output.unread[slot] == 0 && slotSize(output, slot) == frame_size)
+            output.free.push_back(slot);
+        index += chunk;
+        count -= chunk;
+    }
+}
+
+void PagingSimulation::pushOutput(MergeOutput &output, int value, char *tName)
+{
+    output.page.push_back(value);
+    if (output.page.size() < slotSize(output, output.written + output.pending.size()))
+        return;
+    output.pending.push(std::move(output.page));
+    output.page.clear();
+    output.page.reserve(memory_->getFrameSize());
+    flushOutput(output, tName);
+}
+
+void PagingSimulation::flushOutput(MergeOutput &output, char *tName)
+{
+    while (!output.pending.empty())
+    {
+        /* its own slot if that one is read up, it saves a move at the end */
+        unsigned int page = output.written, slot = page;
+        if (output.unread[slot] != 0 || output.held[slot] != kNoPage)
+        {
+            while (!output.free.empty() && output.held[output.free.back()] != kNoPage)
+                output.free.pop_back();
+            if (output.free.empty())
+                return; /* the page waits until a slot is read up */
+            slot = output.free.back();
+            output.free.pop_back();
+        }
+        const std::vector<int> &values = output.pending.front();
+        writeBlock(output.low + slot * memory_->getFrameSize(), values.data(), values.size(), tName);
+        output.held[slot] = page;
+        output.written++;
+        output.pending.pop();
+    }
+}
+
+void PagingSimulation::finishOutput(MergeOutput &output, char *tName)
+{
+    if (!output.page.empty())
+    {
+        output.pending.push(std::move(output.page));
+        output.page.clear();
+    }
+    flushOutput(output, tName); /* all of the input is read, every page finds a slot */
+
+    /* every cycle of misplaced pages is moved along with two page buffers */
+    unsigned int frame_size = memory_->getFrameSize();
+    std::vector<int> moving(frame_size), next(frame_size);
+    for (unsigned int start = 0; start < output.held.size(); start++)
+    {
+        if (output.held[start] == start)
+            continue;
+        readBlock(output.low + start * frame_size, moving.data(), slotSize(output, start), tName);
+        unsigned int slot = output.held[start];
+        while (true)
+        {
+            unsigned int after = output.held[slot];
+            if (slot != start)
+                readBlock(output.low + slot * frame_size, next.data(), slotSize(output, slot), tName);
+            writeBlock(output.low + slot * frame_size, moving.data(), slotSize(output, slot), tName);
+            output.held[slot] = slot;
+            if (slot == start)
+                break;
+            std::swap(moving, next);
+            slot = after;
+        }
+    }
+}
+
+void PagingSimulation::bulkQuickSort(Quarter quarter)
+{
+    unsigned int lower_bound, upper_bound;
+    getBounds(quarter, lower_bound, upper_bound);
+
+    bulkQuickSortHelper(lower_bound, upper_bound);
+    std::cout << "Bulk Quick Sort finished!" << std::endl;
+}
+
+void PagingSimulation::bulkQuickSortHelper(unsigned int low, unsigned int high)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+    while (high - low > frame_size)
+    {
+        /* recursion on the smaller side, the stack stays logarithmic */
+        unsigned int pi = bulkPartition(low, high);
+        if (pi - low < high - pi)
+        {
+            bulkQuickSortHelper(low, pi);
+            low = pi + 1;
+        }
+        else
+        {
+            bulkQuickSortHelper(pi + 1, high);
+            high = pi;
+        }
+    }
+
+    /* at most a page or two, sorted in a buffer */
+    std::vector<int> rest(high - low);
+    readBlock(low, rest.data(), high - low, kBulkQuick);
+    std::sort(rest.begin(), rest.end());
+    writeBlock(low, rest.data(), high - low, kBulkQuick);
+}
+
+unsigned int PagingSimulation::bulkPartition(unsigned int low, unsigned int high)
+{
+    unsigned int frame_size = memory_->getFrameSize();
+
+    /* median of three as the pivot, moved to low */
+    memory_mutex_->lock();
+    unsigned int mid = low + (high - low) / 2;
+    int a = memory_->get(low, kBulkQuick), b = memory_->get(mid, kBulkQuick), c = memory_->get(high - 1, kBulkQuick);
+    unsigned int median = (a < b) ? (b < c ? mid : (a < c ? high - 1 : low)) : (a < c ? low : (b < c ? high - 1 : mid));
+    swap(low, median, kBulkQuick);
+    int pivot = memory_->get(low, kBulkQuick);
+    memory_mutex_->unlock();
+
+    /* a cursor from each end with the rest of its page in a buffer: the ones less than the pivot go to the left,
+       the others to the right. a page is written back only if something is swapped in it */
+    std::vector<int> left(frame_size), right(frame_size);
+    unsigned int i = low + 1, j = high;
+    while (i < j)
+    {
+        unsigned int left_end = std::min(i - i % frame_size + frame_size, j);
+        unsigned int right_begin = std::max((j - 1) - (j - 1) % frame_size, i);
+        if (left_end > right_begin) /* both cursors in the same page */
+            break;
+
+        unsigned int left_size = left_end - i, right_size = j - right_begin;
+        readBlock(i, left.data(), left_size, kBulkQuick);
+        readBlock(right_begin, right.data(), right_size, kBulkQuick);
+        unsigned int l = 0, r = right_size;
+        bool swapped = false;
+        while (true)
+        {
+            while (l < left_size && left[l] < pivot)
+                l++;
+            while (r > 0 && right[r - 1] >= pivot)
+                r--;
+            if (l == left_size || r == 0)
+                break;
+            std::swap(left[l++], right[--r]);
+            swapped = true;
+        }
+        if (swapped)
+        {
+            writeBlock(i, left.data(), left_size, kBulkQuick);
+            writeBlock(right_begin, right.data(), right_size, kBulkQuick);
+        }
+        i += l;
+        j = right_begin + r;
+    }
+
+    if (i < j)
+    {
+        std::vector<int> middle(j - i);
+        readBlock(i, middle.data(), j - i, kBulkQuick);
+        auto it = std::partition(middle.begin(), middle.end(), [pivot](int value) { return value < pivot; });
+        writeBlock(i, middle.data(), j - i, kBulkQuick);
+        i += it - middle.begin();
+    }
+
+    /* the pivot goes between the two sides */
+    memory_mutex_->lock();
+    swap(low, i - 1, kBulkQuick);
+    memory_mutex_->unlock();
+    return i - 1;
+}
+
+void PagingSimulation::funnelSort(Quarter quarter)
+{
+    unsigned int lower_bound, upper_bound;
+    getBounds(quarter, lower_bound, upper_bound);
+
+    funnelSortHelper(lower_bound, upper_bound);
+    std::cout << "Funnel Sort finished!" << std::endl;
+}
+
+void PagingSimulation::funnelSortHelper(unsigned int low, unsigned int high)
+{
+    unsigned int size = high - low;
+    if (size <= kFunnelBase)
+    {
+        std::vector<int> values(size);
+        memory_mutex_->lock();
+        for (unsigned int i = 0; i < size; i++)
+            values[i] = memory_->get(low + i, kFunnel);
+        std::sort(values.begin(), values.end());
+        for (unsigned int i = 0; i < size; i++)
+            memory_->set(low + i, values[i], kFunnel);
+        memory_mutex_->unlock();
+        return;
+    }
+
+    /* n^(1/3) segments of n^(2/3), sorted recursively and merged by a funnel of n^(1/3) inputs */
+    unsigned int count = std::max(2u, (unsigned int)std::ceil(std::cbrt((double)size)));
+    unsigned int segment = (size + count - 1) / count;
+    std::vector<std::pair<unsigned int, unsigned int>> segments;
+    for (unsigned int begin = low; begin < high; begin += segment)
+    {
+        unsigned int end = std::min(begin + segment, high);
+        funnelSortHelper(begin, end);
+        segments.push_back({begin, end});
+    }
+
+    std::vector<FunnelNode> funnel;
+    int root = buildFunnel(funnel, segments, 0, segments.size());
+    funnel[root].capacity = memory_->getFrameSize(); /* the root merges a page at a time */
+
+    /* the segments are read from where the output goes, the output pages take the slots read up by the leaves.
+       a page waits in the host while no slot is, at most about two for every segment */
+    MergeOutput output;
+    initOutput(output, low, high);
+    while (true)
+    {
+        fillFunnel(funnel, root, output);
+        if (funnel[root].done)
+            break;
+        for (int value : funnel[root].buffer)
+            pushOutput(output, value, kFunnel);
+    }
+    finishOutput(output, kFunnel);
+}
+
+int PagingSimulation::buildFunnel(std::vector<FunnelNode> &funnel,
+                                  const std::vector<std::pair<unsigned int, unsigned int>> &segments,
+                                  size_t first, size_t last)
+{
+    FunnelNode node;
+    node.head = 0;
+    node.done = false;
+    if (last - first == 1)
+    {
+        node.left = node.right = -1;
+        node.next = segments[first].first;
+        node.end = segments[first].second;
+        node.capacity = 1;
+    }
+    else
+    {
+        size_t mid = first + (last - first) / 2;
+        node.left = buildFunnel(funnel, segments, first, mid);
+        node.right = buildFunnel(funnel, segments, mid, last);
+        node.next = node.end = 0;
+        /* a subtree of j inputs buffers j^(3/2), the sizes of the recursive layout of a lazy funnel */
+        node.capacity = (size_t)std::ceil(std::pow((double)(last - first), 1.5));
+    }
+    funnel.push_back(node);
+    return funnel.size() - 1;
+}
+
+void PagingSimulation::fillFunnel(std::vector<FunnelNode> &funnel, int index, MergeOutput &output)
+{
+    FunnelNode &node = funnel[index];
+    node.buffer.clear();
+    node.head = 0;
+
+    if (node.left < 0)
+    {
+        for (; node.buffer.size() < node.capacity && node.next < node.end; node.next++)
+        {
+            memory_mutex_->lock();
+            node.buffer.push_back(memory_->get(node.next, kFunnel));
+            memory_mutex_->unlock();
+            markRead(output, node.next, 1);
+        }
+    }
+    else
+    {
+        FunnelNode &left = funnel[node.left], &right = funnel[node.right];
+        while (node.buffer.size() < node.capacity)
+        {
+            if (left.head == left.buffer.size() && !left.done)
+                fillFunnel(funnel, node.left, output);
+            if (right.head == right.buffer.size() && !right.done)
+                fillFunnel(funnel, node.right, output);
+
+            bool has_left = left.head < left.buffer.size(), has_right = right.head < right.buffer.size();
+            if (!has_left && !has_right)
+                break;
+            if (has_left && (!has_right || left.buffer[left.head] <= right.buffer[right.head]))
+                node.buffer.push_back(left.buffer[left.head++]);
+            else
+                node.buffer.push_back(right.buffer[right.head++]);
+        }
+    }
+
+    if (node.buffer.empty())
+        node.done = true;
+}
+
 void PagingSimulation::initMemory(int argc, char const *argv[])
 {
-    /* parsing arguments and initializing the memory */
+    /* parsing arguments and initializing the memory. the flags may come anywhere, the rest are positional */
+    std::vector<char const *> args;
+    for (int i = 0; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg != "--checkpoint" && arg != "--resume")
+            args.push_back(argv[i]);
+        else if (i + 1 == argc)
+            throw std::logic_error("missing file after " + arg);
+        else
+            (arg == "--checkpoint" ? checkpoint_file_ : resume_file_) = argv[++i];
+    }
+    argc = args.size();
+    argv = args.data();
+
     if (argc < 8)
         throw std::logic_error("missing arguments!");
 
     try
     {
-        unsigned int frame_size = std::stoi(argv[1]);
-        unsigned int num_physical = std::stoi(argv[2]);
-        unsigned int num_virtual = std::stoi(argv[3]);
+        unsigned int frame_bits = std::stoi(argv[1]);
+        unsigned int physical_bits = std::stoi(argv[2]);
+        unsigned int virtual_bits = std::stoi(argv[3]);
         std::string page_replacement = argv[4];
         std::string alloc_policy = argv[5];
         unsigned int print_int = std::stoi(argv[6]);
         std::string disc_name = argv[7];
-
-        frame_size = std::pow(2, frame_size);
-        num_physical = std::pow(2, num_physical);
-        num_virtual = std::pow(2, num_virtual);
-
+        unsigned int num_processes = argc > 8 ? std::stoi(argv[8]) : 1; /* optional */
+        unsigned int huge_bits = argc > 9 ? std::stoi(argv[9]) : 0;      /* optional, off by default */
+        std::string scheduler = argc > 10 ? argv[10] : "FCFS";            /* optional */
+        std::string interval = argc > 11 ? argv[11] : "";                 /* optional, "N" accesses or "Nms" */
+        std::string sorters = argc > 12 ? argv[12] : "";                  /* optional, one per quarter: "a,b,c,d" */
+
+        if (frame_bits >= 64 || physical_bits >= 64 || virtual_bits >= 64)
+            throw std::logic_error("sizes are given in bits and must be less than 64");
+        address_t frame_size = (address_t)1 << frame_bits;
+        address_t num_physical = (address_t)1 << physical_bits;
+        address_t num_virtual = (address_t)1 << virtual_bits;
+
+        /* the sorters index the array with unsigned ints */
+        if (frame_bits + virtual_bits >= 32)
+            throw std::logic_error("sorted array can't have more than 2^31 ints");
         memory_size_ = num_virtual * frame_size;
 
         memory_ = new VirtualMemory(frame_size, num_physical, num_virtual,
-                                    page_replacement, alloc_policy, print_int, disc_name);
+                                    page_replacement, alloc_policy, print_int, disc_name, num_processes);
+        memory_->setLock(memory_mutex_);
+        memory_->setHugePages(huge_bits);
+        memory_->setDiscScheduler(scheduler);
+
+        if (!interval.empty())
+        {
+            bool in_ms = interval.size() > 2 && interval.compare(interval.size() - 2, 2, "ms") == 0;
+            unsigned long every = std::stoul(in_ms ? interval.substr(0, interval.size() - 2) : interval);
+            stats_series_ = new StatsSeries(kStatsSeries, in_ms ? 0 : every, in_ms ? every : 0);
+            memory_->setStatsSeries(stats_series_);
+            working_set_ = new WorkingSet(kWorkingSetWindows);
+            memory_->setWorkingSet(working_set_);
+        }
+
+        if (!sorters.empty())
+        {
+            std::vector<std::string> names;
+            std::stringstream stream(sorters);
+            std::string name;
+            while (std::getline(stream, name, ','))
+                names.push_back(name);
+            setSorters(names);
+        }
     }
     catch (const std::exception &e)
     {
@@ -336,11 +962,14 @@ PagingSimulation::~PagingSimulation()
 {
     if (memory_ != nullptr)
         delete memory_;
+    delete stats_series_;
+    delete working_set_;
     delete memory_mutex_;
 }
 
 void PagingSimulation::print()
 {
+    std::lock_guard<std::mutex> lock(*memory_mutex_); /* faults release it during disc io */
     for (size_t i = 0; i < memory_size_; i++)
     {
         if (i % (memory_size_ / 4) == 0)
@@ -351,6 +980,7 @@ void PagingSimulation::print()
 
 bool PagingSimulation::check()
 {
+    std::lock_guard<std::mutex> lock(*memory_mutex_); /* faults release it during disc io */
     bool sorted = true;
 
     for (const auto &q : QUARTERS)
@@ -430,6 +1060,7 @@ void PagingSimulation::startSorters(std::vector<Stats> sorters[THREAD_NUM], unsi
         std::cout << ", virtual memory: " << virtual_num * frame_size << ")\n";
 
         memory_ = new VirtualMemory(frame_size, physical_num, virtual_num, algorithm, policy, print_period, "disc.dat");
+        memory_->setLock(memory_mutex_);
         memory_size_ = virtual_num * frame_size;
 
         std::cout << "Filling...\n";
@@ -437,23 +1068,13 @@ void PagingSimulation::startSorters(std::vector<Stats> sorters[THREAD_NUM], unsi
         memory_->fill(kFill);
         memory_->resetPartition();
 
-        memory_->setPartition({kBubble, kQuick, kMerge, kIndex});
         std::cout << "Sorting...\n";
-        sorter_threads_[0] = std::thread(&PagingSimulation::bubbleSort, this);
-        sorter_threads_[1] = std::thread(&PagingSimulation::quickSort, this);
-        sorter_threads_[2] = std::thread(&PagingSimulation::mergeSort, this);
-        sorter_threads_[3] = std::thread(&PagingSimulation::indexSort, this);
-
-        /* wait for all quarters to finish */
-        for (size_t i = 0; i < THREAD_NUM; i++)
-            sorter_threads_[i].join();
-        auto &stats = memory_->getStats();
+        sortQuarters();
+        auto stats = memory_->getStats();
         memory_->resetPartition();
 
-        sorters[0].push_back(stats.at(kBubble));
-        sorters[1].push_back(stats.at(kQuick));
-        sorters[2].push_back(stats.at(kMerge));
-        sorters[3].push_back(stats.at(kIndex));
+        for (size_t i = 0; i < THREAD_NUM; i++)
+            sorters[i].push_back(stats.at(sorters_[i]));
         delete memory_;
     }
     memory_ = nullptr;
@@ -473,7 +1094,7 @@ void PagingSimulation::findOptimalSize()
         auto it = std::min_element(sorter.begin(), sorter.end(),
                                    [](const Stats &s1, const Stats &s2) { return s1.page_repl < s2.page_repl; });
         unsigned int optimal_page_size = std::pow(2, std::distance(sorter.begin(), it));
-        std::cout << "Optimal page size for " << QUARTER_NAMES[i] << " is: " << optimal_page_size << std::endl;
+        std::cout << "Optimal page size for " << sorters_[i] << " is: " << optimal_page_size << std::endl;
     }
 }
 
@@ -505,8 +1126,94 @@ void PagingSimulation::findOptimalAlgorithm()
         auto &mean = means[i];
         auto it = std::min_element(mean.begin(), mean.end());
         std::string optimal_algorithm = ALGORITHM_NAMES[std::distance(mean.begin(), it)];
-        std::cout << "Optimal algorithm " << QUARTER_NAMES[i] << " is: " << optimal_algorithm << std::endl;
+        std::cout << "Optimal algorithm " << sorters_[i] << " is: " << optimal_algorithm << std::endl;
+    }
+}
+
+void PagingSimulation::runWorkloads(std::vector<Workload *> workloads)
+{
+    if (workloads.empty())
+        throw std::logic_error("no workloads to run!");
+
+    std::cout << "Starting ..\n";
+    std::chrono::steady_clock sc;
+    auto start = sc.now();
+
+    std::cout << "Filling the array...\n";
+    memory_->setPartition({kFill});
+    memory_->fill(kFill);
+    memory_->resetPartition();
+
+    /* every workload gets an equal slice of the virtual array, like the quarters of the sorters */
+    unsigned int slice_size = memory_size_ / workloads.size();
+    std::vector<char *> names;
+    for (size_t i = 0; i < workloads.size(); i++)
+    {
+        workloads[i]->bind(memory_, memory_mutex_, i * slice_size, (i + 1) * slice_size);
+        names.push_back(workloads[i]->getName());
+    }
+    memory_->setPartition(names);
+
+    std::cout << "Running workloads...\n";
+    std::vector<std::thread> threads;
+    for (auto &workload : workloads)
+        threads.push_back(std::thread(&Workload::run, workload));
+
+    /* wait for all workloads to finish */
+    for (auto &thread : threads)
+        thread.join();
+    memory_->resetPartition();
+
+    memory_->printStats();
+
+    std::cout << "Workloads finished!\nElapsed time:\t";
+    auto end = sc.now();
+    auto time_span = static_cast<std::chrono::duration<double>>(end - start);
+    std::cout << time_span.count() << " secs" << std::endl;
+}
+
+void PagingSimulation::runProcesses(std::vector<Workload *> workloads)
+{
+    if (workloads.empty())
+        throw std::logic_error("no workloads to run!");
+    if (workloads.size() > memory_->getProcessCount())
+        throw std::logic_error("not enough processes for the workloads, see the process count argument!");
+
+    std::cout << "Starting ..\n";
+    std::chrono::steady_clock sc;
+    auto start = sc.now();
+
+    std::cout << "Filling the arrays...\n";
+    memory_->setPartition({kFill});
+    for (unsigned int process = 0; process < workloads.size(); process++)
+        memory_->fill(process, kFill);
+    memory_->resetPartition();
+
+    /* every workload is a process of its own with the whole virtual array, only the frames are shared */
+    std::vector<char *> names;
+    for (size_t i = 0; i < workloads.size(); i++)
+    {
+        workloads[i]->bind(memory_, memory_mutex_, 0, memory_size_, i);
+        names.push_back(workloads[i]->getName());
     }
+    memory_->setPartition(names);
+
+    std::cout << "Running processes...\n";
+    std::vector<std::thread> threads;
+    for (auto &workload : workloads)
+        threads.push_back(std::thread(&Workload::run, workload));
+
+    /* wait for all processes to finish */
+    for (auto &thread : threads)
+        thread.join();
+    memory_->resetPartition();
+
+    memory_->printStats();
+
+    std::cout << "Processes finished!\nElapsed time:\t";
+    auto end = sc.now();
+    auto time_span = static_cast<std::chrono::duration<double>>(end - start);
+    std::cout << time_span.count() << " secs" << std::endl;
 }
 
 void PagingSimulation::workingSetData()
@@ -519,25 +1226,30 @@ void PagingSimulation::workingSetData()
     unsigned int virtual_num = std::pow(2, 10);
 
     memory_ = new VirtualMemory(frame_size, physical_num, virtual_num, "LRU", "local", 0, "disc.dat");
+    memory_->setLock(memory_mutex_);
     memory_size_ = virtual_num * frame_size;
 
+    /* working set samples go to a binary log, @see graph_script/os.py */
+    EventLog log(kWorkingSetLog);
+    memory_->setEventLog(&log);
+    WorkingSet workingSet(kWorkingSetWindows); /* the true working set, not the list of LRU */
+    memory_->setWorkingSet(&workingSet);
+
     memory_->setPartition({kFill});
     memory_->fill(kFill);
     memory_->resetPartition();
 
-    memory_->setPartition({kBubble, kQuick, kMerge, kIndex});
-    sorter_threads_[0] = std::thread(&PagingSimulation::bubbleSort, this);
-    sorter_threads_[1] = std::thread(&PagingSimulation::quickSort, this);
-    sorter_threads_[2] = std::thread(&PagingSimulation::mergeSort, this);
-    sorter_threads_[3] = std::thread(&PagingSimulation::indexSort, this);
-
-    /* wait for all quarters to finish */
-    for (size_t i = 0; i < THREAD_NUM; i++)
-        sorter_threads_[i].join();
+    sortQuarters();
     memory_->resetPartition();
 
-        delete memory_;
+    delete memory_;
     memory_ = nullptr;
+
+    log.close();
+    std::cout << "Working set data is written to " << kWorkingSetLog;
+    if (log.getDropped() != 0)
+        std::cout << " (" << log.getDropped() << " events dropped)";
+    std::cout << std::endl;
 }
 
 #endif
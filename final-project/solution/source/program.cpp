@@ -12,5 +12,15 @@ int main(int argc, char const *argv[])
     // simulation.findOptimalSize();
     // simulation.findOptimalAlgorithm();
     // simulation.workingSetData();
+
+    /* synthetic workloads instead of the sorters, @see workload.h */
+    // SequentialScan scan("scan", 2);
+    // Zipfian zipf("zipf", 100000);
+    // LoopingWorkingSet loop("loop", 4096, 8);
+    // MatrixMultiply matrix("matrix", 32, 8);
+    // simulation.runWorkloads({&scan, &zipf, &loop, &matrix});
+
+    /* the same workloads as separate processes, needs the process count as the 8th argument */
+    // simulation.runProcesses({&scan, &zipf, &loop, &matrix});
     return 0;
 }
@@ -0,0 +1,253 @@
+/**
+ * snapshot file of the simulation, @see VirtualMemory::checkpoint()
+ *
+ * file:
+ *  -> header: [magic | version | section count | (offset, size) of every section]
+ *  -> the sections, each one at an offset aligned to 8 bytes, the physical memory aligned to a page.
+ *
+ *  magic   : "VMSNAP" padded with zeros to 8 bytes.
+ *  version : kSnapshotVersion, a reader refuses the other versions.
+ *  section : one per SnapshotSection, size 0 if it is not written. values are in host byte order.
+ *
+ * the reader maps the whole file and hands out pointers into the mapping, so the physical memory is
+ * copied once from the page cache and nothing is parsed twice.
+ ***/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+enum class SnapshotSection : uint32_t
+{
+    GEOMETRY = 0,   /* sizes, policy and algorithm the snapshot is taken with */
+    MEMORY = 1,     /* physical frames */
+    PAGE_TABLE = 2, /* entries, frame table and swap slots */
+    ALGORITHM = 3,  /* free indices, working sets and the structures of the algorithm */
+    STATS = 4,      /* counters of every tName */
+    PROCESSES = 5,  /* per process counters */
+    DISC = 6,       /* the written extents of the disc */
+};
+
+#define SNAPSHOT_SECTIONS 7
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sections;
+    struct
+    {
+        uint64_t offset;
+        uint64_t size;
+    } table[SNAPSHOT_SECTIONS];
+};
+
+static const uint32_t kSnapshotVersion = 1;
+static const char kSnapshotMagic[8] = {'V', 'M', 'S', 'N', 'A', 'P', 0, 0};
+
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(std::string file);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+    /* the next writes go into the section until the next begin() or finish() */
+    void begin(SnapshotSection section, uint64_t alignment = 8);
+    void write(const void *data, uint64_t bytes);
+    void putString(const std::string &);
+    template <typename T>
+    void put(const T &value);
+
+    void finish(); /* writes the header, nothing can be written after */
+
+private:
+    int fd_;
+    uint64_t offset_;
+    int current_; /* -1 before the first section */
+    SnapshotHeader header_;
+
+    void end();
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(std::string file);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    /* the next reads come from the start of the section */
+    void seek(SnapshotSection section);
+    bool atEnd() const; /* of the current section */
+
+    const void *read(uint64_t bytes); /* pointer into the mapping */
+    std::string getString();
+    template <typename T>
+    T get();
+
+private:
+    const char *data_;
+    uint64_t size_;
+    uint64_t position_;
+    uint64_t end_; /* of the current section */
+};
+
+/* SnapshotWriter implementation */
+
+SnapshotWriter::SnapshotWriter(std::string file) : offset_(sizeof(SnapshotHeader)), current_(-1)
+{
+    fd_ = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+        throw std::logic_error("can't create the snapshot " + file);
+
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic, kSnapshotMagic, sizeof(header_.magic));
+    header_.version = kSnapshotVersion;
+    header_.sections = SNAPSHOT_SECTIONS;
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    close(fd_);
+}
+
+void SnapshotWriter::begin(SnapshotSection section, uint64_t alignment)
+{
+    end();
+    current_ = (int)section;
+    offset_ = (offset_ + alignment - 1) / alignment * alignment; /* the gap reads as zeros */
+    header_.table[current_].offset = offset_;
+}
+
+void SnapshotWriter::end()
+{
+    if (current_ >= 0)
+        header_.table[current_].size = offset_ - header_.table[current_].offset;
+}
+
+void SnapshotWriter::write(const void *data, uint64_t bytes)
+{
+    if (current_ < 0)
+        throw std::logic_error("snapshot data out of any section!");
+
+    const char *cursor = (const char *)data;
+    while (bytes > 0)
+    {
+        ssize_t written = pwrite(fd_, cursor, bytes, (off_t)offset_);
+        if (written <= 0)
+            throw std::logic_error("can't write the snapshot!");
+        cursor += written;
+        bytes -= written;
+        offset_ += written;
+    }
+}
+
+void SnapshotWriter::putString(const std::string &value)
+{
+    put<uint64_t>(value.size());
+    write(value.data(), value.size());
+}
+
+template <typename T>
+void SnapshotWriter::put(const T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as they are");
+    write(&value, sizeof(T));
+}
+
+void SnapshotWriter::finish()
+{
+    end();
+    if (ftruncate(fd_, (off_t)offset_) != 0 || pwrite(fd_, &header_, sizeof(header_), 0) != sizeof(header_))
+        throw std::logic_error("can't write the snapshot!");
+    current_ = -1;
+}
+
+/* SnapshotReader implementation */
+
+SnapshotReader::SnapshotReader(std::string file) : position_(0), end_(0)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        throw std::logic_error("can't open the snapshot " + file);
+    }
+
+    size_ = status.st_size;
+    void *mapping = size_ < sizeof(SnapshotHeader) ? MAP_FAILED : mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping stays */
+    if (mapping == MAP_FAILED)
+        throw std::logic_error("not a snapshot: " + file);
+    data_ = (const char *)mapping;
+
+    const SnapshotHeader *header = (const SnapshotHeader *)data_;
+    if (memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 || header->version != kSnapshotVersion ||
+        header->sections != SNAPSHOT_SECTIONS)
+    {
+        munmap((void *)data_, size_);
+        throw std::logic_error("not a snapshot of this version: " + file);
+    }
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    munmap((void *)data_, size_);
+}
+
+void SnapshotReader::seek(SnapshotSection section)
+{
+    const SnapshotHeader *header = (const SnapshotHeader *)data_;
+    auto &entry = header->table[(uint32_t)section];
+    if (entry.offset > size_ || entry.size > size_ - entry.offset)
+        throw std::logic_error("snapshot is truncated!");
+    position_ = entry.offset;
+    end_ = entry.offset + entry.size;
+}
+
+bool SnapshotReader::atEnd() const
+{
+    return position_ == end_;
+}
+
+const void *SnapshotReader::read(uint64_t bytes)
+{
+    if (bytes > end_ - position_)
+        throw std::logic_error("snapshot section is too short!");
+    const void *data = data_ + position_;
+    position_ += bytes;
+    return data;
+}
+
+std::string SnapshotReader::getString()
+{
+    uint64_t size = get<uint64_t>();
+    return std::string((const char *)read(size), size);
+}
+
+template <typename T>
+T SnapshotReader::get()
+{
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as they are");
+    T value;
+    memcpy(&value, read(sizeof(T)), sizeof(T)); /* the values are not aligned inside of a section */
+    return value;
+}
+
+#endif
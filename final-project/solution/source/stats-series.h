@@ -0,0 +1,116 @@
+/**
+ * time series of the counters of the simulation, @see VirtualMemory::setStatsSeries()
+ * every interval the counters of every tName are written as one row each. the counters are totals since
+ * the start of the simulation, the activity of an interval is the difference of two rows of the same tName.
+ *
+ * file: csv, a header line then the rows.
+ *  -> time_ns,access,thread,page_miss,page_repl,disc_read,disc_write,working_set,resident
+ *
+ *  time_ns     : nanoseconds since the series is created.
+ *  access      : accesses of all threads so far, the same for the rows of one sample.
+ *  working_set : of the first window of the tracker if there is one, @see WorkingSet, else as the
+ *                replacement algorithm knows it, 0 if it does not keep one.
+ *  resident    : pages in the frames of the partition of the thread, of the whole memory if global.
+ *                a huge page counts once.
+ ***/
+
+#ifndef STATS_SERIES_H
+#define STATS_SERIES_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <stdint.h>
+
+class StatsSeries
+{
+public:
+    /* a sample every everyAccesses accesses or every everyMs milliseconds, whichever comes first.
+       0 turns the trigger off, at least one of them must be on */
+    StatsSeries(std::string file, uint64_t everyAccesses, uint64_t everyMs = 0);
+
+    StatsSeries(const StatsSeries &) = delete;
+    StatsSeries &operator=(const StatsSeries &) = delete;
+
+    struct Row
+    {
+        std::string thread;
+        uint64_t page_miss;
+        uint64_t page_repl;
+        uint64_t disc_read;
+        uint64_t disc_write;
+        uint64_t working_set;
+        uint64_t resident;
+    };
+
+    /* counts one access, true if a sample is due. called under the lock of the memory, so it needs none */
+    bool tick();
+    void write(const std::vector<Row> &rows);
+    uint64_t getSamples() const;
+
+    static const char *kHeader;
+
+private:
+    std::ofstream out_;
+    uint64_t every_accesses_;
+    std::chrono::steady_clock::duration every_time_;
+    uint64_t accesses_;
+    uint64_t last_access_; /* of the last sample */
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_time_;
+    uint64_t samples_;
+
+    static const uint64_t kClockPeriod; /* the clock is read once in so many accesses */
+};
+
+const char *StatsSeries::kHeader = "time_ns,access,thread,page_miss,page_repl,disc_read,disc_write,working_set,resident";
+const uint64_t StatsSeries::kClockPeriod = 64;
+
+StatsSeries::StatsSeries(std::string file, uint64_t everyAccesses, uint64_t everyMs)
+    : every_accesses_(everyAccesses),
+      every_time_(std::chrono::milliseconds(everyMs)),
+      accesses_(0),
+      last_access_(0),
+      start_(std::chrono::steady_clock::now()),
+      last_time_(start_),
+      samples_(0)
+{
+    if (everyAccesses == 0 && everyMs == 0)
+        throw std::invalid_argument("stats series needs an interval!");
+
+    out_.open(file, std::ios::out | std::ios::trunc);
+    if (!out_)
+        throw std::logic_error("can't open stats series " + file);
+    out_ << kHeader << "\n";
+}
+
+bool StatsSeries::tick()
+{
+    accesses_++;
+    if (every_accesses_ != 0 && accesses_ - last_access_ >= every_accesses_)
+        return true;
+    if (every_time_.count() == 0 || accesses_ % kClockPeriod != 0)
+        return false;
+    return std::chrono::steady_clock::now() - last_time_ >= every_time_;
+}
+
+void StatsSeries::write(const std::vector<Row> &rows)
+{
+    last_access_ = accesses_;
+    last_time_ = std::chrono::steady_clock::now();
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(last_time_ - start_).count();
+
+    for (auto &row : rows)
+        out_ << time << "," << accesses_ << "," << row.thread << "," << row.page_miss << "," << row.page_repl << ","
+             << row.disc_read << "," << row.disc_write << "," << row.working_set << "," << row.resident << "\n";
+    samples_++;
+}
+
+uint64_t StatsSeries::getSamples() const
+{
+    return samples_;
+}
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * lock-free statistics of the page replacement algorithms.
+ * every (thread, tName) pair owns one cache line aligned counter block and it is the only writer of it,
+ * so counting needs neither the memory mutex nor atomic read-modify-writes.
+ * readers sum the blocks of the same tName up into a Stats snapshot.
+ * @see page-repl-algorithm.h
+ ***/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+#define CACHE_LINE_SIZE 64
+#define HISTOGRAM_BUCKETS 64
+
+/* what a page fault had to do before the page could be read in */
+enum class FaultType
+{
+    FREE_FRAME, /* an empty frame was found */
+    CLEAN,      /* a not modified page is evicted */
+    DIRTY,      /* a modified page is evicted and written back first */
+};
+
+#define FAULT_TYPES 3
+
+/* log2 bucketed histogram of nanoseconds. bucket i keeps the values in [2^i, 2^(i+1)), bucket 0 also keeps 0. */
+struct Histogram
+{
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+
+    static unsigned int bucket(uint64_t ns);
+    uint64_t count() const;
+    uint64_t percentile(double p) const;
+    void merge(const Histogram &other);
+};
+
+/* counters of one thread, padded to whole cache lines so two threads never share a line */
+struct alignas(CACHE_LINE_SIZE) StatBlock
+{
+    std::atomic<uint64_t> read;
+    std::atomic<uint64_t> write;
+    std::atomic<uint64_t> page_miss;
+    std::atomic<uint64_t> page_repl;
+    std::atomic<uint64_t> disc_read;
+    std::atomic<uint64_t> disc_write;
+    std::atomic<uint64_t> tlb_hit;
+    std::atomic<uint64_t> tlb_miss;
+    std::atomic<uint64_t> huge_fault; /* faults that mapped a whole huge page */
+    std::atomic<uint64_t> promotion;
+    std::atomic<uint64_t> demotion;
+    std::atomic<uint64_t> io_time; /* simulated nanoseconds waited for the disc, @see disc-model.h */
+    std::atomic<uint64_t> fault_latency[FAULT_TYPES][HISTOGRAM_BUCKETS];
+
+    /* over-aligned types can't be created with plain new in c++11 */
+    static StatBlock *create();
+    static void destroy(StatBlock *);
+
+    /* only the owner thread writes, a relaxed load and store is enough */
+    static void bump(std::atomic<uint64_t> &counter, uint64_t n = 1);
+    void recordFault(FaultType type, uint64_t ns);
+
+private:
+    StatBlock();
+};
+
+/* Histogram implementation */
+
+unsigned int Histogram::bucket(uint64_t ns)
+{
+    unsigned int index = 0;
+    while (ns > 1 && index < HISTOGRAM_BUCKETS - 1)
+    {
+        ns >>= 1;
+        index++;
+    }
+    return index;
+}
+
+uint64_t Histogram::count() const
+{
+    uint64_t total = 0;
+    for (auto &b : buckets)
+        total += b;
+    return total;
+}
+
+uint64_t Histogram::percentile(double p) const
+{
+    uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    /* find the bucket of the rank, then interpolate linearly inside of it */
+    double rank = p * total;
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        if (buckets[i] == 0 || seen + buckets[i] < rank)
+        {
+            seen += buckets[i];
+            continue;
+        }
+        uint64_t lower = (i == 0) ? 0 : (uint64_t)1 << i;
+        uint64_t upper = (i + 1 < 64) ? (uint64_t)1 << (i + 1) : UINT64_MAX;
+        return lower + (upper - lower) * ((rank - seen) / buckets[i]);
+    }
+    return UINT64_MAX;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        buckets[i] += other.buckets[i];
+}
+
+/* StatBlock implementation */
+
+StatBlock::StatBlock()
+    : read(0), write(0), page_miss(0), page_repl(0), disc_read(0), disc_write(0),
+      tlb_hit(0), tlb_miss(0), huge_fault(0), promotion(0), demotion(0), io_time(0)
+{
+    for (auto &histogram : fault_latency)
+        for (auto &b : histogram)
+            b.store(0, std::memory_order_relaxed);
+}
+
+StatBlock *StatBlock::create()
+{
+    void *raw = nullptr;
+    if (posix_memalign(&raw, CACHE_LINE_SIZE, sizeof(StatBlock)) != 0)
+        throw std::bad_alloc();
+    return new (raw) StatBlock();
+}
+
+void StatBlock::destroy(StatBlock *block)
+{
+    block->~StatBlock();
+    free(block);
+}
+
+void StatBlock::bump(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void StatBlock::recordFault(FaultType type, uint64_t ns)
+{
+    bump(fault_latency[(int)type][Histogram::bucket(ns)]);
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * translation lookaside buffer model of the simulation.
+ * only counts hits and misses, the translation itself always comes from the page table.
+ * set associative with least recently used replacement in every set. base pages and huge pages share the
+ * lines, a huge page needs one line for all of its base pages.
+ * @see VirtualMemory::translate()
+ ***/
+
+#ifndef TLB_H
+#define TLB_H
+
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+
+class Tlb
+{
+public:
+    Tlb(unsigned int sets = 16, unsigned int ways = 4);
+
+    /* true on hit, the line is filled on miss */
+    bool lookup(uint64_t page, bool huge);
+    void invalidate(uint64_t page, bool huge);
+    void flush();
+
+private:
+    struct Line
+    {
+        uint64_t page; /* page key, the head page for huge pages */
+        bool huge;
+        bool valid;
+        uint64_t last_use;
+    };
+
+    unsigned int sets_;
+    unsigned int ways_;
+    uint64_t clock_;
+    std::vector<Line> lines_;
+
+    Line *set(uint64_t page, bool huge);
+};
+
+Tlb::Tlb(unsigned int sets, unsigned int ways) : sets_(sets), ways_(ways), clock_(0)
+{
+    if (sets_ == 0 || ways_ == 0)
+        throw std::invalid_argument("tlb needs at least one line!");
+    lines_.assign(sets_ * ways_, Line{0, false, false, 0});
+}
+
+Tlb::Line *Tlb::set(uint64_t page, bool huge)
+{
+    /* huge pages are spread over the sets by their own numbers, not by their head page */
+    uint64_t hash = huge ? (page * 0x9E3779B97F4A7C15ull) >> 32 : page;
+    return &lines_[(hash % sets_) * ways_];
+}
+
+bool Tlb::lookup(uint64_t page, bool huge)
+{
+    Line *lines = set(page, huge);
+    Line *victim = lines;
+    clock_++;
+
+    for (unsigned int i = 0; i < ways_; i++)
+    {
+        Line &line = lines[i];
+        if (line.valid && line.page == page && line.huge == huge)
+        {
+            line.last_use = clock_;
+            return true;
+        }
+        if (!line.valid || (victim->valid && line.last_use < victim->last_use))
+            victim = &line;
+    }
+
+    *victim = Line{page, huge, true, clock_};
+    return false;
+}
+
+void Tlb::invalidate(uint64_t page, bool huge)
+{
+    Line *lines = set(page, huge);
+    for (unsigned int i = 0; i < ways_; i++)
+        if (lines[i].valid && lines[i].page == page && lines[i].huge == huge)
+            lines[i].valid = false;
+}
+
+void Tlb::flush()
+{
+    for (auto &line : lines_)
+        line.valid = false;
+}
+
+#endif
@@ -1,57 +1,178 @@
 #ifndef VIRTUAL_MEMORY_H
-#define VURTUAL_MEMORY_H
+#define VIRTUAL_MEMORY_H
 
 #include <string>
-#include <fstream>
 #include <cmath>
 #include <iostream>
 #include <cstdlib>
 #include <chrono>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
 #include "page-repl-algorithm.h"
 #include "page-table.h"
+#include "event-log.h"
+#include "stats-series.h"
+#include "working-set.h"
+#include "tlb.h"
 
 typedef PageReplAlgorithm::Stats Stats;
 
+/**
+ * virtual memory of one or more processes.
+ * every process has its own page table and its own swap region on the disc, @see PageTable::tag()
+ * all of them share the physical memory, the frame table and the replacement algorithm.
+ * the accessors without a process work on process 0.
+ *
+ * huge pages are off unless setHugePages() is called. then a fault on an empty aligned region takes a whole
+ * aligned block of free frames if there is one, and a region whose base pages are all resident and referenced
+ * is promoted in place by moving its pages into the aligned block around its head. every sorter thread has
+ * its own tlb, all of them are shot down when a fault, a copy-on-write break or a promotion unmaps or moves
+ * a page.
+ *
+ * faults in two phases: the frame is taken and the victim is unmapped under the lock of the callers, then
+ * the lock is released while the victim is written and the page is read, then the page is mapped under the
+ * lock again. the swap slots on the way are in transit meanwhile, a thread that needs one of them waits for
+ * it alone. @see setLock()
+ *
+ * checkpoint() saves the whole state of the simulation into a snapshot file and restore() loads it into a new
+ * virtual memory with the same sizes, algorithm, policy and processes, e.g. to start many runs from one warmed
+ * up memory. the huge page size comes with the snapshot. the tlbs start cold and the queue of the disc model
+ * starts empty after a restore.
+ ***/
 class VirtualMemory
 {
 public:
-    VirtualMemory(unsigned int, unsigned int, unsigned int, std::string, std::string, int, std::string);
+    VirtualMemory(address_t, address_t, address_t, std::string, std::string, int, std::string,
+                  unsigned int numProcesses = 1);
     ~VirtualMemory();
 
-    void set(unsigned int index, int value, char *tName);
-    int get(unsigned int index, char *tName);
+    void set(address_t index, int value, char *tName);
+    int get(address_t index, char *tName);
     void fill(char *tName);
+
+    void set(unsigned int process, address_t index, int value, char *tName);
+    int get(unsigned int process, address_t index, char *tName);
+    void fill(unsigned int process, char *tName);
+    unsigned int getProcessCount() const;
+    address_t getFrameSize() const;
+
+    /* bulk access to count ints from index on, one reference for every page they touch instead of one for
+       every int. the callers hold the lock like for get and set */
+    void read(address_t index, int *buffer, address_t count, char *tName);
+    void write(address_t index, const int *buffer, address_t count, char *tName);
+    void read(unsigned int process, address_t index, int *buffer, address_t count, char *tName);
+    void write(unsigned int process, address_t index, const int *buffer, address_t count, char *tName);
+
+    /* the child shares every page of the parent until one of them writes it, the child must be empty */
+    void fork(unsigned int parent, unsigned int child);
+
+    /* 2^bits base pages in a huge page, 0 turns them off. must be set before the first access */
+    void setHugePages(unsigned int bits);
+    /* FCFS, SSTF, LOOK or C-LOOK for the requests of the disc model, FCFS by default. @see disc-model.h */
+    void setDiscScheduler(std::string);
+    /* the mutex the callers hold around every get and set, not owned. fill takes it itself.
+       faults release it during disc io. null if there is only one caller */
+    void setLock(std::mutex *);
+
+    struct ProcessStats /* faults of one process, counted under the memory mutex */
+    {
+        unsigned long page_miss;
+        unsigned long page_repl;
+        unsigned long interference_caused;   /* pages of other processes this process evicted */
+        unsigned long interference_suffered; /* pages of this process evicted by other processes */
+        unsigned long cow_breaks;            /* writes to shared pages */
+        unsigned long cow_copies;            /* of them, the ones that copied the frame */
+    };
+    std::vector<ProcessStats> getProcessStats() const;
     void setPartition(std::vector<char *>);
     void resetPartition();
     void printStats() const;
-    const std::map<std::string, Stats> &getStats() const;
+    std::map<std::string, Stats> getStats() const;
+
+    /* sends the periodic output to the given log instead of the console, not owned. null turns it off. */
+    void setEventLog(EventLog *);
+    /* samples the counters of every thread into the series at its intervals, not owned. null turns it off */
+    void setStatsSeries(StatsSeries *);
+    /* measures the working sets of the threads apart from the algorithm, not owned. null turns it off and
+       the working set is the one of the algorithm again, @see working-set.h */
+    void setWorkingSet(WorkingSet *);
+
+    /* like fill, they take the lock of the callers and wait for the faults on the way. @see snapshot.h
+       restore throws unless no page is mapped yet and the snapshot is taken with the same geometry */
+    void checkpoint(std::string file);
+    void restore(std::string file);
 
 private:
-    unsigned int frame_size_;
-    unsigned int num_physical_;
-    unsigned int num_virtual_;
+    address_t frame_size_;
+    address_t num_physical_;
+    address_t num_virtual_;
     PageReplAlgorithm *algorithm_;
+    std::string algorithm_name_;
     bool policy_local_;
     int print_period_;
     int print_count_;
-    std::fstream disc_;
+    int disc_; /* file descriptor */
     std::string disc_name_;
+    DiscModel *disc_model_;
+    EventLog *event_log_;
+    StatsSeries *stats_series_;
+    WorkingSet *working_set_;
+    unsigned int num_processes_;
+    std::vector<ProcessStats> process_stats_;
+    std::map<std::string, Tlb> tlbs_; /* one per thread, never erased */
+    std::vector<address_t> shootdowns_;
+    unsigned long id_;
+
+    struct TlbCache
+    {
+        unsigned long owner;
+        const char *name; /* the buffer of the name, compared by address only */
+        Tlb *tlb;
+    };
+    static std::atomic<unsigned long> next_id_;
+    static thread_local TlbCache tlb_cache_; /* the tlb of this thread */
+
+    std::mutex *lock_;
+    std::multiset<address_t> transit_; /* swap slots read or written without the lock */
+    static const unsigned int kTransitStripes = 16;
+    std::condition_variable_any transit_cv_[kTransitStripes]; /* by slot */
 
-    unsigned int virtual_size_;
-    unsigned int physical_size_;
+    address_t virtual_size_;
+    address_t physical_size_;
 
     int *memory_; /* physical memory */
     PageTable *page_table_;
-    unsigned int item_count_;
+    address_t item_count_;
 
-    void checkPowerOfTwo(unsigned int);
+    void checkPowerOfTwo(address_t);
+    void checkAddressSpace();
     void initMemory();
     void initPageTable();
     void initAlgorithm(std::string);
     void initAllocPolicy(std::string);
     void initDisc(std::string);
 
-    void print();
+    void print(char *tName);
+    void sample();
+    uint64_t workingSetSize(const std::string &tName) const; /* for the first window of the tracker if there is one */
+    void recordFault(FaultType, address_t index, address_t victim, char *tName,
+                     std::chrono::steady_clock::time_point start);
+    void checkProcess(unsigned int) const;
+    address_t reference(unsigned int process, address_t index, bool write, char *tName); /* physical address */
+    void breakCow(address_t index, char *tName);
+    bool fault(address_t index, char *tName); /* false if another thread has read the page in meanwhile */
+    void readPage(address_t index, address_t frame, address_t writeBack, char *tName);
+    void waitTransit(address_t slot);
+    void endTransit(address_t slot);
+    bool faultHuge(address_t index, char *tName);
+    void promote(address_t index);
+    void translate(address_t index, char *tName);
+    Tlb &tlbOf(char *tName);
+    void shootdown(); /* the pages the page table unmapped or moved leave the tlbs of every thread */
+    void drainTransit();
 
     /* pre-defined string literals for parse command-line args */
     static const std::string kNRU;
@@ -61,6 +182,7 @@ private:
     static const std::string kWSCLOCK;
     static const std::string kGLOBAL;
     static const std::string kLOCAL;
+    static const unsigned int kMaxAddressBits;
 };
 
 const std::string VirtualMemory::kNRU = "NRU";
@@ -70,21 +192,34 @@ const std::string VirtualMemory::kLRU = "LRU";
 const std::string VirtualMemory::kWSCLOCK = "WSClock";
 const std::string VirtualMemory::kGLOBAL = "global";
 const std::string VirtualMemory::kLOCAL = "local";
+const unsigned int VirtualMemory::kMaxAddressBits = 59;
+std::atomic<unsigned long> VirtualMemory::next_id_(1);
+thread_local VirtualMemory::TlbCache VirtualMemory::tlb_cache_ = {0, nullptr, nullptr};
 
-VirtualMemory::VirtualMemory(unsigned int frameSize, unsigned int numPhysical, unsigned int numVirtual,
+VirtualMemory::VirtualMemory(address_t frameSize, address_t numPhysical, address_t numVirtual,
                              std::string pageReplacement, std::string policyName, int printPeriod,
-                             std::string discName)
+                             std::string discName, unsigned int numProcesses)
     : frame_size_(frameSize),
       num_physical_(numPhysical),
       num_virtual_(numVirtual),
       print_period_(printPeriod),
-      print_count_(0)
+      print_count_(0),
+      event_log_(nullptr),
+      stats_series_(nullptr),
+      working_set_(nullptr),
+      num_processes_(numProcesses),
+      process_stats_(numProcesses, ProcessStats()),
+      id_(next_id_++),
+      lock_(nullptr)
 {
     checkPowerOfTwo(frame_size_);
     checkPowerOfTwo(num_physical_);
     checkPowerOfTwo(num_virtual_);
     if (num_physical_ < 4)
         throw std::logic_error("num physical must be at least 4");
+    if (num_processes_ == 0)
+        throw std::logic_error("num processes must be at least 1");
+    checkAddressSpace();
 
     initMemory();
     initPageTable();
@@ -94,32 +229,41 @@ VirtualMemory::VirtualMemory(unsigned int frameSize, unsigned int numPhysical, u
 
     srand(1000);
 }
-void VirtualMemory::checkPowerOfTwo(unsigned int n)
+void VirtualMemory::checkPowerOfTwo(address_t n)
 {
-    bool power_of_two = true;
-    if (n == 0)
+    /* exact for 64 bits, std::log2 of a double is not */
+    if (n == 0 || (n & (n - 1)) != 0)
         throw std::logic_error("bad input: not power of 2");
+}
 
-    power_of_two = (std::ceil(std::log2(n)) == std::floor(std::log2(n)));
-
-    if (!power_of_two)
-        throw std::logic_error("bad input: not power of 2");
+void VirtualMemory::checkAddressSpace()
+{
+    /* the disc keeps every virtual int of every process and as many spare slots for copy-on-write,
+       its size in bytes must fit into a signed 64 bits offset: 2 * 2^59 ints of 4 bytes is 2^62 */
+    unsigned int process_bits = PageTable::log2(num_processes_);
+    if (((address_t)1 << process_bits) < num_processes_)
+        process_bits++;
+    if (PageTable::log2(frame_size_) + PageTable::log2(num_virtual_) + process_bits > kMaxAddressBits ||
+        PageTable::log2(frame_size_) + PageTable::log2(num_physical_) > kMaxAddressBits)
+        throw std::logic_error("address space can't be greater than 2^59 ints!");
 }
 
 void VirtualMemory::initAlgorithm(std::string algorithmName)
 {
     if (kNRU == algorithmName)
-        algorithm_ = new NRU(page_table_, memory_, &disc_, policy_local_);
+        algorithm_ = new NRU(page_table_, memory_, disc_, policy_local_);
     else if (kFIFO == algorithmName)
-        algorithm_ = new FIFO(page_table_, memory_, &disc_, policy_local_);
+        algorithm_ = new FIFO(page_table_, memory_, disc_, policy_local_);
     else if (kSC == algorithmName)
-        algorithm_ = new SC(page_table_, memory_, &disc_, policy_local_);
+        algorithm_ = new SC(page_table_, memory_, disc_, policy_local_);
     else if (kLRU == algorithmName)
-        algorithm_ = new LRU(page_table_, memory_, &disc_, policy_local_);
+        algorithm_ = new LRU(page_table_, memory_, disc_, policy_local_);
     else if (kWSCLOCK == algorithmName)
-        algorithm_ = new WSClock(page_table_, memory_, &disc_, policy_local_);
+        algorithm_ = new WSClock(page_table_, memory_, disc_, policy_local_);
     else
         throw std::logic_error("no such algorithm!");
+    algorithm_name_ = algorithmName;
+    algorithm_->setDiscModel(disc_model_);
 }
 
 void VirtualMemory::initMemory()
@@ -146,89 +290,474 @@ void VirtualMemory::initAllocPolicy(std::string policy)
 void VirtualMemory::initDisc(std::string discName)
 {
     /* create the disc */
-    disc_.open(discName, std::ios::out | std::ios::in | std::ios::binary | std::ios::trunc);
+    disc_ = open(discName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
     disc_name_ = discName;
-
-    int *disc_raw = new int[virtual_size_];
-
-    /* reset */
-    for (size_t i = 0; i < virtual_size_; i++)
-        disc_raw[i] = 0;
-
-    disc_.write((char *)disc_raw, virtual_size_ * sizeof(int));
-    delete[] disc_raw;
+    disc_model_ = new DiscModel();
+
+    /* reset: the file is only extended, the file system reads the hole as zeros
+       and allocates blocks only for the pages written back.
+       the swap region of a process starts at its tagged address, @see PageTable::tag() */
+    address_t end = page_table_->tag(num_processes_ - 1, virtual_size_ - 1) + 1;
+    if (disc_ < 0 || ftruncate(disc_, (off_t)(end * sizeof(int))) != 0)
+        throw std::logic_error("can't create the disc " + discName);
 }
 
 VirtualMemory::~VirtualMemory()
 {
     delete algorithm_;
+    delete disc_model_;
     delete[] memory_;
     delete page_table_;
-    disc_.close();
+    close(disc_);
 }
 
 void VirtualMemory::initPageTable()
 {
-    page_table_ = new PageTable(frame_size_, num_physical_, num_virtual_);
+    page_table_ = new PageTable(frame_size_, num_physical_, num_virtual_, num_processes_);
+}
+
+int VirtualMemory::get(address_t index, char *tName)
+{
+    return get(0, index, tName);
+}
+
+void VirtualMemory::set(address_t index, int value, char *tName)
+{
+    set(0, index, value, tName);
+}
+
+void VirtualMemory::fill(char *tName)
+{
+    fill(0, tName);
+}
+
+void VirtualMemory::checkProcess(unsigned int process) const
+{
+    if (process >= num_processes_)
+        throw std::invalid_argument("no such process!");
+}
+
+unsigned int VirtualMemory::getProcessCount() const
+{
+    return num_processes_;
+}
+
+address_t VirtualMemory::getFrameSize() const
+{
+    return frame_size_;
+}
+
+std::vector<VirtualMemory::ProcessStats> VirtualMemory::getProcessStats() const
+{
+    return process_stats_;
+}
+
+int VirtualMemory::get(unsigned int process, address_t index, char *tName)
+{
+    return memory_[reference(process, index, false, tName)];
+}
+
+void VirtualMemory::set(unsigned int process, address_t index, int value, char *tName)
+{
+    memory_[reference(process, index, true, tName)] = value;
+}
+
+void VirtualMemory::read(address_t index, int *buffer, address_t count, char *tName)
+{
+    read(0, index, buffer, count, tName);
+}
+
+void VirtualMemory::write(address_t index, const int *buffer, address_t count, char *tName)
+{
+    write(0, index, buffer, count, tName);
+}
+
+void VirtualMemory::read(unsigned int process, address_t index, int *buffer, address_t count, char *tName)
+{
+    while (count > 0)
+    {
+        /* a page is contiguous in its frame */
+        address_t chunk = std::min(count, frame_size_ - index % frame_size_);
+        memcpy(buffer, memory_ + reference(process, index, false, tName), chunk * sizeof(int));
+        index += chunk;
+        buffer += chunk;
+        count -= chunk;
+    }
+}
+
+void VirtualMemory::write(unsigned int process, address_t index, const int *buffer, address_t count, char *tName)
+{
+    while (count > 0)
+    {
+        address_t chunk = std::min(count, frame_size_ - index % frame_size_);
+        memcpy(memory_ + reference(process, index, true, tName), buffer, chunk * sizeof(int));
+        index += chunk;
+        buffer += chunk;
+        count -= chunk;
+    }
 }
 
-int VirtualMemory::get(unsigned int index, char *tName)
+address_t VirtualMemory::reference(unsigned int process, address_t index, bool write, char *tName)
 {
-    if (!page_table_->isPresent(index))
+    checkProcess(process);
+    assert(index < virtual_size_);
+    index = page_table_->tag(process, index);
+    bool faulted = !page_table_->isPresent(index) && fault(index, tName);
+    if (write && page_table_->isShared(index))
+        breakCow(index, tName);
+
+    /* the algorithm knows the frame by its primary page, the head keeps the bits of a huge page */
+    if (write)
+        algorithm_->recordSet(page_table_->primary(index), tName);
+    else
+        algorithm_->recordGet(page_table_->primary(index), tName);
+    if (faulted)
+        promote(index);
+    translate(index, tName);
+    if (working_set_ != nullptr)
+        working_set_->access(tName, index / frame_size_); /* the page is tagged with the process */
+    address_t address = page_table_->get(index);
+    assert(address < physical_size_);
+    print(tName);
+    return address;
+}
+
+bool VirtualMemory::fault(address_t index, char *tName)
+{
+    auto start = std::chrono::steady_clock::now();
+    waitTransit(page_table_->slotOf(index / frame_size_));
+    if (page_table_->isPresent(index))
+        return false;
+
+    FaultType type = FaultType::FREE_FRAME;
+    address_t victim = 0;
+    if (!faultHuge(index, tName))
     {
-        int physical_index = algorithm_->findIndex(tName);
-        if (physical_index != -1)
+        /* the rest of the page may be on disc even for an empty frame, e.g. shared by a fork */
+        address_t write_back = PageTable::kNoPage;
+        address_t frame = algorithm_->findIndex(tName);
+        if (frame == PageReplAlgorithm::kNoFrame) /* page-table is full. replace */
         {
-            page_table_->set(index, physical_index);
-            algorithm_->recordNew(index);
-            algorithm_->readFrame(index);
+            frame = algorithm_->evict(&type, &victim, &write_back);
+            shootdown(); /* before the lock is released by readPage */
         }
-        else /* page-table is full. replace */
-            algorithm_->replace(index);
+        readPage(index, frame, write_back, tName);
+    }
+    recordFault(type, index, victim, tName, start);
+    return true;
+}
+
+void VirtualMemory::readPage(address_t index, address_t frame, address_t writeBack, char *tName)
+{
+    /* the frame is neither mapped nor known by the algorithm, no other thread can take it meanwhile */
+    address_t slot = page_table_->slotOf(index / frame_size_);
+    if (lock_ != nullptr)
+    {
+        transit_.insert(slot);
+        if (writeBack != PageTable::kNoPage)
+            transit_.insert(writeBack);
+        lock_->unlock();
+    }
+
+    if (writeBack != PageTable::kNoPage)
+        algorithm_->writeSlot(writeBack, frame, tName);
+    algorithm_->readSlot(slot, frame, tName);
+
+    if (lock_ != nullptr)
+    {
+        lock_->lock();
+        endTransit(slot);
+        if (writeBack != PageTable::kNoPage)
+            endTransit(writeBack);
+    }
+    algorithm_->map(index, frame, tName);
+}
+
+void VirtualMemory::waitTransit(address_t slot)
+{
+    while (transit_.count(slot) != 0)
+        transit_cv_[slot % kTransitStripes].wait(*lock_);
+}
+
+void VirtualMemory::endTransit(address_t slot)
+{
+    transit_.erase(transit_.find(slot));
+    transit_cv_[slot % kTransitStripes].notify_all();
+}
+
+bool VirtualMemory::faultHuge(address_t index, char *tName)
+{
+    address_t pages = page_table_->hugePages();
+    address_t head = page_table_->headOf(index / frame_size_);
+    if (pages == 1 || !page_table_->isRegionEmpty(head))
+        return false;
+    for (address_t i = 0; i < pages; i++)
+        if (transit_.count(page_table_->slotOf(head + i)) != 0) /* on the way in by another thread */
+            return false;
+
+    /* no eviction for a huge page, it is built by promotion once the memory is full */
+    address_t frame = algorithm_->findBlock(tName, pages);
+    if (frame == PageReplAlgorithm::kNoFrame)
+        return false;
+
+    page_table_->mapHuge(head, frame);
+    algorithm_->recordNew(head * frame_size_);
+    for (address_t i = 0; i < pages; i++)
+        algorithm_->readFrame((head + i) * frame_size_);
+    return true;
+}
+
+void VirtualMemory::promote(address_t index)
+{
+    address_t pages = page_table_->hugePages();
+    address_t head = page_table_->headOf(index / frame_size_);
+    if (pages == 1 || !page_table_->isHot(head))
+        return;
+
+    /* the block around the frame of the head, every frame involved must be free to move */
+    address_t block = page_table_->frameOf(head) & ~(pages - 1);
+    for (address_t i = 0; i < pages; i++)
+    {
+        address_t frame = page_table_->frameOf(head + i);
+        if (!page_table_->isMovable(block + i) || !algorithm_->canUse(block + i) || !algorithm_->canUse(frame))
+            return;
+    }
+
+    for (address_t i = 0; i < pages; i++)
+    {
+        address_t from = page_table_->frameOf(head + i), to = block + i;
+        if (from == to)
+            continue;
+        std::swap_ranges(memory_ + from * frame_size_, memory_ + (from + 1) * frame_size_, memory_ + to * frame_size_);
+        page_table_->swapFrames(from, to);
     }
+    page_table_->makeHuge(head);
+    shootdown();
+    algorithm_->recordPromotion(); /* counted for the thread of the fault */
+}
+
+void VirtualMemory::shootdown()
+{
+    page_table_->takeShootdowns(shootdowns_);
+    for (auto page : shootdowns_)
+        for (auto &tlb : tlbs_)
+        {
+            tlb.second.invalidate(page, false);
+            tlb.second.invalidate(page_table_->headOf(page), true);
+        }
+}
+
+Tlb &VirtualMemory::tlbOf(char *tName)
+{
+    /* fast path, the thread keeps passing the same name */
+    if (tlb_cache_.owner == id_ && tlb_cache_.name == tName)
+        return *tlb_cache_.tlb;
+
+    tlb_cache_.owner = id_;
+    tlb_cache_.name = tName;
+    tlb_cache_.tlb = &tlbs_[tName];
+    return *tlb_cache_.tlb;
+}
+
+void VirtualMemory::translate(address_t index, char *tName)
+{
+    Tlb &tlb = tlbOf(tName);
+    address_t page = index / frame_size_;
+    bool huge = page_table_->isHuge(index);
+    algorithm_->recordTlb(huge ? tlb.lookup(page_table_->headOf(page), true) : tlb.lookup(page, false));
+}
+
+void VirtualMemory::setHugePages(unsigned int bits)
+{
+    page_table_->setHugeBits(bits);
+}
+
+void VirtualMemory::setLock(std::mutex *lock)
+{
+    lock_ = lock;
+}
+
+void VirtualMemory::setDiscScheduler(std::string scheduler)
+{
+    /* a new disc, the queue of the old one is dropped */
+    DiscModel *model = new DiscModel(scheduler);
+    delete disc_model_;
+    disc_model_ = model;
+    algorithm_->setDiscModel(disc_model_);
+}
 
-    unsigned int address = page_table_->get(index);
-    algorithm_->recordGet(index, tName);
-    print(); // FIXME.
-    return memory_[address];
+void VirtualMemory::fork(unsigned int parent, unsigned int child)
+{
+    checkProcess(parent);
+    checkProcess(child);
+    page_table_->fork(parent, child);
 }
 
-void VirtualMemory::set(unsigned int index, int value, char *tName)
+void VirtualMemory::breakCow(address_t index, char *tName)
 {
-    if (!page_table_->isPresent(index))
+    unsigned int process = page_table_->processOf(index / frame_size_);
+    process_stats_[process].cow_breaks++;
+
+    if (page_table_->isFrameShared(index))
     {
-        int physical_index = algorithm_->findIndex(tName);
-        if (physical_index != -1) /* empty slot is found */
+        /* a frame of its own for the writer, taking one is a fault like any other */
+        auto start = std::chrono::steady_clock::now();
+        FaultType type = FaultType::FREE_FRAME;
+        address_t victim = 0;
+        address_t frame = page_table_->get(index) / frame_size_;
+        address_t copy = algorithm_->findIndex(tName);
+        if (copy == PageReplAlgorithm::kNoFrame)
+            copy = algorithm_->evict(&type, &victim);
+
+        if (!page_table_->isPresent(index))
         {
-            page_table_->set(index, physical_index);
+            /* the shared frame itself is evicted, its data is still there and on disc */
+            assert(copy == frame);
+            page_table_->set(index, copy);
             algorithm_->recordNew(index);
         }
-        else /* page-table is full. replace */
-            algorithm_->replace(index);
+        else
+        {
+            std::copy(memory_ + frame * frame_size_, memory_ + (frame + 1) * frame_size_, memory_ + copy * frame_size_);
+            algorithm_->recordNew(page_table_->split(index, copy));
+            process_stats_[process].cow_copies++;
+        }
+        recordFault(type, index, victim, tName, start);
     }
 
-    unsigned int address = page_table_->get(index);
-    assert(address < physical_size_);
-    algorithm_->recordSet(index, tName);
-    print();
-    memory_[address] = value;
+    /* the frame is private now, the slot behind it has to be too */
+    page_table_->privateSlot(index);
+    shootdown(); /* the victim and the side of the split that moved */
 }
 
-void VirtualMemory::fill(char *tName)
+void VirtualMemory::fill(unsigned int process, char *tName)
 {
+    /* runs alone, so it holds the lock of the callers itself */
+    std::unique_lock<std::mutex> lock;
+    if (lock_ != nullptr)
+        lock = std::unique_lock<std::mutex>(*lock_);
     for (size_t i = 0; i < virtual_size_; i++)
-        set(i, rand(), tName);
+        set(process, i, rand(), tName);
+}
+
+void VirtualMemory::drainTransit()
+{
+    while (!transit_.empty())
+        waitTransit(*transit_.begin());
+}
+
+void VirtualMemory::checkpoint(std::string file)
+{
+    std::unique_lock<std::mutex> lock;
+    if (lock_ != nullptr)
+    {
+        lock = std::unique_lock<std::mutex>(*lock_);
+        drainTransit();
+    }
+
+    SnapshotWriter out(file);
+    out.begin(SnapshotSection::GEOMETRY);
+    out.put<uint64_t>(frame_size_);
+    out.put<uint64_t>(num_physical_);
+    out.put<uint64_t>(num_virtual_);
+    out.put<uint32_t>(num_processes_);
+    out.put<uint8_t>(policy_local_);
+    out.putString(algorithm_name_);
+    out.put<int32_t>(print_count_);
+
+    out.begin(SnapshotSection::MEMORY, 4096); /* a page of its own, the restore copies it straight */
+    out.write(memory_, physical_size_ * sizeof(int));
+
+    out.begin(SnapshotSection::PAGE_TABLE);
+    page_table_->save(out);
+    out.begin(SnapshotSection::ALGORITHM);
+    algorithm_->save(out);
+    out.begin(SnapshotSection::STATS);
+    algorithm_->saveStats(out);
+    out.begin(SnapshotSection::PROCESSES);
+    out.write(process_stats_.data(), num_processes_ * sizeof(ProcessStats));
+
+    /* only the written extents, the rest of the sparse disc reads as zeros anyway */
+    out.begin(SnapshotSection::DISC);
+    off_t end = lseek(disc_, 0, SEEK_END);
+    std::vector<char> buffer(1 << 20);
+    for (off_t data = lseek(disc_, 0, SEEK_DATA); data >= 0 && data < end; data = lseek(disc_, data, SEEK_DATA))
+    {
+        off_t hole = lseek(disc_, data, SEEK_HOLE);
+        if (hole < 0)
+            hole = end;
+        out.put<uint64_t>(data);
+        out.put<uint64_t>(hole - data);
+        for (; data < hole;)
+        {
+            ssize_t bytes = pread(disc_, buffer.data(), std::min<off_t>(buffer.size(), hole - data), data);
+            if (bytes <= 0)
+                throw std::logic_error("can't read the disc!");
+            out.write(buffer.data(), bytes);
+            data += bytes;
+        }
+    }
+    out.finish();
+}
+
+void VirtualMemory::restore(std::string file)
+{
+    std::unique_lock<std::mutex> lock;
+    if (lock_ != nullptr)
+    {
+        lock = std::unique_lock<std::mutex>(*lock_);
+        drainTransit();
+    }
+
+    SnapshotReader in(file);
+    in.seek(SnapshotSection::GEOMETRY);
+    bool fits = in.get<uint64_t>() == frame_size_;
+    fits = in.get<uint64_t>() == num_physical_ && fits;
+    fits = in.get<uint64_t>() == num_virtual_ && fits;
+    fits = in.get<uint32_t>() == num_processes_ && fits;
+    fits = in.get<uint8_t>() == policy_local_ && fits;
+    fits = in.getString() == algorithm_name_ && fits;
+    if (!fits)
+        throw std::logic_error("snapshot is taken with another geometry!");
+    print_count_ = in.get<int32_t>();
+
+    in.seek(SnapshotSection::PAGE_TABLE);
+    page_table_->load(in); /* first, it refuses a memory that is in use */
+    in.seek(SnapshotSection::ALGORITHM);
+    algorithm_->load(in);
+    in.seek(SnapshotSection::STATS);
+    algorithm_->loadStats(in);
+    in.seek(SnapshotSection::PROCESSES);
+    memcpy(process_stats_.data(), in.read(num_processes_ * sizeof(ProcessStats)), num_processes_ * sizeof(ProcessStats));
+
+    in.seek(SnapshotSection::MEMORY);
+    memcpy(memory_, in.read(physical_size_ * sizeof(int)), physical_size_ * sizeof(int));
+
+    in.seek(SnapshotSection::DISC);
+    while (!in.atEnd())
+    {
+        off_t offset = in.get<uint64_t>();
+        uint64_t bytes = in.get<uint64_t>();
+        const char *data = (const char *)in.read(bytes);
+        for (uint64_t done = 0; done < bytes;)
+        {
+            ssize_t written = pwrite(disc_, data + done, bytes - done, offset + done);
+            if (written <= 0)
+                throw std::logic_error("can't write the disc!");
+            done += written;
+        }
+    }
 }
 
 void VirtualMemory::setPartition(std::vector<char *> tNames)
 {
 
-    unsigned int partition_size = num_physical_ / tNames.size();
+    address_t partition_size = num_physical_ / tNames.size();
 
     for (size_t i = 0; i < tNames.size(); ++i)
     {
-        unsigned int lower_bound = i * partition_size;
-        unsigned int upper_bound = (i + 1) * partition_size;
+        address_t lower_bound = i * partition_size;
+        address_t upper_bound = (i + 1) * partition_size;
         algorithm_->addWorkingSet(tNames[i], lower_bound, upper_bound);
     }
 }
@@ -236,22 +765,114 @@ void VirtualMemory::setPartition(std::vector<char *> tNames)
 void VirtualMemory::resetPartition()
 {
     algorithm_->delWorkingSets();
+    shootdown();
 }
 
 void VirtualMemory::printStats() const
 {
     algorithm_->printStats();
+    if (num_processes_ == 1)
+        return;
+
+    for (unsigned int process = 0; process < num_processes_; process++)
+    {
+        auto &stats = process_stats_[process];
+        std::cout << "{ Statistics for process " << process << " }\n";
+        std::cout << "\t* Number of page misses " << stats.page_miss << "\n";
+        std::cout << "\t* Number of page replacements " << stats.page_repl << "\n";
+        std::cout << "\t* Number of pages evicted from other processes " << stats.interference_caused << "\n";
+        std::cout << "\t* Number of pages evicted by other processes " << stats.interference_suffered << "\n";
+        std::cout << "\t* Number of copy-on-write breaks " << stats.cow_breaks << " (" << stats.cow_copies
+                  << " frame copies)\n";
+        std::cout << std::endl;
+    }
 }
 
-const std::map<std::string, Stats> &VirtualMemory::getStats() const
+std::map<std::string, Stats> VirtualMemory::getStats() const
 {
     return algorithm_->getStats();
 }
 
-void VirtualMemory::print()
+void VirtualMemory::setEventLog(EventLog *log)
+{
+    event_log_ = log;
+}
+
+void VirtualMemory::setStatsSeries(StatsSeries *series)
+{
+    stats_series_ = series;
+}
+
+void VirtualMemory::setWorkingSet(WorkingSet *workingSet)
+{
+    working_set_ = workingSet;
+}
+
+uint64_t VirtualMemory::workingSetSize(const std::string &tName) const
+{
+    return working_set_ != nullptr ? working_set_->size(tName) : algorithm_->workingSetSize(tName);
+}
+
+void VirtualMemory::sample()
+{
+    std::vector<StatsSeries::Row> rows;
+    for (auto &stat : algorithm_->getStats())
+        rows.push_back({stat.first, stat.second.page_miss, stat.second.page_repl, stat.second.disc_read,
+                        stat.second.disc_write, workingSetSize(stat.first),
+                        algorithm_->residentPages(stat.first)});
+    stats_series_->write(rows);
+}
+
+void VirtualMemory::recordFault(FaultType type, address_t index, address_t victim, char *tName,
+                                std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    algorithm_->recordFault(type, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    unsigned int process = page_table_->processOf(index / frame_size_);
+    process_stats_[process].page_miss++;
+    if (type != FaultType::FREE_FRAME)
+    {
+        process_stats_[process].page_repl++;
+        unsigned int owner = page_table_->processOf(victim);
+        if (owner != process)
+        {
+            process_stats_[process].interference_caused++;
+            process_stats_[owner].interference_suffered++;
+        }
+    }
+
+    if (event_log_ == nullptr)
+        return;
+
+    address_t page = index / frame_size_;
+    if (type == FaultType::FREE_FRAME)
+        event_log_->record(EventType::FAULT_FREE_FRAME, tName, page);
+    else
+    {
+        event_log_->record(type == FaultType::DIRTY ? EventType::FAULT_DIRTY : EventType::FAULT_CLEAN, tName, page);
+        event_log_->record(EventType::EVICTION, tName, victim);
+    }
+}
+
+void VirtualMemory::print(char *tName)
 {
-    if (print_period_ == 0)
-        algorithm_->workingSetSize();
+    if (stats_series_ != nullptr && stats_series_->tick())
+        sample();
+
+    if (event_log_ != nullptr)
+    {
+        /* sampled into the binary log instead of the console */
+        if (event_log_->sample())
+            event_log_->record(EventType::WORKING_SET, tName, workingSetSize(tName));
+    }
+    else if (print_period_ == 0)
+    {
+        uint64_t ws_size = workingSetSize(tName);
+        std::string name = tName;
+        if (ws_size != 0 && name != "fill" && name != "check")
+            std::cout << name << " " << ws_size << std::endl;
+    }
     else if (print_count_++ == print_period_)
     {
         page_table_->print();
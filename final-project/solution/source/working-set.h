@@ -0,0 +1,119 @@
+/**
+ * Denning working set of every thread, apart from the replacement algorithm. @see VirtualMemory::setWorkingSet()
+ * W(t, tau) is the set of the distinct pages a thread referenced in its last tau accesses, (t - tau, t].
+ * the time t is the virtual time of the thread: its own accesses, so the other threads don't stretch it.
+ * the sizes for all taus are kept at once and updated on every access in O(number of taus):
+ *  -> the last access time of every page, a page is in W(t, tau) while its last access > t - tau.
+ *  -> a ring of the pages referenced in the last max(tau) accesses, the page at t - tau leaves W(t, tau)
+ *     unless it was referenced again after.
+ * called under the lock of the memory, so it needs none.
+ ***/
+
+#ifndef WORKING_SET_H
+#define WORKING_SET_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+
+class WorkingSet
+{
+public:
+    /* window sizes in accesses, at least one */
+    WorkingSet(std::vector<uint64_t> taus);
+
+    void access(const std::string &tName, uint64_t page);
+
+    /* |W(t, tau)| of the thread now, for the tau at the given index of getTaus(). 0 for an unknown thread */
+    uint64_t size(const std::string &tName, size_t tau = 0) const;
+    std::vector<uint64_t> sizes(const std::string &tName) const;
+    const std::vector<uint64_t> &getTaus() const;
+    void reset(); /* forgets every thread */
+
+private:
+    struct Thread
+    {
+        uint64_t time;                                /* accesses of the thread so far */
+        std::unordered_map<uint64_t, uint64_t> last; /* page -> time of its last access, in the widest window */
+        std::vector<uint64_t> history;                /* page of the access at time t, at t % max(tau) */
+        std::vector<uint64_t> sizes;                  /* by tau */
+    };
+
+    std::vector<uint64_t> taus_;
+    uint64_t window_; /* max(tau) */
+    std::map<std::string, Thread> threads_;
+};
+
+WorkingSet::WorkingSet(std::vector<uint64_t> taus) : taus_(taus)
+{
+    if (taus_.empty() || std::find(taus_.begin(), taus_.end(), 0) != taus_.end())
+        throw std::invalid_argument("working set needs windows of at least one access!");
+    window_ = *std::max_element(taus_.begin(), taus_.end());
+}
+
+void WorkingSet::access(const std::string &tName, uint64_t page)
+{
+    auto it = threads_.find(tName);
+    if (it == threads_.end()) /* first time */
+    {
+        it = threads_.insert({tName, Thread()}).first;
+        it->second.time = 0;
+        it->second.history.assign(window_, 0);
+        it->second.sizes.assign(taus_.size(), 0);
+    }
+    Thread &thread = it->second;
+    uint64_t now = ++thread.time; /* times start from 1, 0 is never */
+
+    /* the page referenced at now - tau leaves the window of tau, unless it is referenced again since */
+    for (size_t i = 0; i < taus_.size(); i++)
+    {
+        if (now <= taus_[i])
+            continue;
+        uint64_t leaving = now - taus_[i];
+        if (thread.last.at(thread.history[leaving % window_]) == leaving)
+            thread.sizes[i]--;
+    }
+    if (now > window_) /* out of every window, forgotten */
+    {
+        auto oldest = thread.last.find(thread.history[now % window_]);
+        if (oldest->second == now - window_)
+            thread.last.erase(oldest);
+    }
+
+    uint64_t &previous = thread.last[page]; /* 0 if it is not in any window */
+    for (size_t i = 0; i < taus_.size(); i++)
+        if (previous == 0 || previous + taus_[i] <= now) /* not in the window before */
+            thread.sizes[i]++;
+    previous = now;
+    thread.history[now % window_] = page;
+}
+
+uint64_t WorkingSet::size(const std::string &tName, size_t tau) const
+{
+    if (tau >= taus_.size())
+        throw std::out_of_range("no such working set window!");
+    auto it = threads_.find(tName);
+    return it == threads_.end() ? 0 : it->second.sizes[tau];
+}
+
+std::vector<uint64_t> WorkingSet::sizes(const std::string &tName) const
+{
+    auto it = threads_.find(tName);
+    return it == threads_.end() ? std::vector<uint64_t>(taus_.size(), 0) : it->second.sizes;
+}
+
+const std::vector<uint64_t> &WorkingSet::getTaus() const
+{
+    return taus_;
+}
+
+void WorkingSet::reset()
+{
+    threads_.clear();
+}
+
+#endif
@@ -0,0 +1,545 @@
+/**
+ * synthetic workloads for driving the virtual memory.
+ * every workload runs as one thread of the simulation and is named by its tName,
+ * so it can be registered with VirtualMemory::setPartition like the sorters.
+ * @see paging-simulation.h
+ ***/
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <cassert>
+#include <iostream>
+#include "virtual-memory.h"
+
+class Workload
+{
+public:
+    Workload(std::string name, unsigned int seed);
+    virtual ~Workload();
+
+    /* forbidding of copying workloads, the name is handed out as char * */
+    Workload(const Workload &) = delete;
+    Workload &operator=(const Workload &) = delete;
+
+    /* assigns the virtual memory region [lower_bound, upper_bound) of the process to the workload */
+    void bind(VirtualMemory *memory, std::mutex *mutex, address_t lowerBound, address_t upperBound,
+              unsigned int process = 0);
+    void run();
+
+    char *getName();
+    unsigned long getAccessCount() const;
+
+protected:
+    virtual void generate() = 0;
+    /* throws if the workload can't run in its region, called by bind() before any thread starts */
+    virtual void validate() const;
+
+    /* accessors relative to the lower bound of the region */
+    int get(address_t offset);
+    void set(address_t offset, int value);
+    address_t size() const;
+
+    std::mt19937 rng_;
+
+private:
+    std::string name_;
+    VirtualMemory *memory_;
+    std::mutex *mutex_; /* may be null if the workload runs alone */
+    address_t lower_bound_;
+    address_t upper_bound_;
+    unsigned int process_;
+    unsigned long access_count_;
+};
+
+/* scans the whole region from start to end */
+class SequentialScan : public Workload
+{
+public:
+    SequentialScan(std::string name, unsigned int passes, bool write = false, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned int passes_;
+    bool write_;
+};
+
+/* jumps through the region with a fixed stride, wrapping around at the end */
+class StridedScan : public Workload
+{
+public:
+    StridedScan(std::string name, unsigned int stride, unsigned long accesses, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned int stride_;
+    unsigned long accesses_;
+};
+
+/* picks every index with the same probability */
+class UniformRandom : public Workload
+{
+public:
+    UniformRandom(std::string name, unsigned long accesses, double writeRatio = 0.0, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned long accesses_;
+    double write_ratio_;
+};
+
+/* zipfian distribution over the region, rank 0 is the hottest index so the hot set is contiguous */
+class Zipfian : public Workload
+{
+public:
+    Zipfian(std::string name, unsigned long accesses, double skew = 0.99, double writeRatio = 0.0, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned long accesses_;
+    double skew_;
+    double write_ratio_;
+
+    address_t next(double zetan, double eta, double alpha);
+    double zeta(address_t n) const;
+};
+
+/* scans the first working_set indexes of the region over and over */
+class LoopingWorkingSet : public Workload
+{
+public:
+    LoopingWorkingSet(std::string name, unsigned int workingSet, unsigned int loops, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned int working_set_;
+    unsigned int loops_;
+};
+
+/* random accesses inside a window that moves to a random place at every phase */
+class PhaseChange : public Workload
+{
+public:
+    PhaseChange(std::string name, unsigned int phases, unsigned long phaseLength, unsigned int workingSet, unsigned int seed = 1000);
+
+protected:
+    void generate();
+
+private:
+    unsigned int phases_;
+    unsigned long phase_length_;
+    unsigned int working_set_;
+};
+
+/* C = A x B for n x n matrices laid out row major, tiled if tile is not zero */
+class MatrixMultiply : public Workload
+{
+public:
+    MatrixMultiply(std::string name, unsigned int n, unsigned int tile = 0, unsigned int seed = 1000);
+
+protected:
+    void generate();
+    void validate() const;
+
+private:
+    unsigned int n_;
+    unsigned int tile_;
+
+    void naive(unsigned int a, unsigned int b, unsigned int c);
+    void tiled(unsigned int a, unsigned int b, unsigned int c);
+};
+
+/* builds an open addressing hash table over the build relation and probes it with the probe relation */
+class HashJoin : public Workload
+{
+public:
+    HashJoin(std::string name, unsigned int buildSize, unsigned int probeSize, unsigned int seed = 1000);
+
+    unsigned int getMatches() const;
+
+protected:
+    void generate();
+    void validate() const;
+
+private:
+    unsigned int build_size_;
+    unsigned int probe_size_;
+    unsigned int table_size_;
+    unsigned int matches_;
+
+    unsigned int hash(int key) const;
+};
+
+/* Workload implementation */
+
+Workload::Workload(std::string name, unsigned int seed)
+    : rng_(seed),
+      name_(name),
+      memory_(nullptr),
+      mutex_(nullptr),
+      lower_bound_(0),
+      upper_bound_(0),
+      process_(0),
+      access_count_(0)
+{
+    /* intentionally left blank */
+}
+
+Workload::~Workload()
+{
+    /* intentionally left blank */
+}
+
+void Workload::bind(VirtualMemory *memory, std::mutex *mutex, address_t lowerBound, address_t upperBound,
+                    unsigned int process)
+{
+    if (lowerBound >= upperBound)
+        throw std::logic_error("bad workload region!");
+    if (process >= memory->getProcessCount())
+        throw std::logic_error("bad workload process!");
+    process_ = process;
+    memory_ = memory;
+    mutex_ = mutex;
+    lower_bound_ = lowerBound;
+    upper_bound_ = upperBound;
+    validate();
+}
+
+void Workload::validate() const
+{
+    /* intentionally left blank */
+}
+
+void Workload::run()
+{
+    if (memory_ == nullptr)
+        throw std::logic_error("workload is not bound to a memory!");
+    access_count_ = 0;
+    generate();
+    std::cout << name_ << " finished!" << std::endl;
+}
+
+char *Workload::getName()
+{
+    return &name_[0];
+}
+
+unsigned long Workload::getAccessCount() const
+{
+    return access_count_;
+}
+
+address_t Workload::size() const
+{
+    return upper_bound_ - lower_bound_;
+}
+
+int Workload::get(address_t offset)
+{
+    assert(offset < size());
+    access_count_++;
+    if (mutex_ == nullptr)
+        return memory_->get(process_, lower_bound_ + offset, getName());
+
+    mutex_->lock();
+    int value = memory_->get(process_, lower_bound_ + offset, getName());
+    mutex_->unlock();
+    return value;
+}
+
+void Workload::set(address_t offset, int value)
+{
+    assert(offset < size());
+    access_count_++;
+    if (mutex_ == nullptr)
+        return memory_->set(process_, lower_bound_ + offset, value, getName());
+
+    mutex_->lock();
+    memory_->set(process_, lower_bound_ + offset, value, getName());
+    mutex_->unlock();
+}
+
+/* SequentialScan implementation */
+
+SequentialScan::SequentialScan(std::string name, unsigned int passes, bool write, unsigned int seed)
+    : Workload(name, seed), passes_(passes), write_(write)
+{
+    /* intentionally left blank */
+}
+
+void SequentialScan::generate()
+{
+    for (unsigned int p = 0; p < passes_; p++)
+        for (address_t i = 0; i < size(); i++)
+        {
+            if (write_)
+                set(i, get(i) + 1);
+            else
+                get(i);
+        }
+}
+
+/* StridedScan implementation */
+
+StridedScan::StridedScan(std::string name, unsigned int stride, unsigned long accesses, unsigned int seed)
+    : Workload(name, seed), stride_(stride), accesses_(accesses)
+{
+    if (stride_ == 0)
+        throw std::invalid_argument("stride can't be zero!");
+}
+
+void StridedScan::generate()
+{
+    address_t index = 0;
+    for (unsigned long i = 0; i < accesses_; i++)
+    {
+        get(index);
+        index = (index + stride_) % size();
+    }
+}
+
+/* UniformRandom implementation */
+
+UniformRandom::UniformRandom(std::string name, unsigned long accesses, double writeRatio, unsigned int seed)
+    : Workload(name, seed), accesses_(accesses), write_ratio_(writeRatio)
+{
+    /* intentionally left blank */
+}
+
+void UniformRandom::generate()
+{
+    std::uniform_int_distribution<address_t> index(0, size() - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    for (unsigned long i = 0; i < accesses_; i++)
+    {
+        address_t at = index(rng_);
+        if (coin(rng_) < write_ratio_)
+            set(at, rng_());
+        else
+            get(at);
+    }
+}
+
+/* Zipfian implementation */
+
+Zipfian::Zipfian(std::string name, unsigned long accesses, double skew, double writeRatio, unsigned int seed)
+    : Workload(name, seed), accesses_(accesses), skew_(skew), write_ratio_(writeRatio)
+{
+    if (skew_ <= 0 || skew_ == 1)
+        throw std::invalid_argument("zipfian skew must be positive and not 1!");
+}
+
+double Zipfian::zeta(address_t n) const
+{
+    double sum = 0;
+    for (address_t i = 1; i <= n; i++)
+        sum += 1 / std::pow(i, skew_);
+    return sum;
+}
+
+address_t Zipfian::next(double zetan, double eta, double alpha)
+{
+    /* Gray et al., "Quickly Generating Billion-Record Synthetic Databases" */
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double u = uniform(rng_);
+    double uz = u * zetan;
+
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + std::pow(0.5, skew_))
+        return 1;
+
+    address_t rank = size() * std::pow(eta * u - eta + 1, alpha);
+    return std::min(rank, size() - 1);
+}
+
+void Zipfian::generate()
+{
+    /* constants of the generator, computed once per run */
+    double zetan = zeta(size());
+    double zeta2 = zeta(2);
+    double alpha = 1.0 / (1.0 - skew_);
+    double eta = (1 - std::pow(2.0 / size(), 1 - skew_)) / (1 - zeta2 / zetan);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    for (unsigned long i = 0; i < accesses_; i++)
+    {
+        address_t at = next(zetan, eta, alpha);
+        if (coin(rng_) < write_ratio_)
+            set(at, rng_());
+        else
+            get(at);
+    }
+}
+
+/* LoopingWorkingSet implementation */
+
+LoopingWorkingSet::LoopingWorkingSet(std::string name, unsigned int workingSet, unsigned int loops, unsigned int seed)
+    : Workload(name, seed), working_set_(workingSet), loops_(loops)
+{
+    if (working_set_ == 0)
+        throw std::invalid_argument("working set can't be zero!");
+}
+
+void LoopingWorkingSet::generate()
+{
+    unsigned int working_set = std::min<address_t>(working_set_, size());
+    for (unsigned int l = 0; l < loops_; l++)
+        for (unsigned int i = 0; i < working_set; i++)
+            get(i);
+}
+
+/* PhaseChange implementation */
+
+PhaseChange::PhaseChange(std::string name, unsigned int phases, unsigned long phaseLength, unsigned int workingSet, unsigned int seed)
+    : Workload(name, seed), phases_(phases), phase_length_(phaseLength), working_set_(workingSet)
+{
+    if (working_set_ == 0)
+        throw std::invalid_argument("working set can't be zero!");
+}
+
+void PhaseChange::generate()
+{
+    unsigned int working_set = std::min<address_t>(working_set_, size());
+    std::uniform_int_distribution<address_t> base(0, size() - working_set);
+    std::uniform_int_distribution<unsigned int> index(0, working_set - 1);
+
+    for (unsigned int p = 0; p < phases_; p++)
+    {
+        address_t window = base(rng_);
+        for (unsigned long i = 0; i < phase_length_; i++)
+            get(window + index(rng_));
+    }
+}
+
+/* MatrixMultiply implementation */
+
+MatrixMultiply::MatrixMultiply(std::string name, unsigned int n, unsigned int tile, unsigned int seed)
+    : Workload(name, seed), n_(n), tile_(tile)
+{
+    if (n_ == 0)
+        throw std::invalid_argument("matrix size can't be zero!");
+}
+
+void MatrixMultiply::validate() const
+{
+    if (3 * (address_t)n_ * n_ > size())
+        throw std::logic_error("matrices do not fit in the workload region!");
+}
+
+void MatrixMultiply::generate()
+{
+    /* matrices A, B, C one after another */
+    unsigned int a = 0, b = n_ * n_, c = 2 * n_ * n_;
+    for (unsigned int i = 0; i < n_ * n_; i++)
+        set(c + i, 0);
+
+    if (tile_ == 0)
+        naive(a, b, c);
+    else
+        tiled(a, b, c);
+}
+
+void MatrixMultiply::naive(unsigned int a, unsigned int b, unsigned int c)
+{
+    for (unsigned int i = 0; i < n_; i++)
+        for (unsigned int j = 0; j < n_; j++)
+        {
+            unsigned int sum = 0; /* unsigned, overflow is allowed to wrap */
+            for (unsigned int k = 0; k < n_; k++)
+                sum += (unsigned int)get(a + i * n_ + k) * (unsigned int)get(b + k * n_ + j);
+            set(c + i * n_ + j, sum);
+        }
+}
+
+void MatrixMultiply::tiled(unsigned int a, unsigned int b, unsigned int c)
+{
+    for (unsigned int ii = 0; ii < n_; ii += tile_)
+        for (unsigned int kk = 0; kk < n_; kk += tile_)
+            for (unsigned int jj = 0; jj < n_; jj += tile_)
+                for (unsigned int i = ii; i < std::min(ii + tile_, n_); i++)
+                    for (unsigned int k = kk; k < std::min(kk + tile_, n_); k++)
+                    {
+                        unsigned int lhs = get(a + i * n_ + k);
+                        for (unsigned int j = jj; j < std::min(jj + tile_, n_); j++)
+                        {
+                            unsigned int sum = get(c + i * n_ + j);
+                            set(c + i * n_ + j, sum + lhs * (unsigned int)get(b + k * n_ + j));
+                        }
+                    }
+}
+
+/* HashJoin implementation */
+
+HashJoin::HashJoin(std::string name, unsigned int buildSize, unsigned int probeSize, unsigned int seed)
+    : Workload(name, seed), build_size_(buildSize), probe_size_(probeSize), table_size_(2 * buildSize), matches_(0)
+{
+    if (build_size_ == 0)
+        throw std::invalid_argument("build relation can't be empty!");
+}
+
+unsigned int HashJoin::hash(int key) const
+{
+    return ((unsigned int)key * 2654435761u) % table_size_;
+}
+
+void HashJoin::validate() const
+{
+    if ((address_t)build_size_ + probe_size_ + table_size_ > size())
+        throw std::logic_error("relations do not fit in the workload region!");
+}
+
+void HashJoin::generate()
+{
+    /* build relation, probe relation and the hash table one after another */
+    unsigned int build = 0, probe = build_size_, table = build_size_ + probe_size_;
+    matches_ = 0;
+
+    /* a slot keeps (index in build relation + 1), zero is empty */
+    for (unsigned int i = 0; i < table_size_; i++)
+        set(table + i, 0);
+
+    for (unsigned int i = 0; i < build_size_; i++)
+    {
+        unsigned int slot = hash(get(build + i));
+        while (get(table + slot) != 0)
+            slot = (slot + 1) % table_size_;
+        set(table + slot, i + 1);
+    }
+
+    for (unsigned int i = 0; i < probe_size_; i++)
+    {
+        int key = get(probe + i);
+        unsigned int slot = hash(key);
+        int entry;
+        while ((entry = get(table + slot)) != 0)
+        {
+            if (get(build + entry - 1) == key)
+                matches_++;
+            slot = (slot + 1) % table_size_;
+        }
+    }
+}
+
+unsigned int HashJoin::getMatches() const
+{
+    return matches_;
+}
+
+#endif
@@ -1,5 +1,5 @@
 #include <iostream>
-#include "file-system.h"
+#include "../Part_3_Program/file-system.h" /* the one file system of both parts */
 using namespace std;
 
 #define KB 1024
@@ -7,9 +7,11 @@ using namespace std;
 void usage()
 {
     std::cout << "Usage: makeFileSystem 4 400 mySystem.dat" << std::endl;
-    std::cout << "makeFileSystem <block_size> <inode_count> <disc_name>" << std::endl;
+    std::cout << "makeFileSystem <block_size> <inode_count> <disc_name> [<disc_size>] [extents]" << std::endl;
     std::cout << "<block_size> unsigned integer" << std::endl;
     std::cout << "<inode_count> unsigned integer" << std::endl;
+    std::cout << "<disc_size> unsigned integer, in MB. 1 by default" << std::endl;
+    std::cout << "extents: the files are mapped by extents instead of block references" << std::endl;
 }
 
 int main(int argc, char const *argv[])
@@ -19,12 +21,16 @@ int main(int argc, char const *argv[])
         const int block_size = std::stoi(argv[1]);
         const int inode_count = std::stoi(argv[2]);
         std::string disc_name = argv[3];
-        
+        const uint64_t disc_size = argc > 4 ? std::stoull(argv[4]) : 1;
+        const bool extents = argc > 5 && std::string(argv[5]) == "extents";
 
-        if (block_size == 0 || inode_count == 0)
+        if (block_size == 0 || inode_count == 0 || disc_size == 0)
             throw std::logic_error("size can't be zero!");
 
-        FileSystem::settings(KB * block_size, inode_count);
+        if (argc > 5 && !extents)
+            throw std::invalid_argument("unknown file mapping " + std::string(argv[5]));
+
+        FileSystem::settings(KB * block_size, inode_count, disc_size * MB, extents);
         FileSystem* fs = FileSystem::create(disc_name);
         fs->close();
         std::cout << "Disc is created!" << std::endl;
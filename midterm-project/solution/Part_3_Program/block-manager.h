@@ -1,318 +1,392 @@
-
 /**
  * controller class for data-blocks in file system.
+ * the free blocks are kept in a bitmap of 64-bit words, the same bytes as the bitmap on disc, 1 for a used block:
+ *  -> block i is the bit i % 64 of the word i / 64, so loading and storing the bitmap is a memcpy.
+ *  -> a summary bit per word is set once the word is full, allocations skip 64 full words at a time.
+ *  -> a free block is found by the ctz of the inverted word, the lowest free word is remembered.
+ * single blocks go through the buffer cache, the blocks of a file go around it in runs. @see readBlocks()
  ***/
 
 #include <fstream>
 #include <string>
 #include <iostream>
-#include <stack>
+#include <vector>
 #include <set>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 #include <stdint.h>
+#include "io-communicator.h"
+#include "buffer-cache.h"
 
 #ifndef BLOCKMANAGER_H
 #define BLOCKMANAGER_H
 
-class IOCommunicator
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the bitmap words are the bytes of the disc bitmap only on a little endian host"
+#endif
+
+#define BITMAP_WORD_BITS 64 /* the bitmap is persisted in words of 8 bytes */
+
+class BlockManager
 {
 public:
-    /*
-     * creates an input-output communicator.
-     **/
-    IOCommunicator(bool = false);
-
     /**
-     * destroys the connection io disc. must be called at some point to free the resources.
+     * creates a block manager with given total block size.
      **/
-    void closeDisc();
+    BlockManager(block_t _total, unsigned int size, uint64_t offset, std::string discName,
+                 unsigned int cacheBlocks = BUFFER_CACHE_BLOCKS);
+    ~BlockManager();
+
+    void initialize(unsigned int, uint64_t, std::string);
+    uint32_t getTotal() const;
+    uint32_t freeTotal() const;
+    std::vector<block_t> occupied() const; /* in order */
+
+    void read(const char *);  /* builds from the bitmap of an existing disc, total / 8 bytes rounded up */
+    void write(char *) const; /* the bitmap of the disc, total / 8 bytes rounded up */
+    bool inFree(block_t);
 
     /**
-     * gets the size of block in bytes.
+     * words of the bitmap changed by allocations since it is read or written last time.
      **/
-    unsigned int getSize();
+    std::set<uint32_t> changedWords() const;
+    void clearChanged();
+
+    /** model: block creator and destroyers */
+
+    block_t allocateBlock();
+    void deallocateBlock(block_t);
 
     /**
-     * gets the index of block in block table.
+     * allocates the first run of count free blocks in a row, returns its first block.
+     * returns getTotal() and allocates nothing if there is no such run.
      **/
-    uint16_t getIndex();
+    block_t allocateRange(block_t count);
 
     /**
-     * sets the index of block in block table.
+     * allocates the free blocks in a row from first on, at most count of them, returns how many.
+     * for the blocks right after the end of a file, so its last run goes on.
      **/
-    void setIndex(unsigned int);
+    block_t allocateAt(block_t first, block_t count);
 
-    void setData(void *);
-    void *getData() const;
+    /** controller: block mutator and accessors of the disc, through the buffer cache. **/
 
-    /**
-     * factory functions for io-communicator.
-     */
-    IOCommunicator &initDisc(std::string);
-    IOCommunicator &initSize(unsigned int);
-    IOCommunicator &initOffset(unsigned int);
+    void setBlock(block_t index, void *); /* copies into the cache, written back later */
+    BlockHandle getBlock(block_t index);  /* pinned until the handle goes out of scope */
 
-    void checkInitialized() const;
+    /**
+     * the given blocks in order, to or from data of blocks * size bytes. the blocks in a row on disc make up
+     * a run, read or written by one vectored call straight between the disc and data. the cached copies of
+     * the blocks are newer than the disc on read, and take the new data on write.
+     **/
+    void readBlocks(const std::vector<block_t> &blocks, char *data);
+    void writeBlocks(const std::vector<block_t> &blocks, const char *data);
 
-    void readFromDisc();
-    void writeToDisc();
-    void setUpCursor();
+    void flush(); /* writes the dirty blocks to disc */
+    BufferCache::Stats getCacheStats() const;
 
 private:
-    void *data; // there won't any allocation. only a reference.
-    std::fstream discIO;
-    unsigned int size;   // block size, will be same for all block in one session;
-    unsigned int offset; // data blocks start offset in disc.
-    uint16_t index;
-    bool binary;
-
-    bool sizeInitialized;
-    bool offsetInitialized;
-    bool discInitialized;
+    std::vector<uint64_t> words;   // bit per block, 1 if used.
+    std::vector<uint64_t> summary; // bit per word, 1 if the word is full.
+    std::set<uint32_t> changed;
+    IOCommunicator communicator;
+    BufferCache cache;
+    block_t total; // total block size;
+    block_t used;
+    size_t lowest; // no free block in the words before.
+
+    uint64_t validMask(size_t word) const; /* bits of the word that are blocks */
+    void updateSummary(size_t word);
+    size_t freeWord(size_t from) const;         /* first word with a free block, words.size() if none */
+    block_t nextBlock(block_t from, bool) const; /* first block from on that is used or free, total if none */
+    void mark(block_t first, block_t count, bool);
+    void transferBlocks(const std::vector<block_t> &blocks, char *data, bool write);
 };
 
-IOCommunicator::IOCommunicator(bool _binary)
-    : size(0),
-      offset(0),
-      index(0),
-      binary(_binary),
-      sizeInitialized(false),
-      offsetInitialized(false),
-      discInitialized(false)
-{ /* intentionally left blank */
-}
-
-void IOCommunicator::setUpCursor()
+BlockManager::BlockManager(block_t _total, unsigned int size, uint64_t offset, std::string discName,
+                           unsigned int cacheBlocks)
+    : communicator(), cache(communicator, cacheBlocks), total(_total), used(0), lowest(0)
 {
-    checkInitialized();
-    discIO.seekp(offset + (getIndex() * getSize()));
-}
 
-void IOCommunicator::readFromDisc()
-{
-    setUpCursor();
-    discIO.read((char *)getData(), getSize());
-}
+    if (total == 0)
+        throw std::invalid_argument("block number can't be zero!");
 
-void IOCommunicator::writeToDisc()
-{
-    setUpCursor();
-    discIO.write((char *)getData(), getSize());
+    communicator.initSize(size).initOffset(offset).initDisc(discName);
+
+    // all blocks are free, the summary bits after the last word are full so they are never chosen.
+    words.assign((total + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS, 0);
+    summary.assign((words.size() + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS, 0);
+    if (words.size() % BITMAP_WORD_BITS)
+        summary.back() = ~(uint64_t)0 << (words.size() % BITMAP_WORD_BITS);
 }
 
-IOCommunicator &IOCommunicator::initSize(unsigned int _size)
+BlockManager::~BlockManager()
 {
-    if (sizeInitialized)
-        throw std::logic_error("can't initialize size once more!");
-    if (_size == 0)
-        throw std::invalid_argument("size can't be zero!");
-    size = _size;
-    sizeInitialized = true;
-    return *this;
+    cache.flush();
+    communicator.closeDisc();
 }
 
-IOCommunicator &IOCommunicator::initOffset(unsigned int _offset)
+void BlockManager::initialize(unsigned int size, uint64_t offset, std::string discName)
 {
-    if (offsetInitialized)
-        throw std::logic_error("can't initialize offset once more!");
-    offset = _offset;
-    offsetInitialized = true;
-    return *this;
+    communicator.initSize(size).initOffset(offset).initDisc(discName);
 }
 
-IOCommunicator &IOCommunicator::initDisc(std::string discName)
+uint32_t BlockManager::getTotal() const
 {
-    if (discInitialized)
-        throw std::logic_error("can't initialize disc once more!");
-    std::ios_base::openmode mode = std::ios::in | std::ios::out;
-    discIO.open(discName, binary ? mode | std::ios::binary : mode);
-    discInitialized = true;
-    return *this;
+    return total;
 }
 
-void IOCommunicator::closeDisc()
+uint32_t BlockManager::freeTotal() const
 {
-    checkInitialized();
-    discIO.close();
+    return total - used;
 }
 
-unsigned int IOCommunicator::getSize()
+std::vector<block_t> BlockManager::occupied() const
 {
-    return size;
+    std::vector<block_t> occupied;
+    occupied.reserve(used);
+    for (size_t w = 0; w < words.size(); w++)
+        for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) /* drops the lowest set bit */
+            occupied.push_back(w * BITMAP_WORD_BITS + __builtin_ctzll(bits));
+    return occupied;
 }
 
-void IOCommunicator::setIndex(unsigned int _index)
+void BlockManager::read(const char *raw)
 {
-    index = _index;
+    communicator.checkInitialized(); /* communicator must be initialized before build */
+
+    memset(words.data(), 0, words.size() * sizeof(uint64_t));
+    memcpy(words.data(), raw, total / 8 + ((total % 8) ? 1 : 0));
+    words.back() &= validMask(words.size() - 1);
+
+    used = 0;
+    lowest = words.size();
+    for (size_t w = 0; w < words.size(); w++)
+    {
+        used += __builtin_popcountll(words[w]);
+        updateSummary(w);
+        if (lowest == words.size() && words[w] != validMask(w))
+            lowest = w;
+    }
 }
 
-uint16_t IOCommunicator::getIndex()
+void BlockManager::write(char *raw) const
 {
-    return index;
+    communicator.checkInitialized();
+    memcpy(raw, words.data(), total / 8 + ((total % 8) ? 1 : 0));
 }
 
-void IOCommunicator::checkInitialized() const
+std::set<uint32_t> BlockManager::changedWords() const
 {
-    if (!(sizeInitialized && offsetInitialized && discInitialized))
-        throw std::logic_error("unitialized state in communicator!");
+    return changed;
 }
 
-void *IOCommunicator::getData() const
+void BlockManager::clearChanged()
 {
-    return data;
+    changed.clear();
 }
 
-void IOCommunicator::setData(void *_data)
+void BlockManager::setBlock(block_t index, void *data)
 {
-    data = _data;
+    if (inFree(index))
+        throw std::logic_error("desired block in the index is in free list!");
+    communicator.checkInitialized();
+    BlockHandle block = cache.overwrite(index);
+    memcpy(block.data(), data, communicator.getSize());
+    block.markDirty();
 }
 
-class BlockManager
+BlockHandle BlockManager::getBlock(block_t index)
 {
-public:
-    /**
-     * creates a block manager with given total block size.
-     **/
-    BlockManager(uint16_t _total, unsigned int size, unsigned int offset, std::string discName);
-    ~BlockManager();
-
-    void initialize(unsigned int, unsigned int, std::string);
-    uint32_t getTotal() const;
-    uint32_t freeTotal() const;
-    std::set<uint16_t> occupied() const;
-
-    void read(bool *); /* builds from and existing disc */
-    bool *write() const;
-    bool inFree(uint16_t);
-
-    /** model: block creator and destroyers */
-
-    uint16_t allocateBlock();
-    void deallocateBlock(uint16_t);
-
-    /** controller: block mutator and accessors of the disc. **/
-
-    void setBlock(uint16_t index, void *);
-    void *getBlock(uint16_t index);
-
-private:
-    std::stack<uint16_t> free;
-    std::set<uint16_t> full;
-    IOCommunicator communicator;
-    uint16_t total; // total block size;
-};
+    if (inFree(index))
+        throw std::logic_error("desired block in the index is in free list!");
+    communicator.checkInitialized();
+    return cache.get(index);
+}
 
-BlockManager::BlockManager(uint16_t _total, unsigned int size, unsigned int offset, std::string discName)
-    : communicator(true), total(_total)
+void BlockManager::readBlocks(const std::vector<block_t> &blocks, char *data)
 {
-
-    if (total == 0)
-        throw std::invalid_argument("block number can't be zero!");
-
-    communicator.initSize(size).initOffset(offset).initDisc(discName);
-
-    // fill the free list with all blocks.
-    for (uint16_t i = 0; i < total; i++)
-        free.push((total - 1) - i);
+    transferBlocks(blocks, data, false);
 }
 
-BlockManager::~BlockManager()
+void BlockManager::writeBlocks(const std::vector<block_t> &blocks, const char *data)
 {
-    communicator.closeDisc();
+    transferBlocks(blocks, (char *)data, true);
 }
 
-void BlockManager::initialize(unsigned int size, unsigned int offset, std::string discName)
+void BlockManager::transferBlocks(const std::vector<block_t> &blocks, char *data, bool write)
 {
-    communicator.initSize(size).initOffset(offset).initDisc(discName);
+    communicator.checkInitialized();
+    size_t size = communicator.getSize();
+    for (size_t i = 0, run; i < blocks.size(); i += run)
+    {
+        for (run = 1; i + run < blocks.size() && blocks[i + run] == blocks[i] + run; run++)
+            ;
+        for (size_t j = i; j < i + run; j++)
+            if (inFree(blocks[j]))
+                throw std::logic_error("desired block in the index is in free list!");
+
+        /* the blocks of a run are in a row in data too */
+        char *p = data + i * size;
+        std::vector<struct iovec> buffers(1, iovec{p, run * size});
+        if (write)
+        {
+            communicator.writeRun(blocks[i], buffers);
+            cache.updateCached(blocks[i], run, p);
+        }
+        else
+        {
+            communicator.readRun(blocks[i], buffers);
+            cache.copyCached(blocks[i], run, p);
+        }
+    }
 }
 
-uint32_t BlockManager::getTotal() const
+void BlockManager::flush()
 {
-    return total;
+    cache.flush();
 }
 
-uint32_t BlockManager::freeTotal() const
+BufferCache::Stats BlockManager::getCacheStats() const
 {
-    return free.size();
+    return cache.getStats();
 }
 
-std::set<uint16_t> BlockManager::occupied() const
+block_t BlockManager::allocateBlock()
 {
-    std::set<uint16_t> occupied(full);
-    return occupied;
+    communicator.checkInitialized();
+    lowest = freeWord(lowest);
+    if (lowest == words.size())
+        throw std::logic_error("no free block left!");
+    block_t next = lowest * BITMAP_WORD_BITS + __builtin_ctzll(~words[lowest] & validMask(lowest));
+    mark(next, 1, true);
+    return next;
 }
 
-void BlockManager::read(bool *table)
+block_t BlockManager::allocateRange(block_t count)
 {
-    communicator.checkInitialized(); /* communicator must be initialized before build */
-
-    while (!free.empty())
-        free.pop();
+    communicator.checkInitialized();
+    if (count == 0 || count > total - used)
+        return total;
 
-    // fill the free list with all blocks.
-    for (uint16_t i = 0; i < total; i++)
+    /* first fit: from every free block to the next used one */
+    for (block_t first = nextBlock(lowest * BITMAP_WORD_BITS, false); first < total;)
     {
-        if (table[(total - 1) - i])
-            full.insert((total - 1) - i);
-        else
-            free.push((total - 1) - i);
+        block_t end = nextBlock(first, true);
+        if (end - first >= count)
+        {
+            mark(first, count, true);
+            return first;
+        }
+        if (end == total)
+            break;
+        first = nextBlock(end, false);
     }
+    return total;
 }
 
-bool *BlockManager::write() const
+block_t BlockManager::allocateAt(block_t first, block_t count)
 {
     communicator.checkInitialized();
-    size_t size = total / 8 + ((total % 8) ? 1 : 0);
-    bool *table = new bool[size * 8];
-    for (size_t i = 0; i < size; i++)
-        table[i] = (full.count(i) != 0);
-    return table;
+    if (first >= total || count == 0)
+        return 0;
+    block_t end = std::min<uint64_t>(nextBlock(first, true), (uint64_t)first + count);
+    if (end > first)
+        mark(first, end - first, true);
+    return end - first;
 }
 
-void BlockManager::setBlock(uint16_t index, void *data)
+void BlockManager::deallocateBlock(block_t index)
 {
-    if (inFree(index))
-        throw std::logic_error("desired block in the index is in free list!");
     communicator.checkInitialized();
-    communicator.setIndex(index);
-    communicator.setData(data);
-    communicator.writeToDisc();
+    if (inFree(index))
+        return;
+    mark(index, 1, false);
+    cache.discard(index); /* its content doesn't matter anymore */
 }
 
-void *BlockManager::getBlock(uint16_t index)
+bool BlockManager::inFree(block_t index)
 {
-    if (inFree(index))
-        throw std::logic_error("desired block in the index is in free list!");
+    if (index >= total)
+        throw std::logic_error("index out of boundaries!");
     communicator.checkInitialized();
-    communicator.setIndex(index);
-    void *data = new char[communicator.getSize()];
-    communicator.setData(data);
-    communicator.readFromDisc();
-    return data;
+    return !((words[index / BITMAP_WORD_BITS] >> (index % BITMAP_WORD_BITS)) & 1);
 }
 
-uint16_t BlockManager::allocateBlock()
+uint64_t BlockManager::validMask(size_t word) const
 {
-    communicator.checkInitialized();
-    uint16_t next = free.top();
-    free.pop();
-    full.insert(next);
-    return next;
+    size_t last = total - word * BITMAP_WORD_BITS;
+    return last >= BITMAP_WORD_BITS ? ~(uint64_t)0 : ((uint64_t)1 << last) - 1;
 }
 
-void BlockManager::deallocateBlock(uint16_t index)
+void BlockManager::updateSummary(size_t word)
 {
-    communicator.checkInitialized();
-    full.erase(index);
-    free.push(index);
+    uint64_t bit = (uint64_t)1 << (word % BITMAP_WORD_BITS);
+    if (words[word] == validMask(word))
+        summary[word / BITMAP_WORD_BITS] |= bit;
+    else
+        summary[word / BITMAP_WORD_BITS] &= ~bit;
 }
 
-bool BlockManager::inFree(uint16_t index)
+size_t BlockManager::freeWord(size_t from) const
 {
-    if (index >= total)
-        std::logic_error("index out of boundaries!");
-    communicator.checkInitialized();
-    const bool in_full = full.find(index) != full.end();
-    return !in_full;
+    for (size_t s = from / BITMAP_WORD_BITS; s < summary.size(); s++)
+    {
+        uint64_t free_words = ~summary[s];
+        if (s == from / BITMAP_WORD_BITS)
+            free_words &= ~(uint64_t)0 << (from % BITMAP_WORD_BITS);
+        if (free_words != 0)
+            return s * BITMAP_WORD_BITS + __builtin_ctzll(free_words);
+    }
+    return words.size();
+}
+
+block_t BlockManager::nextBlock(block_t from, bool in_use) const
+{
+    if (from >= total)
+        return total;
+    size_t w = from / BITMAP_WORD_BITS;
+    uint64_t bits = (in_use ? words[w] : ~words[w] & validMask(w)) & (~(uint64_t)0 << (from % BITMAP_WORD_BITS));
+    while (bits == 0)
+    {
+        if (in_use)
+        {
+            while (++w < words.size() && words[w] == 0) /* free words are skipped one by one */
+                ;
+        }
+        else
+            w = freeWord(w + 1); /* full words 64 at a time */
+        if (w >= words.size())
+            return total;
+        bits = in_use ? words[w] : ~words[w] & validMask(w);
+    }
+    return w * BITMAP_WORD_BITS + __builtin_ctzll(bits);
+}
+
+void BlockManager::mark(block_t first, block_t count, bool in_use)
+{
+    uint64_t last = (uint64_t)first + count;
+    for (size_t w = first / BITMAP_WORD_BITS; w * BITMAP_WORD_BITS < last; w++)
+    {
+        uint64_t begin = std::max<uint64_t>(first, w * BITMAP_WORD_BITS) - w * BITMAP_WORD_BITS;
+        uint64_t end = std::min<uint64_t>(last, (w + 1) * BITMAP_WORD_BITS) - w * BITMAP_WORD_BITS;
+        uint64_t mask = (end == BITMAP_WORD_BITS ? ~(uint64_t)0 : ((uint64_t)1 << end) - 1) & (~(uint64_t)0 << begin);
+
+        if (in_use)
+        {
+            used += __builtin_popcountll(mask & ~words[w]);
+            words[w] |= mask;
+        }
+        else
+        {
+            used -= __builtin_popcountll(mask & words[w]);
+            words[w] &= ~mask;
+            lowest = std::min(lowest, w);
+        }
+        updateSummary(w);
+        changed.insert(w);
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,300 @@
+/**
+ * write-back cache of the blocks of one block table, in front of its io-communicator.
+ * holds at most <capacity> blocks. a miss takes a free buffer or evicts one by CLOCK:
+ * the hand skips the pinned buffers and gives the referenced ones a second chance.
+ * a dirty buffer is written to disc only when it is evicted or flushed.
+ *
+ * callers get pinned block handles instead of fresh copies. a pinned buffer is never evicted,
+ * the handle unpins it when it goes out of scope.
+ **/
+
+#ifndef BUFFER_CACHE_H
+#define BUFFER_CACHE_H
+
+#include <map>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include "io-communicator.h"
+
+#define BUFFER_CACHE_BLOCKS 64
+
+class BufferCache;
+
+class BlockHandle
+{
+public:
+    BlockHandle(BufferCache *, size_t);
+    BlockHandle(const BlockHandle &); /* pins once more */
+    BlockHandle &operator=(const BlockHandle &) = delete;
+    ~BlockHandle();
+
+    char *data() const;
+    block_t getIndex() const;
+
+    /**
+     * the block is written back before its buffer is reused.
+     **/
+    void markDirty();
+
+private:
+    BufferCache *cache;
+    size_t buffer;
+};
+
+class BufferCache
+{
+public:
+    BufferCache(IOCommunicator &, unsigned int capacity = BUFFER_CACHE_BLOCKS);
+    ~BufferCache();
+
+    BufferCache(const BufferCache &) = delete;
+    BufferCache &operator=(const BufferCache &) = delete;
+
+    /**
+     * pinned handle of the block, read from disc on a miss.
+     **/
+    BlockHandle get(block_t index);
+
+    /**
+     * pinned handle of the block that is going to be overwritten as a whole, so a miss doesn't read it.
+     **/
+    BlockHandle overwrite(block_t index);
+
+    /**
+     * writes all dirty blocks to disc.
+     **/
+    void flush();
+
+    /**
+     * forgets the block without writing it back, for the freed blocks. a pinned buffer is reused once unpinned.
+     **/
+    void discard(block_t index);
+
+    /**
+     * for the runs read or written around the cache, straight between the disc and the buffers of the caller:
+     * copies the cached blocks of the run over the data read, they are newer than the disc.
+     * updates the cached blocks of the run to the data written, they are clean then.
+     **/
+    void copyCached(block_t first, block_t count, char *data) const;
+    void updateCached(block_t first, block_t count, const char *data);
+
+    struct Stats
+    {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        unsigned long writeBacks;
+    };
+    Stats getStats() const;
+    unsigned int getCapacity() const;
+
+private:
+    friend class BlockHandle;
+
+    struct Buffer
+    {
+        block_t index;
+        char *data;
+        bool valid;
+        bool dirty;
+        bool referenced;
+        unsigned int pins;
+    };
+
+    IOCommunicator &communicator;
+    std::vector<Buffer> buffers;
+    std::map<block_t, size_t> lookup; // block index -> buffer
+    size_t hand;
+    Stats stats;
+
+    BlockHandle find(block_t index, bool read);
+    size_t victim();
+    void writeBack(Buffer &);
+};
+
+/* BlockHandle Implementation */
+
+BlockHandle::BlockHandle(BufferCache *_cache, size_t _buffer)
+    : cache(_cache), buffer(_buffer)
+{
+    cache->buffers[buffer].pins++;
+}
+
+BlockHandle::BlockHandle(const BlockHandle &other)
+    : cache(other.cache), buffer(other.buffer)
+{
+    cache->buffers[buffer].pins++;
+}
+
+BlockHandle::~BlockHandle()
+{
+    cache->buffers[buffer].pins--;
+}
+
+char *BlockHandle::data() const
+{
+    return cache->buffers[buffer].data;
+}
+
+block_t BlockHandle::getIndex() const
+{
+    return cache->buffers[buffer].index;
+}
+
+void BlockHandle::markDirty()
+{
+    cache->buffers[buffer].dirty = true;
+}
+
+/* BufferCache Implementation */
+
+BufferCache::BufferCache(IOCommunicator &_communicator, unsigned int capacity)
+    : communicator(_communicator), hand(0)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("buffer cache needs at least one block!");
+    stats = Stats{0, 0, 0, 0};
+    buffers.resize(capacity);
+    for (auto &b : buffers)
+    {
+        b.data = nullptr; /* the block size is known once the communicator is initialized */
+        b.valid = b.dirty = b.referenced = false;
+        b.pins = 0;
+        b.index = 0;
+    }
+}
+
+BufferCache::~BufferCache()
+{
+    for (auto &b : buffers)
+        delete[] b.data;
+}
+
+BlockHandle BufferCache::get(block_t index)
+{
+    return find(index, true);
+}
+
+BlockHandle BufferCache::overwrite(block_t index)
+{
+    return find(index, false);
+}
+
+BlockHandle BufferCache::find(block_t index, bool read)
+{
+    auto it = lookup.find(index);
+    if (it != lookup.end())
+    {
+        stats.hits++;
+        buffers[it->second].referenced = true;
+        return BlockHandle(this, it->second);
+    }
+
+    stats.misses++;
+    size_t i = victim();
+    Buffer &b = buffers[i];
+    if (b.data == nullptr)
+        b.data = new char[communicator.getSize()];
+    b.index = index;
+    b.valid = true;
+    b.dirty = false;
+    b.referenced = true;
+    lookup[index] = i;
+    if (read)
+    {
+        communicator.setIndex(index);
+        communicator.setData(b.data);
+        communicator.readFromDisc();
+    }
+    return BlockHandle(this, i);
+}
+
+size_t BufferCache::victim()
+{
+    /* two rounds clear every reference bit, a third one finds nothing only if all are pinned */
+    for (size_t step = 0; step < 3 * buffers.size(); step++)
+    {
+        size_t current = hand;
+        hand = (hand + 1) % buffers.size();
+
+        Buffer &b = buffers[current];
+        if (b.pins != 0)
+            continue;
+        if (!b.valid)
+            return current;
+        if (b.referenced)
+        {
+            b.referenced = false;
+            continue;
+        }
+
+        stats.evictions++;
+        if (b.dirty)
+            writeBack(b);
+        lookup.erase(b.index);
+        b.valid = false;
+        return current;
+    }
+    throw std::logic_error("all blocks in the buffer cache are pinned!");
+}
+
+void BufferCache::writeBack(Buffer &b)
+{
+    communicator.setIndex(b.index);
+    communicator.setData(b.data);
+    communicator.writeToDisc();
+    b.dirty = false;
+    stats.writeBacks++;
+}
+
+void BufferCache::flush()
+{
+    /* in the order of the blocks, so the writes go forward on disc */
+    for (auto &entry : lookup)
+        if (buffers[entry.second].dirty)
+            writeBack(buffers[entry.second]);
+    communicator.flushDisc();
+}
+
+void BufferCache::discard(block_t index)
+{
+    auto it = lookup.find(index);
+    if (it == lookup.end())
+        return;
+    /* a pinned one is only forgotten, its handles keep the buffer until the last one unpins it.
+       the block is read anew if it is used again, and the writes through the old handles are lost */
+    buffers[it->second].valid = false;
+    buffers[it->second].dirty = false;
+    lookup.erase(it);
+}
+
+void BufferCache::copyCached(block_t first, block_t count, char *data) const
+{
+    size_t size = communicator.getSize();
+    for (auto it = lookup.lower_bound(first); it != lookup.end() && it->first - first < count; ++it)
+        memcpy(data + (it->first - first) * size, buffers[it->second].data, size);
+}
+
+void BufferCache::updateCached(block_t first, block_t count, const char *data)
+{
+    size_t size = communicator.getSize();
+    for (auto it = lookup.lower_bound(first); it != lookup.end() && it->first - first < count; ++it)
+    {
+        memcpy(buffers[it->second].data, data + (it->first - first) * size, size);
+        buffers[it->second].dirty = false;
+    }
+}
+
+BufferCache::Stats BufferCache::getStats() const
+{
+    return stats;
+}
+
+unsigned int BufferCache::getCapacity() const
+{
+    return buffers.size();
+}
+
+#endif
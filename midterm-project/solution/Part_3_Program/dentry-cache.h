@@ -0,0 +1,157 @@
+/**
+ * cache of the directory entries met on path resolution, @see FileSystem::cd()
+ * maps (directory inode, name) to the inode of the entry. a name that is not in the directory is cached too,
+ * as a negative entry, so a missing path fails without reading the directory once more.
+ * holds at most <capacity> entries, the least recently used one is evicted.
+ *
+ * the file system invalidates an entry whenever it changes the directory entry, and all entries of a
+ * directory when the directory is removed.
+ **/
+
+#ifndef DENTRY_CACHE_H
+#define DENTRY_CACHE_H
+
+#include <map>
+#include <list>
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include <stdint.h>
+#include "serializable.h"
+
+#define DENTRY_CACHE_ENTRIES 1024
+
+class DentryCache
+{
+public:
+    DentryCache(unsigned int capacity = DENTRY_CACHE_ENTRIES);
+
+    enum Result
+    {
+        MISS,
+        FOUND,
+        NOT_FOUND /* negative entry */
+    };
+
+    /**
+     * sets the inode if it is found.
+     **/
+    Result lookup(block_t directory, const std::string &name, block_t &inode);
+
+    void insert(block_t directory, const std::string &name, block_t inode);
+    void insertNegative(block_t directory, const std::string &name);
+
+    void invalidate(block_t directory, const std::string &name);
+    void invalidateDirectory(block_t directory); /* all of its entries */
+
+    struct Stats
+    {
+        unsigned long hits;
+        unsigned long negativeHits;
+        unsigned long misses;
+        unsigned long evictions;
+    };
+    Stats getStats() const;
+
+private:
+    typedef std::pair<block_t, std::string> Key;
+
+    struct Entry
+    {
+        block_t inode;
+        bool negative;
+        std::list<Key>::iterator age;
+    };
+
+    unsigned int capacity;
+    std::map<Key, Entry> entries; // ordered, the entries of a directory are in a row.
+    std::list<Key> recent;        // most recently used first.
+    Stats stats;
+
+    void put(const Key &, block_t inode, bool negative);
+    void erase(std::map<Key, Entry>::iterator);
+};
+
+DentryCache::DentryCache(unsigned int _capacity) : capacity(_capacity)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("dentry cache needs at least one entry!");
+    stats = Stats{0, 0, 0, 0};
+}
+
+DentryCache::Result DentryCache::lookup(block_t directory, const std::string &name, block_t &inode)
+{
+    auto it = entries.find(Key(directory, name));
+    if (it == entries.end())
+    {
+        stats.misses++;
+        return MISS;
+    }
+
+    recent.splice(recent.begin(), recent, it->second.age);
+    if (it->second.negative)
+    {
+        stats.negativeHits++;
+        return NOT_FOUND;
+    }
+    stats.hits++;
+    inode = it->second.inode;
+    return FOUND;
+}
+
+void DentryCache::insert(block_t directory, const std::string &name, block_t inode)
+{
+    put(Key(directory, name), inode, false);
+}
+
+void DentryCache::insertNegative(block_t directory, const std::string &name)
+{
+    put(Key(directory, name), 0, true);
+}
+
+void DentryCache::put(const Key &key, block_t inode, bool negative)
+{
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+        it->second.inode = inode;
+        it->second.negative = negative;
+        recent.splice(recent.begin(), recent, it->second.age);
+        return;
+    }
+
+    if (entries.size() == capacity)
+    {
+        stats.evictions++;
+        erase(entries.find(recent.back()));
+    }
+    recent.push_front(key);
+    entries.insert(std::make_pair(key, Entry{inode, negative, recent.begin()}));
+}
+
+void DentryCache::invalidate(block_t directory, const std::string &name)
+{
+    auto it = entries.find(Key(directory, name));
+    if (it != entries.end())
+        erase(it);
+}
+
+void DentryCache::invalidateDirectory(block_t directory)
+{
+    auto it = entries.lower_bound(Key(directory, ""));
+    while (it != entries.end() && it->first.first == directory)
+        erase(it++);
+}
+
+void DentryCache::erase(std::map<Key, Entry>::iterator it)
+{
+    recent.erase(it->second.age);
+    entries.erase(it);
+}
+
+DentryCache::Stats DentryCache::getStats() const
+{
+    return stats;
+}
+
+#endif
@@ -1,18 +1,34 @@
 /***
- * represents an UNIX-like directory.
+ * represents an UNIX-like directory, kept in the blocks of its file and indexed by the hashes of the names.
  * our UNIX-like directory contains one entry directory for each file in that directory.
- * A directory entry contains only two fields: the file name (14 bytes) and
- * the number of the i-node for that file (2 bytes).
- * 
- * [2byte]|[14byte]
+ * A directory entry contains three fields: the number of the i-node for that file (4 bytes),
+ * the file name (13 bytes) and whether it is a directory (1 byte).
+ *
+ * [4byte]|[13byte]|[1byte]
+ *
+ * the first block of the directory is its root: the directory itself, its parent and the top of the index.
+ *  -> [magic|parent|current|levels][index node]
+ *  -> [4byte+ 4byte+ 4byte  + 4byte] + the rest of the block.
+ * an index node maps the names whose hash is from the hash of an entry up to the hash of the next entry to a
+ * block of the directory file. they are leaves if the root has 0 levels, index nodes of leaves if it has 1.
+ *  -> [count][hash|block]...[hash|block]
+ *  -> [4byte]+ count * (4byte + 4byte).
+ * a leaf holds the directory entries of its hashes, in no order.
+ *  -> [count][directory entry]...[directory entry]
+ *  -> [4byte]+ count * 18 bytes.
+ *
+ * a name is found by the root, at most one index node and its leaf. an insert or a removal writes the leaf only,
+ * a full leaf is split in two by the hashes and the new leaf goes into the index. @see FileSystem::addEntry()
  * */
 
 #ifndef DIRECTORY_H
 #define DIRECTORY_H
 
-#include <map>
+#include <string>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include "serializable.h"
 #include <stdint.h>
 
@@ -21,29 +37,63 @@
 #define PARENT_PATH ".."
 
 #define FILE_LENGTH 13
+#define DIRECTORY_MAGIC 0x52494448 /* "HDIR" */
 
-class Directory : Serializable
+/* the names whose hash is from hash on are in the block of the directory file */
+struct HashIndex
+{
+    uint32_t hash;
+    block_t block;
+};
+
+class DirectoryIndex : public Serializable
+{
+public:
+    /* a node of the given bytes on disc, the rest of the root or a block */
+    DirectoryIndex(uint32_t bytes = 0);
+
+    /* serialization */
+    char *write(uint32_t *);
+    void read(char *);
+
+    uint32_t getCapacity() const;
+    size_t find(uint32_t hash) const; /* the entry of the hash */
+    void insert(const HashIndex &);   /* in the order of the hashes */
+
+    std::vector<HashIndex> entries;
+
+    static const uint32_t headerSize;
+
+private:
+    uint32_t bytes;
+};
+
+class Directory : public Serializable
 {
 public:
     Directory();
-    Directory(uint16_t parent, uint16_t current);
-    uint16_t getFile(std::string) const;
+    Directory(block_t parent, block_t current);
+
+    block_t getParent() const;
+    block_t getCurrent() const;
+    uint32_t getLevels() const;
+    void setLevels(uint32_t);
 
     /* serialization */
     char *write(uint32_t *);
     void read(char *);
 
-    void printFiles() const;
+    static uint32_t hash(const std::string &);
 
     class DirectoryEntry : public Serializable
     {
     public:
-        DirectoryEntry(uint16_t = 0, const char * = "unnamed", bool = true);
+        DirectoryEntry(block_t = 0, const char * = "unnamed", bool = true);
         std::string getFileName() const;
-        uint16_t getInode() const;
+        block_t getInode() const;
         void setFileName(const char *);
-        void setInodeNumber(uint16_t);
-        static uint16_t getSize();
+        void setInodeNumber(block_t);
+        static uint32_t getSize();
         bool getIsDir() const;
 
         /* serialization */
@@ -51,103 +101,223 @@ public:
         void read(char *);
 
     private:
-        uint16_t inode;
+        block_t inode;
         char fileName[FILE_LENGTH];
         char isDir;
     };
 
-    void addFile(Directory::DirectoryEntry &);
-    void removeFile(std::string filename);
-    std::vector<Directory::DirectoryEntry> getEntries() const;
-    bool hasFile(std::string) const;
+    DirectoryIndex index;
 
     static uint32_t blockSize;
+    static const uint32_t headerSize;
 
 private:
-    std::map<std::string, DirectoryEntry> files;
+    block_t parent;
+    block_t current;
+    uint32_t levels;
 };
 
+class DirectoryLeaf : public Serializable
+{
+public:
+    DirectoryLeaf();
+
+    /* serialization */
+    char *write(uint32_t *);
+    void read(char *);
+
+    uint32_t getCapacity() const;
+    int find(const std::string &) const; /* the position of the name, -1 if it is not in the leaf */
+
+    std::vector<Directory::DirectoryEntry> entries;
+};
+
+/** DirectoryIndex Implementation **/
+const uint32_t DirectoryIndex::headerSize = sizeof(uint32_t);
+
+DirectoryIndex::DirectoryIndex(uint32_t _bytes) : bytes(_bytes)
+{ /* intentionally left blank */
+}
+
+uint32_t DirectoryIndex::getCapacity() const
+{
+    return bytes < headerSize ? 0 : (bytes - headerSize) / sizeof(HashIndex);
+}
+
+size_t DirectoryIndex::find(uint32_t hash) const
+{
+    /* the last entry from the hash down, the first entry of a node is never after the hashes it is asked for */
+    auto it = std::upper_bound(entries.begin(), entries.end(), hash,
+                               [](uint32_t h, const HashIndex &e) { return h < e.hash; });
+    if (it == entries.begin())
+        throw std::logic_error("broken directory index!");
+    return it - entries.begin() - 1;
+}
+
+void DirectoryIndex::insert(const HashIndex &e)
+{
+    if (entries.size() >= getCapacity())
+        throw std::logic_error("directory index node is full!");
+    auto it = std::upper_bound(entries.begin(), entries.end(), e.hash,
+                               [](uint32_t h, const HashIndex &x) { return h < x.hash; });
+    entries.insert(it, e);
+}
+
+char *DirectoryIndex::write(uint32_t *s)
+{
+    if (entries.size() > getCapacity())
+        throw std::logic_error("too many entries for the directory index!");
+    *s = bytes;
+    char *buf = new char[bytes];
+    memset(buf, 0, bytes);
+    uint32_t count = entries.size();
+    memcpy(buf, &count, headerSize);
+    if (!entries.empty())
+        memcpy(buf + headerSize, entries.data(), entries.size() * sizeof(HashIndex));
+    return buf;
+}
+
+void DirectoryIndex::read(char *buf)
+{
+    uint32_t count;
+    memcpy(&count, buf, headerSize);
+    if (count > getCapacity())
+        throw std::logic_error("broken directory index!");
+    entries.resize(count);
+    if (!entries.empty())
+        memcpy(entries.data(), buf + headerSize, entries.size() * sizeof(HashIndex));
+}
+
 /** Directory Implementation **/
 uint32_t Directory::blockSize = 0;
+const uint32_t Directory::headerSize = 2 * sizeof(uint32_t) + 2 * sizeof(block_t);
 
-Directory::Directory(uint16_t parent, uint16_t current)
-{
-    files.insert(std::pair<std::string, Directory::DirectoryEntry>("..", DirectoryEntry(parent, "..")));
-    files.insert(std::pair<std::string, Directory::DirectoryEntry>(".", DirectoryEntry(current, ".")));
+Directory::Directory(block_t _parent, block_t _current)
+    : index(blockSize - headerSize), parent(_parent), current(_current), levels(0)
+{ /* intentionally left blank */
 }
 
-Directory::Directory()
+Directory::Directory() : Directory(0, 0)
 { /* */
 }
 
-uint16_t Directory::getFile(std::string name) const
+block_t Directory::getParent() const
 {
-    if (files.count(name) == 0)
-        throw std::logic_error("no such file or directory!");
-    return files.at(name).getInode();
+    return parent;
 }
 
-void Directory::addFile(Directory::DirectoryEntry &e)
+block_t Directory::getCurrent() const
 {
-    files.insert(std::pair<std::string, Directory::DirectoryEntry>(e.getFileName(), e));
+    return current;
 }
 
-void Directory::removeFile(std::string filename)
+uint32_t Directory::getLevels() const
 {
-    files.erase(filename);
+    return levels;
+}
+
+void Directory::setLevels(uint32_t _levels)
+{
+    levels = _levels;
+}
+
+uint32_t Directory::hash(const std::string &name)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+    for (unsigned char c : name)
+    {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
 }
 
 char *Directory::write(uint32_t *s)
 {
     *s = blockSize;
     char *data = new char[*s];
-    memset(data, 0, *s);
-    uint32_t size = files.size();
-    memcpy(data, &size, sizeof(uint32_t));
-    char *p = data + sizeof(uint32_t);
-    for (auto &e : files)
-    {
-        uint32_t _size;
-        char *entry = e.second.write(&_size);
-        memcpy(p, entry, e.second.getSize());
-        p += e.second.getSize();
-        delete[] entry;
-    }
+    const uint32_t magic = DIRECTORY_MAGIC;
+    memcpy(data, &magic, sizeof(uint32_t));
+    memcpy(data + sizeof(uint32_t), &parent, sizeof(block_t));
+    memcpy(data + sizeof(uint32_t) + sizeof(block_t), &current, sizeof(block_t));
+    memcpy(data + sizeof(uint32_t) + 2 * sizeof(block_t), &levels, sizeof(uint32_t));
+
+    uint32_t _size;
+    char *node = index.write(&_size);
+    memcpy(data + headerSize, node, _size);
+    delete[] node;
     return data;
 }
+
 void Directory::read(char *data)
 {
-    files.clear();
-    uint32_t size;
-    memcpy(&size, data, sizeof(uint32_t));
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(uint32_t));
+    if (magic != DIRECTORY_MAGIC)
+        throw std::logic_error("not a directory!");
+    memcpy(&parent, data + sizeof(uint32_t), sizeof(block_t));
+    memcpy(&current, data + sizeof(uint32_t) + sizeof(block_t), sizeof(block_t));
+    memcpy(&levels, data + sizeof(uint32_t) + 2 * sizeof(block_t), sizeof(uint32_t));
+    index.read(data + headerSize);
+}
 
-    char *p = data + sizeof(uint32_t);
-    for (uint32_t i = 0; i < size; i++, p += 16)
-    {
-        DirectoryEntry e;
-        e.read(p);
-        files.insert(std::pair<std::string, DirectoryEntry>(e.getFileName(), e));
-    }
+/** DirectoryLeaf Implementation **/
+
+DirectoryLeaf::DirectoryLeaf()
+{ /* intentionally left blank */
 }
 
-std::vector<Directory::DirectoryEntry> Directory::getEntries() const
+uint32_t DirectoryLeaf::getCapacity() const
 {
-    std::vector<Directory::DirectoryEntry> f;
+    return (Directory::blockSize - sizeof(uint32_t)) / Directory::DirectoryEntry::getSize();
+}
 
-    for (auto const &i : files)
-        if (i.first.compare(".") != 0 && i.first.compare("..") != 0)
-            f.push_back(i.second);
-    return f;
+int DirectoryLeaf::find(const std::string &name) const
+{
+    for (size_t i = 0; i < entries.size(); i++)
+        if (entries[i].getFileName() == name)
+            return i;
+    return -1;
+}
+
+char *DirectoryLeaf::write(uint32_t *s)
+{
+    if (entries.size() > getCapacity())
+        throw std::logic_error("too many entries for the directory leaf!");
+    *s = Directory::blockSize;
+    char *data = new char[*s];
+    memset(data, 0, *s);
+    uint32_t count = entries.size();
+    memcpy(data, &count, sizeof(uint32_t));
+    char *p = data + sizeof(uint32_t);
+    for (auto &e : entries)
+    {
+        uint32_t _size;
+        char *entry = e.write(&_size);
+        memcpy(p, entry, _size);
+        p += _size;
+        delete[] entry;
+    }
+    return data;
 }
 
-bool Directory::hasFile(std::string filename) const
+void DirectoryLeaf::read(char *data)
 {
-    return files.count(filename) != 0;
+    uint32_t count;
+    memcpy(&count, data, sizeof(uint32_t));
+    if (count > getCapacity())
+        throw std::logic_error("broken directory leaf!");
+
+    entries.resize(count);
+    char *p = data + sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; i++, p += Directory::DirectoryEntry::getSize())
+        entries[i].read(p);
 }
 
 /** DirectoryEntry Implementation **/
 
-Directory::DirectoryEntry::DirectoryEntry(uint16_t inode, const char *name, bool is_dir)
+Directory::DirectoryEntry::DirectoryEntry(block_t inode, const char *name, bool is_dir)
 {
     setFileName(name);
     setInodeNumber(inode);
@@ -156,7 +326,7 @@ Directory::DirectoryEntry::DirectoryEntry(uint16_t inode, const char *name, bool
 
 std::string Directory::DirectoryEntry::getFileName() const
 {
-    return fileName;
+    return std::string(fileName, strnlen(fileName, FILE_LENGTH));
 }
 
 bool Directory::DirectoryEntry::getIsDir() const
@@ -166,7 +336,7 @@ bool Directory::DirectoryEntry::getIsDir() const
     return is_dir;
 }
 
-uint16_t Directory::DirectoryEntry::getInode() const
+block_t Directory::DirectoryEntry::getInode() const
 {
     return inode;
 }
@@ -176,32 +346,32 @@ void Directory::DirectoryEntry::setFileName(const char *name)
     strncpy(fileName, name, FILE_LENGTH);
 }
 
-void Directory::DirectoryEntry::setInodeNumber(uint16_t inode)
+void Directory::DirectoryEntry::setInodeNumber(block_t inode)
 {
     this->inode = inode;
 }
 
 char *Directory::DirectoryEntry::write(uint32_t *s)
 {
-    size_t size = 16;
+    size_t size = getSize();
     *s = size;
-    char *buf = new char[size]; // 16 byte.
-    memcpy(buf, &inode, sizeof(uint16_t));
-    memcpy(buf + sizeof(uint16_t), fileName, FILE_LENGTH);
-    memcpy(buf + sizeof(uint16_t) + FILE_LENGTH, &isDir, 1);
+    char *buf = new char[size]; // 18 byte.
+    memcpy(buf, &inode, sizeof(block_t));
+    memcpy(buf + sizeof(block_t), fileName, FILE_LENGTH);
+    memcpy(buf + sizeof(block_t) + FILE_LENGTH, &isDir, 1);
     return buf;
 }
 
-uint16_t Directory::DirectoryEntry::getSize()
+uint32_t Directory::DirectoryEntry::getSize()
 {
-    return 16;
+    return sizeof(block_t) + FILE_LENGTH + 1;
 }
 
 void Directory::DirectoryEntry::read(char *buf)
 {
-    memcpy(&inode, buf, sizeof(uint16_t));
-    memcpy(fileName, buf + sizeof(uint16_t), FILE_LENGTH);
-    memcpy(&isDir, buf + sizeof(uint16_t) + FILE_LENGTH, 1);
+    memcpy(&inode, buf, sizeof(block_t));
+    memcpy(fileName, buf + sizeof(block_t), FILE_LENGTH);
+    memcpy(&isDir, buf + sizeof(block_t) + FILE_LENGTH, 1);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,109 @@
+/***
+ * represents a node of the extent tree of a file. @see INode
+ * an extent is a run of blocks in a row on disc: the first block of the file it maps, the first block on disc
+ * and the number of blocks.
+ *  -> [logical|physical|length]
+ *  -> [4byte  + 4byte  + 4byte] = 12 bytes.
+ *
+ * the root node is in the inode, the other nodes take a block each. a node of depth 0 is a leaf, its entries
+ * are the extents of the file. a node of depth d > 0 is an index, its entries are the nodes of depth d - 1:
+ * the first block of the file they map, their block on disc and the number of blocks of the file they map.
+ *  -> [entries|capacity|depth|unused][entry]...[entry]
+ *  -> [2byte  + 2byte   + 2byte+ 2byte] + entries * 12 bytes.
+ * */
+
+#ifndef EXTENT_H
+#define EXTENT_H
+
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include "serializable.h"
+
+struct Extent
+{
+    block_t logical;
+    block_t physical;
+    block_t length;
+};
+
+class ExtentNode : public Serializable
+{
+public:
+    /* a node of the given bytes on disc, the inode region or a block */
+    ExtentNode(uint32_t bytes = 0);
+
+    /* serialization */
+    char *write(uint32_t *);
+    void read(char *);
+
+    uint16_t getDepth() const;
+    void setDepth(uint16_t);
+    uint32_t getCapacity() const;
+
+    std::vector<Extent> entries;
+
+    static uint32_t capacity(uint32_t bytes);
+    static const uint32_t headerSize;
+
+private:
+    uint32_t bytes;
+    uint16_t depth;
+};
+
+/** ExtentNode Implementation **/
+const uint32_t ExtentNode::headerSize = 4 * sizeof(uint16_t);
+
+ExtentNode::ExtentNode(uint32_t _bytes) : bytes(_bytes), depth(0)
+{ /* intentionally left blank */
+}
+
+uint32_t ExtentNode::capacity(uint32_t bytes)
+{
+    return bytes < headerSize ? 0 : (bytes - headerSize) / sizeof(Extent);
+}
+
+uint32_t ExtentNode::getCapacity() const
+{
+    return capacity(bytes);
+}
+
+uint16_t ExtentNode::getDepth() const
+{
+    return depth;
+}
+
+void ExtentNode::setDepth(uint16_t _depth)
+{
+    depth = _depth;
+}
+
+char *ExtentNode::write(uint32_t *s)
+{
+    if (entries.size() > getCapacity())
+        throw std::logic_error("too many extents for the node!");
+    *s = bytes;
+    char *buf = new char[bytes];
+    memset(buf, 0, bytes);
+
+    uint16_t header[4] = {(uint16_t)entries.size(), (uint16_t)getCapacity(), depth, 0};
+    memcpy(buf, header, headerSize);
+    if (!entries.empty())
+        memcpy(buf + headerSize, entries.data(), entries.size() * sizeof(Extent));
+    return buf;
+}
+
+void ExtentNode::read(char *buf)
+{
+    uint16_t header[4];
+    memcpy(header, buf, headerSize);
+    if (header[0] > getCapacity())
+        throw std::logic_error("broken extent node!");
+    depth = header[2];
+    entries.resize(header[0]);
+    if (!entries.empty())
+        memcpy(entries.data(), buf + headerSize, entries.size() * sizeof(Extent));
+}
+
+#endif
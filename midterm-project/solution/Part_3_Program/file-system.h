@@ -1,11 +1,13 @@
 /**
  * represents the file system management class.
  * disc:
- *  -> [superblock][blocks free bitmap][inodes free bitmap][inodes][rootdir][files and directories] = 1MB
+ *  -> [superblock][blocks free bitmap][inodes free bitmap][inodes][rootdir][files and directories] = disc size
+ *  -> the disc size is given on create, 1MB by default. block and inode numbers are 32-bit, the offsets 64-bit.
  * 
  * superblock:
- *  -> [block size| number of inodes| number of blocks| inode offset| block offset]
- *  -> [4byte     + 4byte           + 4byte           + 4byte       + 4byte] = 20 bytes.
+ *  -> [magic| block size| number of inodes| number of blocks| inode offset| block offset| disc size| features]
+ *  -> [4byte+ 4byte     + 4byte           + 4byte           + 8byte       + 8byte       + 8byte    + 4byte] = 44 bytes.
+ *  -> features: FEATURE_EXTENTS if the files are mapped by extents instead of block references.
  * 
  * blocks bitmap:
  *  -> [01010....] = number of blocks / 8 bytes.
@@ -15,10 +17,13 @@
  *  ->  inode number/8 + inode number * block_size bytes.
  * 
  * rootdir: @see directory.h
- *  -> [directory entry] = 16 bytes. (14 | 2).
+ *  -> [directory entry] = 18 bytes. (4 | 13 | 1).
  * 
  * files and directories (blocks):
  *  -> number of blocks * block size bytes. 
+ *
+ * the sections are read and written in place, never the whole image: open reads the superblock, the bitmaps
+ * and the root entry. create writes them, close writes only the changed words of the bitmaps.
 **/
 
 // TODO. only check bad file names and directories
@@ -30,14 +35,22 @@
 #include "inode.h"
 #include "directory.h"
 #include "block-manager.h"
+#include "dentry-cache.h"
+#include "inode-cache.h"
 #include <sstream>
 #include <algorithm>
+#include <limits>
 #include <stdint.h>
 
 
-#define SUPERBLOCK_SIZE 20
+#define SUPERBLOCK_SIZE 44
+#define SUPERBLOCK_MAGIC 0x32335346 /* "FS32", the discs of 16-bit block numbers don't have it */
 #define PATH_DELIMETER "/"
 
+#define FEATURE_EXTENTS 0x1 /* @see extent.h */
+
+#define STREAM_BLOCKS 256 /* blocks of a chunk, the host files are read and written a chunk at a time */
+
 #define MB 1048576
 
 class FileSystem
@@ -46,7 +59,11 @@ public:
     FileSystem(FileSystem const &) = delete;
     FileSystem &operator=(FileSystem const &) = delete;
 
-    static void settings(unsigned int size, unsigned int inodes);
+    /**
+     * the block size in bytes, the number of inodes and the size of the whole disc in bytes.
+     * the number of blocks is what is left for them. the files are mapped by extents if extents is true.
+     */
+    static void settings(unsigned int size, unsigned int inodes, uint64_t discSize = MB, bool extents = false);
 
     /**
      * creates a file system to given .data file.
@@ -63,6 +80,11 @@ public:
      */
     static void close();
 
+    /**
+     * writes everything cached to the disc: the dirty inodes in order, the dirty blocks and the bitmaps.
+     */
+    void sync();
+
     /* commands (directly outputed to stdout) */
 
     void list(std::string);
@@ -76,17 +98,31 @@ public:
     void lnsym(std::string, std::string);
     void fsck();
 
+    /**
+     * the data of a file by its inode, from a byte offset on. only the blocks of the range are mapped.
+     * readAt stops at the end of the file and returns the bytes read. writeAt and append allocate the new
+     * blocks only, the bytes never written read as zero. truncate frees or allocates the blocks after size.
+     */
+    uint32_t readAt(block_t inode, uint32_t offset, char *data, uint32_t length);
+    void writeAt(block_t inode, uint32_t offset, const char *data, uint32_t length);
+    void append(block_t inode, const char *data, uint32_t length);
+    void truncate(block_t inode, uint32_t size);
+
 private:
     BlockManager *inodeTable;
     BlockManager *dataBlockTable;
+    InodeCache *inodes; /* parsed, in front of the inode table */
     Directory::DirectoryEntry root;
+    DentryCache dentries;
     static FileSystem *instance;
 
     static uint32_t blockSize;  /* block size in */
     static uint32_t totalINode; /* total inode */
     static uint32_t totalBlock;
-    static uint32_t inodeOffset;
-    static uint32_t blockOffset;
+    static uint64_t inodeOffset;
+    static uint64_t blockOffset;
+    static uint64_t discSize;
+    static uint32_t features;
     static uint32_t blockBitmapLong;
     static uint32_t inodeBitmapLong;
     static std::string disc;
@@ -101,64 +137,114 @@ private:
 
     void writeFreeBlocks(char *, BlockManager *) const;
     void writeSuperBlock(char *) const;
-
-    char *readData(uint16_t);
-    void writeData(uint16_t number, char *data, int n);
-    void allocData(uint16_t number, int n);
-    void deallocData(uint16_t number, int n);
-    void readOneBlock(uint16_t number, char *);
-    void writeOneBlock(uint16_t number, char *data);
-
-    void singleIndirect(uint16_t number, char *data, int n, bool);
-    void doubleIndirect(uint16_t number, char *data, int n, bool);
-    void tripleIndirect(uint16_t number, char *data, int n, bool);
-
-    Directory cd(std::string path);
-    void readInode(INode &inode, uint16_t number);
-    void writeInode(INode &inode, uint16_t number);
-    void removeDir(Directory &);
-    void removeFile(uint16_t);
+    void writeBitmap(std::fstream &, uint64_t offset, BlockManager *, bool whole);
+
+    void writeOneBlock(block_t number, char *data);
+    void transferAt(const INode &, uint32_t offset, char *data, uint32_t length, bool write);
+    void growFile(INode &, uint32_t size, uint32_t from, uint32_t to); /* from..to is written next */
+    void zeroBlocks(const std::vector<block_t> &);
+
+    /* the blocks of a file by their logical numbers, through its block map or its extents */
+    std::vector<block_t> fileBlocks(const INode &, std::vector<block_t> *nodes = nullptr);
+    block_t mapBlock(const INode &, block_t logical);
+    std::vector<block_t> mapBlocks(const INode &, block_t first, block_t count);
+    std::vector<block_t> appendBlocks(INode &, block_t logical, block_t count); /* logical is the block count */
+    void releaseBlocks(INode &, block_t from = 0); /* the blocks from on */
+
+    /* block map of the files, @see inode.h */
+    uint32_t referencePath(block_t logical, std::vector<uint32_t> &path) const;
+    void linkBlock(INode &, block_t logical, block_t block);
+    void collectReferences(block_t index, uint32_t level, block_t &left, std::vector<block_t> &,
+                           std::vector<block_t> *nodes);
+    block_t allocIndirect();
+
+    /* extents of the files, @see extent.h */
+    std::vector<Extent> allocExtents(uint32_t blocks, block_t goal); /* goal first, the block after the file */
+    std::vector<Extent> fileExtents(const INode &, std::vector<block_t> *nodes = nullptr);
+    void readExtents(const ExtentNode &, std::vector<Extent> &, std::vector<block_t> *nodes);
+    std::vector<block_t> extentBlocks(const std::vector<Extent> &) const;
+    void readExtentNode(block_t block, uint16_t depth, ExtentNode &);
+    void writeExtentNode(block_t block, ExtentNode &);
+    block_t allocExtentNode(uint16_t depth, const Extent &entry); /* a new node of the one entry */
+    void mapExtents(const ExtentNode &, block_t first, block_t count, std::vector<block_t> &);
+    void appendExtent(INode &, const Extent &); /* along the last path, a node more only on overflow */
+    void cutExtents(ExtentNode &, block_t from); /* along the path of from, the subtrees after it freed */
+
+    block_t cd(std::string path);
+    block_t resolve(block_t directory, const std::string &name); /* through the dentry cache */
+    void readInode(INode &inode, block_t number);
+    void writeInode(INode &inode, block_t number);
+    void removeDir(block_t directory);
+
+    /* hashed directories, @see directory.h */
+    void makeDirectory(block_t number, block_t parent);
+    bool findEntry(block_t directory, const std::string &name, Directory::DirectoryEntry &);
+    void addEntry(block_t directory, Directory::DirectoryEntry &);
+    void removeEntry(block_t directory, const std::string &name);
+    std::vector<Directory::DirectoryEntry> listEntries(block_t directory);
+    block_t findLeaf(const INode &, const Directory &, uint32_t hash, DirectoryIndex &node, block_t &nodeBlock);
+    void splitLeaf(INode &, block_t directory, Directory &, DirectoryIndex &node, block_t nodeBlock,
+                   block_t leafBlock, DirectoryLeaf &);
+    void insertIndex(INode &, block_t directory, Directory &, DirectoryIndex &node, block_t nodeBlock,
+                     const HashIndex &);
+    block_t growDirectory(INode &, block_t directory);
+    void readDirectoryBlock(const INode &, block_t logical, Serializable &);
+    void writeDirectoryBlock(const INode &, block_t logical, Serializable &);
+    void removeFile(block_t);
     void printTable(BlockManager *table);
+    void printCache(std::string, BlockManager *table);
 };
 
 FileSystem *FileSystem::instance = nullptr;
 uint32_t FileSystem::blockSize = 0;
 uint32_t FileSystem::totalINode = 0;
 uint32_t FileSystem::totalBlock = 0;
-uint32_t FileSystem::inodeOffset = 0;
-uint32_t FileSystem::blockOffset = 0;
+uint64_t FileSystem::inodeOffset = 0;
+uint64_t FileSystem::blockOffset = 0;
+uint64_t FileSystem::discSize = 0;
+uint32_t FileSystem::features = 0;
 uint32_t FileSystem::blockBitmapLong = 0;
 uint32_t FileSystem::inodeBitmapLong = 0;
 
 std::string FileSystem::disc;
 
-FileSystem::FileSystem() : inodeTable(nullptr), dataBlockTable(nullptr), root()
+FileSystem::FileSystem() : inodeTable(nullptr), dataBlockTable(nullptr), inodes(nullptr), root(), dentries()
 { /* */
 }
 
-void FileSystem::settings(unsigned int size, unsigned int inodes)
+void FileSystem::settings(unsigned int size, unsigned int inodes, uint64_t _discSize, bool extents)
 {
-    if (size == 0 || inodes == 0)
+    if (size == 0 || inodes == 0 || _discSize == 0)
         throw std::invalid_argument("size can't be zero!");
     blockSize = size;
     // DataBlock::setSize(size);
     INode::setSize(size);
     Directory::blockSize = size;
     totalINode = inodes;
+    discSize = _discSize;
+    features = extents ? FEATURE_EXTENTS : 0;
+    INode::setMapping(extents ? INode::EXTENT_MAP : INode::BLOCK_MAP);
 
-    if (inodes * size >= MB)
-        throw std::logic_error("bad size! can't be greater than 1MB");
-    if (8 * (MB - (SUPERBLOCK_SIZE + (totalINode / 8) + totalINode * blockSize + 16)) / (blockSize + 1) <= 0)
-        throw std::logic_error("bad size! no place left for blocks!");
-
-    /* calculating the offsets and counts */
+    /* everything but the blocks and their bitmap, in 64-bit since the disc can be many GB */
     inodeBitmapLong = totalINode / 8 + ((totalINode % 8) ? 1 : 0);
-    totalBlock = ((8 * (MB - (SUPERBLOCK_SIZE + inodeBitmapLong + (totalINode * blockSize) + 16))) - 8) / (8 * blockSize + 1);
+    const uint64_t root_entry = Directory::DirectoryEntry::getSize();
+    const uint64_t metadata = SUPERBLOCK_SIZE + inodeBitmapLong + (uint64_t)totalINode * blockSize + root_entry;
+
+    if (metadata + 1 >= discSize)
+        throw std::logic_error("bad size! inodes can't be greater than the disc!");
+
+    /* calculating the offsets and counts, a block takes its size and a bit of the bitmap */
+    uint64_t blocks = ((8 * (discSize - metadata)) - 8) / (8 * (uint64_t)blockSize + 1);
+    if (blocks == 0)
+        throw std::logic_error("bad size! no place left for blocks!");
+    if (blocks > std::numeric_limits<block_t>::max())
+        throw std::logic_error("bad size! too many blocks, the block size must be greater!");
+    totalBlock = blocks;
     blockBitmapLong = totalBlock / 8 + ((totalBlock % 8) ? 1 : 0);
     inodeOffset = SUPERBLOCK_SIZE + blockBitmapLong + inodeBitmapLong;
-    blockOffset = inodeOffset + (totalINode * blockSize) + 16; // TODO. check this.
+    blockOffset = inodeOffset + (uint64_t)totalINode * blockSize + root_entry;
 
-    if (blockOffset + blockSize * totalBlock > MB)
+    if (blockOffset + (uint64_t)blockSize * totalBlock > discSize)
         throw std::logic_error("bad size!");
 }
 
@@ -170,9 +256,16 @@ FileSystem *FileSystem::create(std::string discName)
         throw std::logic_error("uninitialized file system state!");
     disc = discName;
 
+    /* an empty image of the whole size, the sections are written into it in place */
+    std::ofstream image(discName, std::ios::out | std::ios::binary | std::ios::trunc);
+    image.seekp(discSize - 1); /* sparse, the untouched blocks take no place on the host */
+    image.put('\0');
+    image.close();
+
     instance = new FileSystem();
     instance->inodeTable = new BlockManager(totalINode, blockSize, inodeOffset, discName);
     instance->dataBlockTable = new BlockManager(totalBlock, blockSize, blockOffset, discName);
+    instance->inodes = new InodeCache(instance->inodeTable);
 
     // allocate inode for root.
     instance->root.setFileName(PATH_DELIMETER);
@@ -184,14 +277,8 @@ FileSystem *FileSystem::create(std::string discName)
     INode inode_root;
     inode_root.metadata.setFileName(PATH_DELIMETER);
     inode_root.metadata.setSize(0);
-    uint32_t n;
-    char *data = inode_root.write(&n);
-    instance->inodeTable->setBlock(instance->root.getInode(), data);
-    delete[] data;
-    Directory root_dir(instance->root.getInode(), instance->root.getInode());
-    data = root_dir.write(&n);
-    instance->writeData(instance->root.getInode(), data, n);
-    delete[] data;
+    instance->writeInode(inode_root, instance->root.getInode());
+    instance->makeDirectory(instance->root.getInode(), instance->root.getInode());
 
     return instance;
 }
@@ -211,548 +298,1031 @@ FileSystem *FileSystem::open(std::string discName)
 
 void FileSystem::close()
 {
-    instance->writeDisc(false);
+    instance->sync();
+    delete instance->inodes;
     delete instance->inodeTable;
     delete instance->dataBlockTable;
     delete instance;
     instance = nullptr;
 }
 
+void FileSystem::sync()
+{
+    /* the inodes into their blocks, the blocks, then the bitmaps that describe them */
+    inodes->flush();
+    dataBlockTable->flush();
+    inodeTable->flush();
+    writeDisc(false);
+}
+
 void FileSystem::writeSuperBlock(char *raw) const
 {
     /* prepare the superblock */
     /* assign fields */
-    size_t each_size = sizeof(uint32_t);
-    memcpy(raw, &blockSize, each_size);
-    memcpy(raw + each_size, &totalINode, each_size);
-    memcpy(raw + each_size * 2, &totalBlock, each_size);
-    memcpy(raw + each_size * 3, &inodeOffset, each_size);
-    memcpy(raw + each_size * 4, &blockOffset, each_size);
+    const uint32_t magic = SUPERBLOCK_MAGIC;
+    size_t each_size = sizeof(uint32_t), offset_size = sizeof(uint64_t);
+    memcpy(raw, &magic, each_size);
+    memcpy(raw + each_size, &blockSize, each_size);
+    memcpy(raw + each_size * 2, &totalINode, each_size);
+    memcpy(raw + each_size * 3, &totalBlock, each_size);
+    memcpy(raw + each_size * 4, &inodeOffset, offset_size);
+    memcpy(raw + each_size * 4 + offset_size, &blockOffset, offset_size);
+    memcpy(raw + each_size * 4 + offset_size * 2, &discSize, offset_size);
+    memcpy(raw + each_size * 4 + offset_size * 3, &features, each_size);
 }
 
 void FileSystem::readSuperBlock(char *raw)
 {
     /* assign fields */
-    size_t each_size = sizeof(uint32_t);
-    memcpy(&blockSize, raw, each_size);
-    memcpy(&totalINode, raw + each_size, each_size);
-    memcpy(&totalBlock, raw + each_size * 2, each_size);
-    memcpy(&inodeOffset, raw + each_size * 3, each_size);
-    memcpy(&blockOffset, raw + each_size * 4, each_size);
-}
-
-bool getBit(unsigned char byte, unsigned int pos)
-{
-    return (byte >> pos) & 0x1;
+    uint32_t magic;
+    size_t each_size = sizeof(uint32_t), offset_size = sizeof(uint64_t);
+    memcpy(&magic, raw, each_size);
+    if (magic != SUPERBLOCK_MAGIC)
+        throw std::logic_error("not a disc of this file system, create it once more!");
+    memcpy(&blockSize, raw + each_size, each_size);
+    memcpy(&totalINode, raw + each_size * 2, each_size);
+    memcpy(&totalBlock, raw + each_size * 3, each_size);
+    memcpy(&inodeOffset, raw + each_size * 4, offset_size);
+    memcpy(&blockOffset, raw + each_size * 4 + offset_size, offset_size);
+    memcpy(&discSize, raw + each_size * 4 + offset_size * 2, offset_size);
+    memcpy(&features, raw + each_size * 4 + offset_size * 3, each_size);
+    INode::setMapping((features & FEATURE_EXTENTS) ? INode::EXTENT_MAP : INode::BLOCK_MAP);
 }
 
 void FileSystem::readFreeBlocks(char *raw, BlockManager *table)
 {
-    size_t size = table->getTotal() / 8 + ((table->getTotal() % 8) ? 1 : 0);
-    bool *bitmap = new bool[size * 8];
-    for (size_t byte = 0; byte < size; byte++)
-        for (size_t bit = 0; bit < 8; bit++)
-            bitmap[byte * 8 + bit] = getBit(raw[byte], bit);
-
-    table->read(bitmap);
-    delete[] bitmap;
-}
-
-void setBit(char *byte, unsigned int pos)
-{
-    *byte |= 1UL << pos;
+    table->read(raw); /* the same bytes in memory */
 }
 
 void FileSystem::writeFreeBlocks(char *raw, BlockManager *table) const
 {
-    bool *bitmap = table->write();
-    size_t size = table->getTotal() / 8 + ((table->getTotal() % 8) ? 1 : 0);
-    memset(raw, 0, size);
-    for (size_t byte = 0; byte < size; byte++)
-    {
-        for (size_t bit = 0; bit < 8; bit++)
-            if (bitmap[byte * 8 + bit])
-                setBit(&raw[byte], bit);
-    }
-    delete[] bitmap;
+    table->write(raw);
 }
 
 void FileSystem::readDisc()
 {
-    /* read the whole disc raw */
-    char raw[MB];
+    /* only the metadata at the head of the disc, the blocks are read on demand */
     std::ifstream in;
     in.open(disc, std::ios::in | std::ios::binary);
-    in.read(raw, MB);
-    in.close();
+    if (!in)
+        throw std::logic_error("can't open the disc " + disc);
 
-    /* read the sections */
-    instance->readSuperBlock(raw); // superblock
+    char superblock[SUPERBLOCK_SIZE] = {0};
+    in.read(superblock, SUPERBLOCK_SIZE);
+    instance->readSuperBlock(superblock); // superblock
     blockBitmapLong = totalBlock / 8 + ((totalBlock % 8) ? 1 : 0);
+    inodeBitmapLong = totalINode / 8 + ((totalINode % 8) ? 1 : 0);
 
     instance->inodeTable = new BlockManager(totalINode, blockSize, inodeOffset, disc);
     instance->dataBlockTable = new BlockManager(totalBlock, blockSize, blockOffset, disc);
+    instance->inodes = new InodeCache(instance->inodeTable);
 
-    instance->readFreeBlocks(raw + SUPERBLOCK_SIZE, instance->dataBlockTable);               // free blocks
-    instance->readFreeBlocks(raw + SUPERBLOCK_SIZE + blockBitmapLong, instance->inodeTable); // free inodes
-    instance->root.read(raw + inodeOffset + (blockSize * totalINode));                       // root dir.
+    std::vector<char> bitmaps(blockBitmapLong + inodeBitmapLong);
+    in.read(bitmaps.data(), bitmaps.size());
+    instance->readFreeBlocks(bitmaps.data(), instance->dataBlockTable);                // free blocks
+    instance->readFreeBlocks(bitmaps.data() + blockBitmapLong, instance->inodeTable); // free inodes
+
+    std::vector<char> root_entry(Directory::DirectoryEntry::getSize());
+    in.seekg(inodeOffset + (uint64_t)blockSize * totalINode);
+    in.read(root_entry.data(), root_entry.size());
+    instance->root.read(root_entry.data()); // root dir.
+    in.close();
 }
 
 void FileSystem::writeDisc(bool init)
 {
-    char raw[MB];
+    std::fstream out;
+    out.open(disc, std::ios::in | std::ios::out | std::ios::binary);
+    if (!out)
+        throw std::logic_error("can't open the disc " + disc);
 
-    if (!init)
+    if (init)
     {
-        std::ifstream in;
-        in.open(disc, std::ios::out | std::ios::binary);
-        in.read(raw, MB);
-        in.close();
+        /* the superblock and the root entry don't change after create */
+        char superblock[SUPERBLOCK_SIZE];
+        writeSuperBlock(superblock);
+        out.seekp(0);
+        out.write(superblock, SUPERBLOCK_SIZE);
+
+        uint32_t _size;
+        char *root_buf = root.write(&_size);
+        out.seekp(inodeOffset + (uint64_t)blockSize * totalINode);
+        out.write(root_buf, root.getSize()); // root dir.
+        delete[] root_buf;
     }
 
-    /* write the sections */
-    writeSuperBlock(raw);                                                 // superblock
-    writeFreeBlocks(raw + SUPERBLOCK_SIZE, dataBlockTable);               // free blocks
-    writeFreeBlocks(raw + SUPERBLOCK_SIZE + blockBitmapLong, inodeTable); // free inodes
-    uint32_t _size;
-    char *root_buf = root.write(&_size);
-    memcpy(raw + inodeOffset + (blockSize * totalINode), root_buf, root.getSize()); // root dir.
-    delete[] root_buf;
-
-    /* write the whole raw to disc */
-    std::ofstream out;
-    out.open(disc, std::ios::out | std::ios::binary);
-    out.write(raw, MB);
+    /* the whole bitmaps on create, only their changed words afterwards */
+    writeBitmap(out, SUPERBLOCK_SIZE, dataBlockTable, init);                // free blocks
+    writeBitmap(out, SUPERBLOCK_SIZE + blockBitmapLong, inodeTable, init); // free inodes
     out.close();
 }
 
-void FileSystem::readOneBlock(uint16_t number, char *data)
+void FileSystem::writeBitmap(std::fstream &out, uint64_t offset, BlockManager *table, bool whole)
 {
-    char *block = (char *)dataBlockTable->getBlock(number);
-    memcpy(data, block, blockSize);
-    delete[] block;
+    size_t size = table->getTotal() / 8 + ((table->getTotal() % 8) ? 1 : 0);
+    std::vector<char> raw(size);
+    writeFreeBlocks(raw.data(), table);
+
+    if (whole)
+    {
+        out.seekp(offset);
+        out.write(raw.data(), size);
+    }
+    else
+    {
+        size_t word_bytes = BITMAP_WORD_BITS / 8;
+        for (uint32_t word : table->changedWords())
+        {
+            size_t begin = word * word_bytes;
+            out.seekp(offset + begin);
+            out.write(raw.data() + begin, std::min(word_bytes, size - begin));
+        }
+    }
+    table->clearChanged();
 }
 
-void FileSystem::writeOneBlock(uint16_t number, char *data)
+void FileSystem::writeOneBlock(block_t number, char *data)
 {
     dataBlockTable->setBlock(number, data);
 }
 
-void FileSystem::singleIndirect(uint16_t number, char *data, int n, bool read = true)
+uint32_t FileSystem::readAt(block_t number, uint32_t offset, char *data, uint32_t length)
 {
-    uint16_t *blocks = new uint16_t[blockSize];
-    readOneBlock(number, (char *)blocks);
-    for (int i = 0; i < n; i++, data += blockSize)
+    INode inode;
+    readInode(inode, number);
+    uint32_t file_size = inode.metadata.getSize();
+    if (offset >= file_size)
+        return 0;
+    length = std::min(length, file_size - offset);
+    transferAt(inode, offset, data, length, false);
+    return length;
+}
+
+void FileSystem::writeAt(block_t number, uint32_t offset, const char *data, uint32_t length)
+{
+    if ((uint64_t)offset + length > std::numeric_limits<uint32_t>::max())
+        throw std::logic_error("file is too big!");
+    INode inode;
+    readInode(inode, number);
+    if (offset + length > inode.metadata.getSize())
+        growFile(inode, offset + length, offset, offset + length);
+    transferAt(inode, offset, (char *)data, length, true);
+    inode.metadata.updateModification();
+    writeInode(inode, number);
+}
+
+void FileSystem::append(block_t number, const char *data, uint32_t length)
+{
+    INode inode;
+    readInode(inode, number);
+    writeAt(number, inode.metadata.getSize(), data, length);
+}
+
+void FileSystem::truncate(block_t number, uint32_t size)
+{
+    INode inode;
+    readInode(inode, number);
+    uint32_t file_size = inode.metadata.getSize();
+    if (size > file_size)
+        growFile(inode, size, 0, 0);
+    else if (size < file_size)
     {
-        if (read)
-            readOneBlock(blocks[i], data);
-        else
-            writeOneBlock(blocks[i], data);
+        releaseBlocks(inode, (size / blockSize) + ((size % blockSize == 0) ? 0 : 1));
+        inode.metadata.setSize(size);
+
+        /* the rest of the last block reads as zero if the file grows once more */
+        if (size % blockSize)
+        {
+            BlockHandle block = dataBlockTable->getBlock(mapBlock(inode, size / blockSize));
+            memset(block.data() + size % blockSize, 0, blockSize - size % blockSize);
+            block.markDirty();
+        }
     }
-    delete[] blocks;
+    inode.metadata.updateModification();
+    writeInode(inode, number);
 }
 
-void FileSystem::doubleIndirect(uint16_t number, char *data, int n, bool read = true)
+void FileSystem::transferAt(const INode &inode, uint32_t offset, char *data, uint32_t length, bool write)
 {
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
-
-    int advance = ref_per_block;
-    uint16_t *blocks = new uint16_t[blockSize];
-    readOneBlock(number, (char *)blocks);
-    for (int i = 0; i < n; i += advance, data += advance * blockSize)
+    if (length == 0)
+        return;
+    block_t first = offset / blockSize;
+    block_t last = ((uint64_t)offset + length - 1) / blockSize;
+    std::vector<block_t> blocks = mapBlocks(inode, first, last - first + 1);
+
+    /* a part of a block goes through the cache, the whole blocks in runs around it */
+    size_t i = 0;
+    uint32_t at = offset % blockSize;
+    while (length > 0)
     {
-        if (read)
-            singleIndirect(blocks[i], data, advance);
+        if (at == 0 && length >= blockSize)
+        {
+            size_t whole = length / blockSize;
+            std::vector<block_t> run(blocks.begin() + i, blocks.begin() + i + whole);
+            if (write)
+                dataBlockTable->writeBlocks(run, data);
+            else
+                dataBlockTable->readBlocks(run, data);
+            i += whole;
+            data += whole * blockSize;
+            length -= whole * blockSize;
+            continue;
+        }
+
+        uint32_t n = std::min(length, blockSize - at);
+        BlockHandle block = dataBlockTable->getBlock(blocks[i++]);
+        if (write)
+        {
+            memcpy(block.data() + at, data, n);
+            block.markDirty();
+        }
         else
-            singleIndirect(blocks[i], data, advance, false);
+            memcpy(data, block.data() + at, n);
+        data += n;
+        length -= n;
+        at = 0;
     }
-    delete[] blocks;
 }
 
-void FileSystem::tripleIndirect(uint16_t number, char *data, int n, bool read = true)
+void FileSystem::growFile(INode &inode, uint32_t size, uint32_t from, uint32_t to)
 {
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
+    uint32_t file_size = inode.metadata.getSize();
+    block_t have = (file_size / blockSize) + ((file_size % blockSize == 0) ? 0 : 1);
+    block_t need = (size / blockSize) + ((size % blockSize == 0) ? 0 : 1);
+    std::vector<block_t> fresh = appendBlocks(inode, have, need - have);
+    inode.metadata.setSize(size);
+
+    /* the new blocks read as zero, but the ones the bytes from..to cover whole, they are written next */
+    std::vector<block_t> zero;
+    for (block_t i = 0; i < fresh.size(); i++)
+    {
+        uint64_t begin = (uint64_t)(have + i) * blockSize;
+        if (begin < from || begin + blockSize > to)
+            zero.push_back(fresh[i]);
+    }
+    zeroBlocks(zero);
+}
 
-    int advance = ref_per_block * ref_per_block;
-    uint16_t *blocks = new uint16_t[blockSize];
-    readOneBlock(number, (char *)blocks);
-    for (int i = 0; i < n; i += advance, data += advance * blockSize)
+void FileSystem::zeroBlocks(const std::vector<block_t> &blocks)
+{
+    /* a chunk of zero at a time, in runs */
+    std::vector<char> zero((size_t)std::min<size_t>(blocks.size(), STREAM_BLOCKS) * blockSize, 0);
+    for (size_t i = 0; i < blocks.size(); i += STREAM_BLOCKS)
     {
-        if (read)
-            doubleIndirect(blocks[i], data, advance);
-        else
-            doubleIndirect(blocks[i], data, advance, false);
+        std::vector<block_t> chunk(blocks.begin() + i, blocks.begin() + std::min<size_t>(i + STREAM_BLOCKS, blocks.size()));
+        dataBlockTable->writeBlocks(chunk, zero.data());
     }
-    delete[] blocks;
 }
 
-void FileSystem::deallocData(uint16_t number, int n)
+std::vector<block_t> FileSystem::mapBlocks(const INode &inode, block_t first, block_t count)
 {
-    if (n == 0)
-        return;
-    INode inode;
-    readInode(inode, number);
-    std::vector<uint16_t> blcks[4];
-    inode.getBlocks(blcks);
+    std::vector<block_t> blocks;
+    if (!inode.hasExtents())
+    {
+        for (block_t i = 0; i < count; i++)
+            blocks.push_back(mapBlock(inode, first + i));
+        return blocks;
+    }
 
-    uint32_t total_blocks = (n / blockSize) + ((n % blockSize == 0) ? 0 : 1);
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
+    /* the parts of the extents in the range, down the nodes that map it only */
+    mapExtents(inode.extentRoot, first, count, blocks);
+    if (blocks.size() != count)
+        throw std::logic_error("block out of the file!");
+    return blocks;
+}
 
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
+std::vector<block_t> FileSystem::fileBlocks(const INode &inode, std::vector<block_t> *nodes)
+{
+    if (inode.hasExtents())
+        return extentBlocks(fileExtents(inode, nodes));
 
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > INode::totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
+    uint32_t file_size = inode.metadata.getSize();
+    block_t left = (file_size / blockSize) + ((file_size % blockSize == 0) ? 0 : 1);
+    std::vector<block_t> blocks;
+    for (uint32_t i = 0; i < INode::totalDirectBlocks && left > 0; i++, left--)
+        blocks.push_back(inode.getReference(i));
+    for (uint32_t level = 0; level < 3 && left > 0; level++)
+        collectReferences(inode.getReference(INode::totalDirectBlocks + level), level, left, blocks, nodes);
+    return blocks;
+}
 
-    /* dealloc the direct blocks */
-    uint32_t blk_total = std::min(total_blocks, INode::totalDirectBlocks);
-    for (unsigned int i = 0; i < blk_total; i++)
-        dataBlockTable->deallocateBlock(blcks[0][i]);
+void FileSystem::collectReferences(block_t index, uint32_t level, block_t &left, std::vector<block_t> &blocks,
+                                   std::vector<block_t> *nodes)
+{
+    if (nodes != nullptr)
+        nodes->push_back(index);
 
-    /* dealloc the indirect blocks */
-    if (single_indirect_used)
+    /* a copy, the blocks under it are read before it is done */
+    std::vector<block_t> references(blockSize / sizeof(block_t));
     {
-        /* single indirect */
-        blk_total = std::min(total_blocks - blk_total, single_indirect_blocks);
-        uint16_t single_indirect = blcks[1][0];
-        dataBlockTable->deallocateBlock(single_indirect);
-        char *data = new char[blockSize];
-
-        readOneBlock(single_indirect, data);
-
-        for (unsigned i = 0; i < blk_total / blockSize; i++)
+        BlockHandle block = dataBlockTable->getBlock(index);
+        memcpy(references.data(), block.data(), blockSize);
+    }
+    for (size_t i = 0; i < references.size() && left > 0; i++)
+    {
+        if (level == 0)
         {
-            uint16_t address;
-            memcpy(&address, &data[i], sizeof(uint16_t));
-            dataBlockTable->deallocateBlock(address);
+            blocks.push_back(references[i]);
+            left--;
         }
+        else
+            collectReferences(references[i], level - 1, left, blocks, nodes);
+    }
+}
 
-        if (double_indirect_used)
+uint32_t FileSystem::referencePath(block_t logical, std::vector<uint32_t> &path) const
+{
+    /* the reference of the inode, then the entry of each indirect block on the way down */
+    if (logical < INode::totalDirectBlocks)
+        return logical;
+
+    const uint64_t ref_per_block = blockSize / sizeof(block_t);
+    uint64_t rest = logical - INode::totalDirectBlocks, span = 1;
+    for (uint32_t level = 0; level < 3; level++)
+    {
+        span *= ref_per_block;
+        if (rest < span)
         {
-            /* double indirect */
-            blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-            uint16_t double_indirect = blcks[2][0];
-            dataBlockTable->deallocateBlock(double_indirect);
-            char *data2 = new char[blockSize];
-            memset(data2, 0, blockSize);
-
-            readOneBlock(double_indirect, data);
-            for (size_t i = 0; i < blk_total / (blockSize * blockSize); i++)
+            for (uint64_t under = span / ref_per_block; under > 0; under /= ref_per_block)
             {
-                uint16_t address;
-                memcpy(&address, &data[i], sizeof(uint16_t));
-                dataBlockTable->deallocateBlock(address);
-
-                readOneBlock(address, data2);
-                for (unsigned j = 0; j < blk_total / blockSize; j++)
-                {
-                    uint16_t address2;
-                    memcpy(&address2, &data2[j], sizeof(uint16_t));
-                    dataBlockTable->deallocateBlock(address2);
-                }
+                path.push_back(rest / under);
+                rest %= under;
             }
-            if (triple_indirect_used)
-            {
-                /* triple indirect */
-                blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-                uint16_t triple_indirect = blcks[3][0];
-                dataBlockTable->deallocateBlock(triple_indirect);
-                char *data3 = new char[blockSize];
-
-                readOneBlock(triple_indirect, data3);
-                for (size_t k = 0; k < blk_total / (blockSize * blockSize * blockSize); k++)
-                {
-
-                    uint16_t address3;
-                    memcpy(&address3, &data3[k], sizeof(uint16_t));
-                    dataBlockTable->deallocateBlock(address3);
-
-                    readOneBlock(address3, data2);
-                    for (size_t i = 0; i < blk_total / (blockSize * blockSize); i++)
-                    {
-                        uint16_t address;
-                        memcpy(&address, &data2[i], sizeof(uint16_t));
-                        dataBlockTable->deallocateBlock(address);
-
-                        readOneBlock(address, data);
-                        for (unsigned j = 0; j < blk_total / blockSize; j++)
-                        {
-                            uint16_t address2;
-                            memcpy(&address2, &data[j], sizeof(uint16_t));
-                            dataBlockTable->deallocateBlock(address2);
-                        }
-                    }
-                }
-                delete[] data3;
-            }
-            delete[] data2;
+            return INode::totalDirectBlocks + level;
         }
-        delete[] data;
+        rest -= span;
     }
+    throw std::logic_error("file is too big!");
 }
 
-void FileSystem::allocData(uint16_t number, int n)
+block_t FileSystem::mapBlock(const INode &inode, block_t logical)
 {
-    INode inode;
-    readInode(inode, number);
-    deallocData(number, inode.metadata.getSize());
-    std::vector<uint16_t> blcks[4];
-
-    uint32_t total_blocks = (n / blockSize) + ((n % blockSize == 0) ? 0 : 1);
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
-
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
-    uint32_t triple_indirect_blocks = ref_per_block * double_indirect_blocks;
-
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > INode::totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
-
-    /* alloc the direct blocks */
-    uint32_t blk_total = std::min(total_blocks, INode::totalDirectBlocks);
-    for (unsigned int i = 0; i < blk_total; i++)
-        blcks[0].push_back(dataBlockTable->allocateBlock());
-
-    /* alloc the indirect blocks */
-    if (single_indirect_used)
-    {
-        /* single indirect */
-        blk_total = std::min(total_blocks - blk_total, single_indirect_blocks);
-        uint16_t single_indirect = dataBlockTable->allocateBlock();
-        blcks[1].push_back(single_indirect);
-        char *data = new char[blockSize];
-        memset(data, 0, blockSize);
-
-        for (unsigned i = 0; i < blk_total / blockSize; i++)
+    if ((uint64_t)logical * blockSize >= inode.metadata.getSize())
+        throw std::logic_error("block out of the file!");
+
+    if (inode.hasExtents())
+    {
+        /* down the extent tree through the entries that map the block */
+        ExtentNode node = inode.extentRoot;
+        while (true)
         {
-            uint16_t address = dataBlockTable->allocateBlock();
-            memcpy(&data[i], &address, sizeof(uint16_t));
+            auto it = std::upper_bound(node.entries.begin(), node.entries.end(), logical,
+                                       [](block_t l, const Extent &e) { return l < e.logical; });
+            if (it == node.entries.begin() || logical >= (it - 1)->logical + (it - 1)->length)
+                throw std::logic_error("broken extent tree!");
+            const Extent e = *(it - 1);
+            if (node.getDepth() == 0)
+                return e.physical + (logical - e.logical);
+
+            uint16_t depth = node.getDepth();
+            node = ExtentNode(blockSize);
+            readExtentNode(e.physical, depth - 1, node);
         }
-        writeOneBlock(single_indirect, data);
+    }
+
+    std::vector<uint32_t> path;
+    block_t block = inode.getReference(referencePath(logical, path));
+    for (uint32_t entry : path)
+    {
+        BlockHandle index = dataBlockTable->getBlock(block);
+        memcpy(&block, index.data() + entry * sizeof(block_t), sizeof(block_t));
+    }
+    return block;
+}
+
+std::vector<block_t> FileSystem::appendBlocks(INode &inode, block_t logical, block_t count)
+{
+    std::vector<block_t> blocks;
+    if (count == 0)
+        return blocks;
 
-        if (double_indirect_used)
+    /* the blocks right after the last one of the file are taken first, so an append goes on in place */
+    block_t goal = logical > 0 ? mapBlock(inode, logical - 1) + 1 : dataBlockTable->getTotal();
+
+    if (inode.hasExtents())
+    {
+        /* the new runs go after the old ones, only the last path of the tree changes */
+        for (Extent e : allocExtents(count, goal))
         {
-            /* double indirect */
-            blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-            uint16_t double_indirect = dataBlockTable->allocateBlock();
-            blcks[2].push_back(double_indirect);
-            char *data2 = new char[blockSize];
-            memset(data2, 0, blockSize);
-
-            for (size_t i = 0; i < blk_total / (blockSize * blockSize); i++)
-            {
-                uint16_t address = dataBlockTable->allocateBlock();
-
-                for (unsigned j = 0; j < blk_total / blockSize; j++)
-                {
-                    uint16_t address2 = dataBlockTable->allocateBlock();
-                    memcpy(&data[j], &address2, sizeof(uint16_t));
-                }
-                writeOneBlock(address, data);
-                memcpy(&data2[i], &address, sizeof(uint16_t));
-            }
+            e.logical += logical;
+            for (block_t i = 0; i < e.length; i++)
+                blocks.push_back(e.physical + i);
+            appendExtent(inode, e);
+        }
+        return blocks;
+    }
 
-            writeOneBlock(double_indirect, data2);
+    /* the data blocks in one run if there is one so the file is contiguous on disc, the indirect ones aside */
+    block_t in_place = dataBlockTable->allocateAt(goal, count);
+    block_t first = in_place < count ? dataBlockTable->allocateRange(count - in_place) : dataBlockTable->getTotal();
+    for (block_t i = 0; i < count; i++)
+    {
+        block_t block;
+        if (i < in_place)
+            block = goal + i;
+        else
+            block = first != dataBlockTable->getTotal() ? first + (i - in_place) : dataBlockTable->allocateBlock();
+        linkBlock(inode, logical + i, block);
+        blocks.push_back(block);
+    }
+    return blocks;
+}
 
-            if (triple_indirect_used)
+void FileSystem::linkBlock(INode &inode, block_t logical, block_t block)
+{
+    std::vector<uint32_t> path;
+    uint32_t reference = referencePath(logical, path);
+    if (path.empty())
+    {
+        inode.setReference(reference, block);
+        return;
+    }
+
+    /* an indirect block is new with the first block under it, when the rest of the path is all 0 */
+    auto first = [&path](size_t from) {
+        return std::all_of(path.begin() + from, path.end(), [](uint32_t entry) { return entry == 0; });
+    };
+    block_t index = first(0) ? allocIndirect() : inode.getReference(reference);
+    inode.setReference(reference, index);
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        block_t next;
+        if (i + 1 < path.size() && !first(i + 1))
+        {
+            BlockHandle handle = dataBlockTable->getBlock(index);
+            memcpy(&next, handle.data() + path[i] * sizeof(block_t), sizeof(block_t));
+        }
+        else
+        {
+            next = (i + 1 == path.size()) ? block : allocIndirect();
+            BlockHandle handle = dataBlockTable->getBlock(index);
+            memcpy(handle.data() + path[i] * sizeof(block_t), &next, sizeof(block_t));
+            handle.markDirty();
+        }
+        index = next;
+    }
+}
+
+block_t FileSystem::allocIndirect()
+{
+    block_t block = dataBlockTable->allocateBlock();
+    std::vector<char> references(blockSize, 0);
+    writeOneBlock(block, references.data());
+    return block;
+}
+
+void FileSystem::releaseBlocks(INode &inode, block_t from)
+{
+    std::vector<block_t> nodes;
+    if (inode.hasExtents())
+    {
+        ExtentNode &root = inode.extentRoot;
+        cutExtents(root, from);
+
+        /* a root of a single node takes the entries of the node back, while they fit */
+        while (root.getDepth() > 0 && root.entries.size() <= 1)
+        {
+            if (root.entries.empty())
             {
-                /* triple indirect */
-                blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-                uint16_t triple_indirect = dataBlockTable->allocateBlock();
-                blcks[3].push_back(triple_indirect_blocks);
-                char *data3 = new char[blockSize];
-                memset(data3, 0, blockSize);
-
-                for (size_t k = 0; k < blk_total / (blockSize * blockSize * blockSize); k++)
-                {
-                    uint16_t address3 = dataBlockTable->allocateBlock();
-
-                    for (size_t i = 0; i < blk_total / (blockSize * blockSize); i++)
-                    {
-                        uint16_t address = dataBlockTable->allocateBlock();
-
-                        for (unsigned j = 0; j < blk_total / blockSize; j++)
-                        {
-                            uint16_t address2 = dataBlockTable->allocateBlock();
-                            memcpy(&data[j], &address2, sizeof(uint16_t));
-                        }
-                        writeOneBlock(address, data);
-                        memcpy(&data2[i], &address, sizeof(uint16_t));
-                    }
-
-                    writeOneBlock(address3, data2);
-                    memcpy(&data3[k], &address3, sizeof(uint16_t));
-                }
-
-                writeOneBlock(triple_indirect, data3);
-                delete[] data3;
+                root.setDepth(0);
+                break;
             }
-            delete[] data2;
+            ExtentNode child(blockSize);
+            readExtentNode(root.entries[0].physical, root.getDepth() - 1, child);
+            if (child.entries.size() > root.getCapacity())
+                break;
+            dataBlockTable->deallocateBlock(root.entries[0].physical);
+            root.entries = child.entries;
+            root.setDepth(child.getDepth());
         }
-        delete[] data;
+        return;
     }
 
-    readInode(inode, number);
-    inode.metadata.setSize(n);
-    inode.setBlocks(blcks);
-    writeInode(inode, number);
+    /* the data blocks from on, then the indirect blocks that no block before from is under */
+    std::vector<block_t> blocks = fileBlocks(inode, &nodes);
+    for (size_t i = from; i < blocks.size(); i++)
+        dataBlockTable->deallocateBlock(blocks[i]);
+
+    std::vector<block_t> needed;
+    uint32_t file_size = inode.metadata.getSize();
+    inode.metadata.setSize(std::min<uint64_t>(file_size, (uint64_t)from * blockSize));
+    fileBlocks(inode, &needed);
+    inode.metadata.setSize(file_size);
+    for (auto &b : nodes)
+        if (std::find(needed.begin(), needed.end(), b) == needed.end())
+            dataBlockTable->deallocateBlock(b);
 }
 
-void FileSystem::readInode(INode &inode, uint16_t number)
+std::vector<Extent> FileSystem::allocExtents(uint32_t blocks, block_t goal)
 {
-    char *inode_data = (char *)inodeTable->getBlock(number);
-    inode.read(inode_data);
-    delete[] inode_data;
+    /* what is free at goal, then the rest in one run if there is one, else halves the run until one fits */
+    std::vector<Extent> extents;
+    block_t logical = dataBlockTable->allocateAt(goal, blocks), run = blocks;
+    if (logical > 0)
+        extents.push_back(Extent{0, goal, logical});
+    while (logical < blocks)
+    {
+        run = std::min(run, blocks - logical);
+        block_t first = dataBlockTable->allocateRange(run);
+        if (first == dataBlockTable->getTotal())
+        {
+            if (run == 1)
+                throw std::logic_error("no free block left!");
+            run = (run + 1) / 2;
+            continue;
+        }
+
+        if (!extents.empty() && extents.back().physical + extents.back().length == first)
+            extents.back().length += run;
+        else
+            extents.push_back(Extent{logical, first, run});
+        logical += run;
+    }
+    return extents;
 }
 
-void FileSystem::writeInode(INode &inode, uint16_t number)
+std::vector<Extent> FileSystem::fileExtents(const INode &inode, std::vector<block_t> *nodes)
 {
-    uint32_t size;
-    char *inode_data = inode.write(&size);
-    inodeTable->setBlock(number, inode_data);
-    delete[] inode_data;
+    std::vector<Extent> extents;
+    readExtents(inode.extentRoot, extents, nodes);
+    return extents;
 }
 
-void FileSystem::writeData(uint16_t number, char *data, int n)
+void FileSystem::readExtents(const ExtentNode &node, std::vector<Extent> &extents, std::vector<block_t> *nodes)
 {
+    if (node.getDepth() == 0)
+    {
+        extents.insert(extents.end(), node.entries.begin(), node.entries.end());
+        return;
+    }
 
-    INode inode;
-    readInode(inode, number);
+    for (auto &e : node.entries)
+    {
+        if (nodes != nullptr)
+            nodes->push_back(e.physical);
+        ExtentNode child(blockSize);
+        readExtentNode(e.physical, node.getDepth() - 1, child);
+        readExtents(child, extents, nodes);
+    }
+}
 
-    allocData(number, n);
-    readInode(inode, number);
+std::vector<block_t> FileSystem::extentBlocks(const std::vector<Extent> &extents) const
+{
+    std::vector<block_t> blocks;
+    for (auto &e : extents)
+        for (block_t i = 0; i < e.length; i++)
+            blocks.push_back(e.physical + i);
+    return blocks;
+}
 
-    /* read all direct and undirect blocks */
-    std::vector<uint16_t> blks[4];
-    inode.getBlocks(blks);
+void FileSystem::readExtentNode(block_t block, uint16_t depth, ExtentNode &node)
+{
+    BlockHandle handle = dataBlockTable->getBlock(block);
+    node.read(handle.data());
+    if (node.getDepth() != depth)
+        throw std::logic_error("broken extent tree!");
+}
 
-    uint32_t total_blocks = (n / blockSize) + ((n % blockSize == 0) ? 0 : 1);
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
+void FileSystem::writeExtentNode(block_t block, ExtentNode &node)
+{
+    uint32_t n;
+    char *data = node.write(&n);
+    writeOneBlock(block, data);
+    delete[] data;
+}
 
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
+block_t FileSystem::allocExtentNode(uint16_t depth, const Extent &entry)
+{
+    ExtentNode node(blockSize);
+    node.setDepth(depth);
+    node.entries.push_back(entry);
+    block_t block = dataBlockTable->allocateBlock();
+    writeExtentNode(block, node);
+    return block;
+}
 
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > INode::totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
+void FileSystem::mapExtents(const ExtentNode &node, block_t first, block_t count, std::vector<block_t> &blocks)
+{
+    /* from the entry that maps first on, until the one after the range */
+    uint64_t end = (uint64_t)first + count;
+    auto it = std::upper_bound(node.entries.begin(), node.entries.end(), first,
+                               [](block_t l, const Extent &e) { return l < e.logical; });
+    if (it != node.entries.begin())
+        --it;
+    for (; it != node.entries.end() && it->logical < end; ++it)
+    {
+        if ((uint64_t)it->logical + it->length <= first)
+            continue;
+        if (node.getDepth() == 0)
+        {
+            uint64_t begin = std::max<uint64_t>(first, it->logical);
+            uint64_t stop = std::min<uint64_t>(end, (uint64_t)it->logical + it->length);
+            for (uint64_t b = begin; b < stop; b++)
+                blocks.push_back(it->physical + (b - it->logical));
+            continue;
+        }
+        ExtentNode child(blockSize);
+        readExtentNode(it->physical, node.getDepth() - 1, child);
+        mapExtents(child, first, count, blocks);
+    }
+}
 
-    /* write directs */
-    char *p = data;
-    for (size_t i = 0; i < blks[0].back(); i++, p += blockSize)
-        writeOneBlock(blks[0][i], p);
+void FileSystem::appendExtent(INode &inode, const Extent &extent)
+{
+    /* the last node of every level, from the root in the inode down to the leaf */
+    std::vector<ExtentNode> path(1, inode.extentRoot);
+    std::vector<block_t> blocks(1, 0);
+    while (path.back().getDepth() > 0)
+    {
+        uint16_t depth = path.back().getDepth();
+        blocks.push_back(path.back().entries.back().physical);
+        path.push_back(ExtentNode(blockSize));
+        readExtentNode(blocks.back(), depth - 1, path.back());
+    }
 
-    /* write single indirects */
-    if (single_indirect_used)
+    /* the last extent grows if the run goes on on disc, else the extent goes into the first node up from the
+       leaf that has room, under a new node of each full level below it. a full root moves into a node of its
+       own, the tree is a level deeper then */
+    size_t level = path.size() - 1;
+    Extent entry = extent;
+    std::vector<Extent> &leaf = path[level].entries;
+    if (!leaf.empty() && leaf.back().logical + leaf.back().length == extent.logical &&
+        leaf.back().physical + leaf.back().length == extent.physical)
+        leaf.back().length += extent.length;
+    else
     {
-        singleIndirect(blks[1].at(0), p, blks[1].back(), false);
-        p += blks[1].back() * blockSize;
+        while (path[level].entries.size() == path[level].getCapacity())
+        {
+            block_t block = allocExtentNode(path[level].getDepth(), entry);
+            entry = Extent{extent.logical, block, extent.length};
+            if (level == 0)
+            {
+                ExtentNode &root = path[0];
+                const Extent &first = root.entries.front(), &last = root.entries.back();
+                Extent moved{first.logical, 0, last.logical + last.length - first.logical};
+                ExtentNode node(blockSize);
+                node.setDepth(root.getDepth());
+                node.entries.swap(root.entries);
+                moved.physical = dataBlockTable->allocateBlock();
+                writeExtentNode(moved.physical, node);
+                root.entries.push_back(moved);
+                root.setDepth(root.getDepth() + 1);
+                break;
+            }
+            level--;
+        }
+        path[level].entries.push_back(entry);
+    }
+
+    /* the nodes above the one that took the extent map it too */
+    for (size_t i = 0; i < level; i++)
+        path[i].entries.back().length += extent.length;
+    for (size_t i = 1; i <= level; i++)
+        writeExtentNode(blocks[i], path[i]);
+    inode.extentRoot = path[0];
+}
 
-        /* read double indirects */
-        if (double_indirect_used)
+void FileSystem::cutExtents(ExtentNode &node, block_t from)
+{
+    /* the entries before from stay, the one across from is cut and the ones after it are freed */
+    size_t keep = 0;
+    for (size_t i = 0; i < node.entries.size(); i++)
+    {
+        Extent &e = node.entries[i];
+        if (e.logical + e.length <= from)
         {
-            doubleIndirect(blks[2].at(0), p, blks[2].back(), false);
-            p += blks[2].back() * blockSize;
+            keep = i + 1;
+            continue;
+        }
 
-            /* read triple indirects */
-            if (triple_indirect_used)
-                tripleIndirect(blks[3].at(0), p + blks[0].back() * blockSize, blks[2].back(), false);
+        if (node.getDepth() == 0)
+        {
+            for (block_t b = std::max(from, e.logical) - e.logical; b < e.length; b++)
+                dataBlockTable->deallocateBlock(e.physical + b);
+        }
+        else
+        {
+            ExtentNode child(blockSize);
+            readExtentNode(e.physical, node.getDepth() - 1, child);
+            cutExtents(child, from);
+            if (e.logical < from)
+                writeExtentNode(e.physical, child);
+            else
+                dataBlockTable->deallocateBlock(e.physical);
+        }
+        if (e.logical < from)
+        {
+            e.length = from - e.logical;
+            keep = i + 1;
         }
     }
+    node.entries.resize(keep);
+}
+
+void FileSystem::readInode(INode &inode, block_t number)
+{
+    inodes->read(inode, number);
 }
 
-char *FileSystem::readData(uint16_t number)
+void FileSystem::writeInode(INode &inode, block_t number)
 {
+    inodes->write(inode, number);
+}
 
-    INode inode;
-    readInode(inode, number);
-    uint32_t file_size = inode.metadata.getSize();
+block_t FileSystem::cd(std::string path)
+{
+    /* the directories on the way are resolved by the dentry cache */
+    size_t occurence = std::count(path.begin(), path.end(), '/');
+    block_t current = root.getInode();
 
-    /* read all direct and undirect blocks */
-    std::vector<uint16_t> blks[4];
-    inode.getBlocks(blks);
+    size_t pos = 0;
+    path.erase(0, path.find(PATH_DELIMETER) + 1);
+    for (size_t i = 1; i < occurence; i++)
+    {
+        pos = path.find(PATH_DELIMETER);
+        current = resolve(current, path.substr(0, pos));
+        path.erase(0, path.find(PATH_DELIMETER) + 1);
+    }
+    return current;
+}
 
-    uint32_t total_blocks = (file_size / blockSize) + ((file_size % blockSize == 0) ? 0 : 1);
-    char *data = new char[total_blocks * blockSize];
+block_t FileSystem::resolve(block_t directory, const std::string &name)
+{
+    block_t inode;
+    switch (dentries.lookup(directory, name, inode))
+    {
+    case DentryCache::FOUND:
+        return inode;
+    case DentryCache::NOT_FOUND:
+        throw std::logic_error("no such file or directory!");
+    case DentryCache::MISS:
+        break;
+    }
 
-    uint32_t ref_per_block = (blockSize / sizeof(uint16_t));
+    Directory::DirectoryEntry entry;
+    if (!findEntry(directory, name, entry))
+    {
+        dentries.insertNegative(directory, name);
+        throw std::logic_error("no such file or directory!");
+    }
+    dentries.insert(directory, name, entry.getInode());
+    return entry.getInode();
+}
+
+void FileSystem::readDirectoryBlock(const INode &inode, block_t logical, Serializable &node)
+{
+    BlockHandle block = dataBlockTable->getBlock(mapBlock(inode, logical));
+    node.read(block.data());
+}
+
+void FileSystem::writeDirectoryBlock(const INode &inode, block_t logical, Serializable &node)
+{
+    uint32_t n;
+    char *data = node.write(&n);
+    writeOneBlock(mapBlock(inode, logical), data);
+    delete[] data;
+}
 
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
+block_t FileSystem::growDirectory(INode &inode, block_t directory)
+{
+    /* a block more at the end of the directory file, its logical number */
+    block_t logical = inode.metadata.getSize() / blockSize;
+    appendBlocks(inode, logical, 1);
+    inode.metadata.setSize((logical + 1) * blockSize);
+    writeInode(inode, directory);
+    return logical;
+}
 
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > INode::totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
+void FileSystem::makeDirectory(block_t number, block_t parent)
+{
+    INode inode;
+    readInode(inode, number);
+    Directory dir(parent, number);
+    writeDirectoryBlock(inode, growDirectory(inode, number), dir);
+}
 
-    /* read directs */
-    char *p = data;
-    for (size_t i = 0; i < blks[0].back(); i++, p += blockSize)
-        readOneBlock(blks[0][i], p);
+block_t FileSystem::findLeaf(const INode &inode, const Directory &dir, uint32_t hash, DirectoryIndex &node,
+                             block_t &nodeBlock)
+{
+    /* the leaf of the root, or the leaf of the index node of the root */
+    block_t block = dir.index.entries[dir.index.find(hash)].block;
+    nodeBlock = 0;
+    if (dir.getLevels() == 0)
+        return block;
+
+    nodeBlock = block;
+    readDirectoryBlock(inode, nodeBlock, node);
+    return node.entries[node.find(hash)].block;
+}
 
-    /* read single indirects */
-    if (single_indirect_used)
+bool FileSystem::findEntry(block_t directory, const std::string &name, Directory::DirectoryEntry &entry)
+{
+    INode inode;
+    readInode(inode, directory);
+    Directory dir;
+    readDirectoryBlock(inode, 0, dir);
+    if (name == CURRENT_PATH || name == PARENT_PATH)
     {
-        singleIndirect(blks[1].at(0), p, blks[1].back());
-        p += blks[1].back() * blockSize;
+        entry = Directory::DirectoryEntry(name == CURRENT_PATH ? dir.getCurrent() : dir.getParent(), name.c_str());
+        return true;
+    }
+    if (dir.index.entries.empty())
+        return false;
+
+    /* the names are kept as long as FILE_LENGTH */
+    const std::string file = name.substr(0, FILE_LENGTH);
+    DirectoryIndex node(blockSize);
+    block_t node_block;
+    DirectoryLeaf leaf;
+    readDirectoryBlock(inode, findLeaf(inode, dir, Directory::hash(file), node, node_block), leaf);
+    int i = leaf.find(file);
+    if (i < 0)
+        return false;
+    entry = leaf.entries[i];
+    return true;
+}
 
-        /* read double indirects */
-        if (double_indirect_used)
-        {
-            doubleIndirect(blks[2].at(0), p, blks[2].back());
-            p += blks[2].back() * blockSize;
+void FileSystem::addEntry(block_t directory, Directory::DirectoryEntry &entry)
+{
+    INode inode;
+    readInode(inode, directory);
+    Directory dir;
+    readDirectoryBlock(inode, 0, dir);
+    if (dir.index.entries.empty())
+    {
+        /* the first leaf takes all of the hashes */
+        DirectoryLeaf leaf;
+        leaf.entries.push_back(entry);
+        block_t leaf_block = growDirectory(inode, directory);
+        writeDirectoryBlock(inode, leaf_block, leaf);
+        dir.index.entries.push_back(HashIndex{0, leaf_block});
+        writeDirectoryBlock(inode, 0, dir);
+        return;
+    }
 
-            /* read triple indirects */
-            if (triple_indirect_used)
-                tripleIndirect(blks[3].at(0), p + blks[0].back() * blockSize, blks[2].back());
-        }
+    DirectoryIndex node(blockSize);
+    block_t node_block;
+    block_t leaf_block = findLeaf(inode, dir, Directory::hash(entry.getFileName()), node, node_block);
+    DirectoryLeaf leaf;
+    readDirectoryBlock(inode, leaf_block, leaf);
+    if (leaf.find(entry.getFileName()) >= 0)
+        throw std::logic_error("file exists!");
+    if (leaf.entries.size() < leaf.getCapacity())
+    {
+        leaf.entries.push_back(entry);
+        writeDirectoryBlock(inode, leaf_block, leaf);
+        return;
     }
 
-    return data;
+    splitLeaf(inode, directory, dir, node, node_block, leaf_block, leaf);
+    addEntry(directory, entry); /* once more, into the half of its hash */
 }
 
-Directory FileSystem::cd(std::string path)
+void FileSystem::splitLeaf(INode &inode, block_t directory, Directory &dir, DirectoryIndex &node, block_t nodeBlock,
+                           block_t leafBlock, DirectoryLeaf &leaf)
 {
-    std::string token;
-    char *data;
+    /* checked before anything is written, the entries of the upper half would be lost */
+    if (dir.getLevels() == 1 && node.entries.size() >= node.getCapacity() &&
+        dir.index.entries.size() >= dir.index.getCapacity())
+        throw std::logic_error("directory is full!");
+
+    /* in the order of the hashes the upper half goes to a new leaf, the names of a hash stay together */
+    std::vector<std::pair<uint32_t, Directory::DirectoryEntry>> sorted;
+    for (auto &e : leaf.entries)
+        sorted.push_back(std::make_pair(Directory::hash(e.getFileName()), e));
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<uint32_t, Directory::DirectoryEntry> &a,
+                 const std::pair<uint32_t, Directory::DirectoryEntry> &b) { return a.first < b.first; });
+
+    size_t mid = sorted.size() / 2;
+    while (mid < sorted.size() && sorted[mid].first == sorted[mid - 1].first)
+        mid++;
+    if (mid == sorted.size())
+    {
+        mid = sorted.size() / 2;
+        while (mid > 0 && sorted[mid].first == sorted[mid - 1].first)
+            mid--;
+        if (mid == 0)
+            throw std::logic_error("too many names of the same hash in the directory!");
+    }
 
-    size_t occurence = std::count(path.begin(), path.end(), '/');
+    DirectoryLeaf upper;
+    leaf.entries.clear();
+    for (size_t i = 0; i < sorted.size(); i++)
+        (i < mid ? leaf : upper).entries.push_back(sorted[i].second);
 
-    Directory *dirs = new Directory[occurence];
+    block_t upper_block = growDirectory(inode, directory);
+    writeDirectoryBlock(inode, leafBlock, leaf);
+    writeDirectoryBlock(inode, upper_block, upper);
+    insertIndex(inode, directory, dir, node, nodeBlock, HashIndex{sorted[mid].first, upper_block});
+}
 
-    data = (char *)readData(root.getInode());
-    dirs[0].read(data);
-    delete[] data;
+void FileSystem::insertIndex(INode &inode, block_t directory, Directory &dir, DirectoryIndex &node, block_t nodeBlock,
+                             const HashIndex &entry)
+{
+    if (dir.getLevels() == 0)
+    {
+        if (dir.index.entries.size() < dir.index.getCapacity())
+        {
+            dir.index.insert(entry);
+            writeDirectoryBlock(inode, 0, dir);
+            return;
+        }
 
-    size_t pos = 0;
-    path.erase(0, path.find(PATH_DELIMETER) + 1);
-    for (size_t i = 1; i < occurence; i++)
+        /* the root is full: its entries go down to an index node, the only one of the root */
+        nodeBlock = growDirectory(inode, directory);
+        node.entries = dir.index.entries;
+        dir.index.entries.assign(1, HashIndex{0, nodeBlock});
+        dir.setLevels(1);
+        writeDirectoryBlock(inode, 0, dir);
+    }
+
+    if (node.entries.size() < node.getCapacity())
     {
-        pos = path.find(PATH_DELIMETER);
-        token = path.substr(0, pos);
-        data = (char *)readData(dirs[i - 1].getFile(token));
-        dirs[i].read(data);
-        delete[] data;
-        path.erase(0, path.find(PATH_DELIMETER) + 1);
+        node.insert(entry);
+        writeDirectoryBlock(inode, nodeBlock, node);
+        return;
     }
 
-    Directory dir = dirs[occurence - 1];
-    delete[] dirs;
+    /* the index node is full: its upper half goes to a new node, that goes into the root */
+    DirectoryIndex upper(blockSize);
+    upper.entries.assign(node.entries.begin() + node.entries.size() / 2, node.entries.end());
+    node.entries.resize(node.entries.size() / 2);
+    (entry.hash < upper.entries.front().hash ? node : upper).insert(entry);
+
+    block_t upper_block = growDirectory(inode, directory);
+    writeDirectoryBlock(inode, nodeBlock, node);
+    writeDirectoryBlock(inode, upper_block, upper);
+    dir.index.insert(HashIndex{upper.entries.front().hash, upper_block});
+    writeDirectoryBlock(inode, 0, dir);
+}
+
+void FileSystem::removeEntry(block_t directory, const std::string &name)
+{
+    INode inode;
+    readInode(inode, directory);
+    Directory dir;
+    readDirectoryBlock(inode, 0, dir);
+
+    const std::string file = name.substr(0, FILE_LENGTH);
+    DirectoryLeaf leaf;
+    block_t leaf_block = 0;
+    int i = -1;
+    if (!dir.index.entries.empty())
+    {
+        DirectoryIndex node(blockSize);
+        block_t node_block;
+        leaf_block = findLeaf(inode, dir, Directory::hash(file), node, node_block);
+        readDirectoryBlock(inode, leaf_block, leaf);
+        i = leaf.find(file);
+    }
+    if (i < 0)
+        throw std::logic_error("no such file or directory!");
 
-    return dir;
+    /* the last entry takes its place, the leaves are never merged */
+    leaf.entries[i] = leaf.entries.back();
+    leaf.entries.pop_back();
+    writeDirectoryBlock(inode, leaf_block, leaf);
+}
+
+std::vector<Directory::DirectoryEntry> FileSystem::listEntries(block_t directory)
+{
+    INode inode;
+    readInode(inode, directory);
+    Directory dir;
+    readDirectoryBlock(inode, 0, dir);
+
+    std::vector<block_t> leaves;
+    for (auto &e : dir.index.entries)
+    {
+        if (dir.getLevels() == 0)
+        {
+            leaves.push_back(e.block);
+            continue;
+        }
+        DirectoryIndex node(blockSize);
+        readDirectoryBlock(inode, e.block, node);
+        for (auto &l : node.entries)
+            leaves.push_back(l.block);
+    }
+
+    std::vector<Directory::DirectoryEntry> entries;
+    for (auto &b : leaves)
+    {
+        DirectoryLeaf leaf;
+        readDirectoryBlock(inode, b, leaf);
+        entries.insert(entries.end(), leaf.entries.begin(), leaf.entries.end());
+    }
+    return entries;
 }
 
 void FileSystem::list(std::string path)
 {
-    std::vector<Directory::DirectoryEntry> files = cd(path).getEntries();
+    /* the leaves are in the order of the hashes, the listing in the order of the names */
+    std::vector<Directory::DirectoryEntry> files = listEntries(cd(path));
+    std::sort(files.begin(), files.end(), [](const Directory::DirectoryEntry &a, const Directory::DirectoryEntry &b) {
+        return a.getFileName() < b.getFileName();
+    });
 
     for (auto const &t : files)
     {
@@ -781,138 +1351,106 @@ void FileSystem::mkdir(std::string path)
 {
     std::string file = getFile(path);
     path = getPath(path);
-    Directory current_dir = cd(path);
+    block_t current_dir = cd(path);
+    Directory::DirectoryEntry existing;
+    if (findEntry(current_dir, file, existing))
+        throw std::logic_error("file exists!");
 
     /* create the new directory */
-    uint16_t new_dir_inode = inodeTable->allocateBlock();
+    block_t new_dir_inode = inodeTable->allocateBlock();
     Directory::DirectoryEntry new_dir(new_dir_inode, file.c_str());
     INode new_inode;
     new_inode.metadata.setFileName(file);
-    uint32_t inode_size;
-    char *inode_data = new_inode.write(&inode_size);
-    inodeTable->setBlock(new_dir_inode, inode_data);
-    delete[] inode_data;
-    Directory dir(current_dir.getFile("."), new_dir_inode);
-    inode_data = dir.write(&inode_size);
-    writeData(new_dir_inode, inode_data, inode_size);
-    delete[] inode_data;
+    writeInode(new_inode, new_dir_inode);
+    makeDirectory(new_dir_inode, current_dir);
 
     /* insert to the given directory */
-    uint32_t dir_size;
-    current_dir.addFile(new_dir);
-    char *data = current_dir.write(&dir_size);
-    writeData(current_dir.getFile("."), data, dir_size);
-    delete[] data;
+    addEntry(current_dir, new_dir);
+    dentries.invalidate(current_dir, file);
 }
 
-void FileSystem::removeFile(uint16_t index)
+void FileSystem::removeFile(block_t index)
 {
     INode inode;
     readInode(inode, index);
-    deallocData(index, inode.metadata.getSize());
+    releaseBlocks(inode);
+    inodes->discard(index);
     inodeTable->deallocateBlock(index);
 }
 
-void FileSystem::removeDir(Directory &dir)
+void FileSystem::removeDir(block_t directory)
 {
-    for (auto &i : dir.getEntries())
+    for (auto &i : listEntries(directory))
     {
         if (i.getIsDir()) // recursively deleting files.
-        {
-            char *dir_data = readData(i.getInode());
-            Directory dir;
-            dir.read(dir_data);
-            removeDir(dir);
-            delete[] dir_data;
-        }
+            removeDir(i.getInode());
         else
             removeFile(i.getInode());
-        dir.removeFile(i.getFileName());
     }
 
-    removeFile(dir.getFile("."));
+    dentries.invalidateDirectory(directory);
+    removeFile(directory);
 }
 
 void FileSystem::rmdir(std::string path)
 {
-    Directory current_dir = cd(path + "/");
-
-    removeDir(current_dir);
+    removeDir(cd(path + "/"));
 
     std::string file = getFile(path);
     path = getPath(path);
-    Directory parent_dir = cd(path);
-
-    uint32_t dir_size;
-    parent_dir.removeFile(file);
-    char *data = parent_dir.write(&dir_size);
-    writeData(parent_dir.getFile("."), data, dir_size);
-    delete[] data;
-}
+    block_t parent_dir = cd(path);
 
-inline std::string readLinuxFile(const std::string &path)
-{
-    std::ostringstream buf;
-    std::ifstream input(path.c_str());
-    buf << input.rdbuf();
-    return buf.str();
-}
-
-inline void writeLinuxFile(char *data, uint32_t size, const std::string &path)
-{
-    std::ofstream out;
-    out.open(path, std::ios::out | std::ios::binary);
-    out.write(data, size);
-    out.close();
+    removeEntry(parent_dir, file);
+    dentries.invalidate(parent_dir, file);
 }
 
 void FileSystem::write(std::string path, std::string file)
 {
-    Directory current_dir = cd(getPath(path));
+    std::ifstream input(file.c_str(), std::ios::in | std::ios::binary);
+    if (!input)
+        throw std::logic_error("can't open the file " + file);
+
+    block_t current_dir = cd(getPath(path));
     std::string file_name = getFile(path);
 
-    if (current_dir.hasFile(file_name))
-        del(path);
+    Directory::DirectoryEntry existing;
+    if (findEntry(current_dir, file_name, existing))
+        del(path); /* the new entry takes the place of the deleted one */
 
     Directory::DirectoryEntry new_file(inodeTable->allocateBlock(), file_name.c_str(), false);
 
-    std::string content = readLinuxFile(file);
-
     // create inode.
     INode inode;
     inode.metadata.setFileName(file_name);
     writeInode(inode, new_file.getInode());
 
-    // write the data into inode.
-    uint32_t file_size = (content.length() / blockSize) * blockSize + blockSize;
-    char *data = new char[file_size];
-    memset(data, 0, file_size);
-    memcpy(data, content.c_str(), content.length());
-
-    writeData(new_file.getInode(), data, content.length());
-    delete[] data;
+    // write the data into inode, a chunk at a time so the file is never whole in memory.
+    std::vector<char> chunk(STREAM_BLOCKS * blockSize);
+    while (input.read(chunk.data(), chunk.size()) || input.gcount() > 0)
+        append(new_file.getInode(), chunk.data(), input.gcount());
 
     // insert the file into directory
-    current_dir.addFile(new_file);
-    uint32_t dir_size;
-    data = current_dir.write(&dir_size);
-    writeData(current_dir.getFile("."), data, dir_size);
-    delete[] data;
+    addEntry(current_dir, new_file);
+    dentries.invalidate(current_dir, file_name);
 }
 
 void FileSystem::read(std::string path, std::string linux_file)
 {
     std::string file = getFile(path);
-    Directory current_dir = cd(path);
-
-    uint16_t file_inode = current_dir.getFile(file);
+    block_t file_inode = resolve(cd(path), file);
 
-    INode inode;
-    readInode(inode, file_inode);
+    std::ofstream out(linux_file, std::ios::out | std::ios::binary);
+    if (!out)
+        throw std::logic_error("can't open the file " + linux_file);
 
-    char *data = readData(file_inode);
-    writeLinuxFile(data, inode.metadata.getSize(), linux_file);
-    delete[] data;
+    /* a chunk at a time, the file is never whole in memory */
+    std::vector<char> chunk(STREAM_BLOCKS * blockSize);
+    uint32_t offset = 0, n;
+    while ((n = readAt(file_inode, offset, chunk.data(), chunk.size())) > 0)
+    {
+        out.write(chunk.data(), n);
+        offset += n;
+    }
 }
 
 void FileSystem::del(std::string path)
@@ -920,17 +1458,14 @@ void FileSystem::del(std::string path)
     std::string file = getFile(path);
     path = getPath(path);
 
-    Directory current_dir = cd(path);
+    block_t current_dir = cd(path);
 
     // delete inode and data.
-    removeFile(current_dir.getFile(file));
+    removeFile(resolve(current_dir, file));
 
     // delete the directory entry from directory
-    current_dir.removeFile(file);
-    uint32_t dir_size;
-    char *data = current_dir.write(&dir_size);
-    writeData(current_dir.getFile("."), data, dir_size);
-    delete[] data;
+    removeEntry(current_dir, file);
+    dentries.invalidate(current_dir, file);
 }
 
 void FileSystem::dumpe2fs()
@@ -942,33 +1477,57 @@ void FileSystem::dumpe2fs()
     std::cout << "Free blocks:\t\t" << dataBlockTable->freeTotal() << std::endl;
     std::cout << "Block size:\t\t" << blockSize << std::endl;
     std::cout << "Inode size:\t\t" << blockSize << std::endl;
+    std::cout << "Disc size:\t\t" << discSize << std::endl;
+    std::cout << "File mapping:\t\t" << ((features & FEATURE_EXTENTS) ? "extents" : "blocks") << std::endl;
 
     // print occupied inodes and blocks.
     std::cout << "Occupied inodes:" << std::endl;
     for (auto &index : inodeTable->occupied())
     {
         INode inode;
-        std::vector<uint16_t> blcks[4];
         readInode(inode, index);
-        inode.getBlocks(blcks);
         std::cout << "Index: " << index << "\tFilename: " << inode.metadata.getFileName() << std::endl;
         std::cout << "Occopied blocks: { ";
 
-        for (int i = 0; i < 4; i++)
-            for (auto &b : blcks[i])
+        if (inode.hasExtents())
+        {
+            /* the runs of the file, then the blocks of its extent tree */
+            std::vector<block_t> nodes;
+            for (auto &e : fileExtents(inode, &nodes))
+                std::cout << e.physical << "-" << e.physical + e.length - 1 << ",";
+            for (auto &b : nodes)
+                std::cout << b << ",";
+        }
+        else
+        {
+            /* the blocks of the file, then its indirect blocks */
+            std::vector<block_t> nodes;
+            for (auto &b : fileBlocks(inode, &nodes))
+                std::cout << b << ",";
+            for (auto &b : nodes)
                 std::cout << b << ",";
+        }
         std::cout << "\b\b\b";
         std::cout << " }" << std::endl;
     }
+
+    // print the buffer cache counters of this session.
+    printCache("Inode block cache:\t", inodeTable);
+    printCache("Data block cache:\t", dataBlockTable);
+    InodeCache::Stats parsed = inodes->getStats();
+    std::cout << "Inode cache:\t\thits " << parsed.hits << ", misses " << parsed.misses << ", evictions "
+              << parsed.evictions << ", write-backs " << parsed.writeBacks << std::endl;
+    DentryCache::Stats dentry = dentries.getStats();
+    std::cout << "Dentry cache:\t\thits " << dentry.hits << ", negative hits " << dentry.negativeHits << ", misses "
+              << dentry.misses << ", evictions " << dentry.evictions << std::endl;
 }
 
 void FileSystem::printTable(BlockManager *table)
 {
-    bool *bitmap = table->write();
     std::cout << "Block in use:" << std::endl;
     for (size_t i = 0; i < table->getTotal(); i++)
     {
-        std::cout << std::to_string(bitmap[i] ? 1 : 0) << " ";
+        std::cout << std::to_string(table->inFree(i) ? 0 : 1) << " ";
         if (i % 35 == 0)
             std::cout << std::endl;
     }
@@ -977,12 +1536,20 @@ void FileSystem::printTable(BlockManager *table)
     std::cout << "\t\tFree blocks[" << std::endl;
     for (size_t i = 0; i < table->getTotal(); i++)
     {
-        std::cout << std::to_string(bitmap[i] ? 0 : 1) << " ";
+        std::cout << std::to_string(table->inFree(i) ? 1 : 0) << " ";
         if (i % 35 == 0)
             std::cout << std::endl;
     }
     std::cout << std::endl;
 }
+
+void FileSystem::printCache(std::string title, BlockManager *table)
+{
+    BufferCache::Stats stats = table->getCacheStats();
+    std::cout << title << "hits " << stats.hits << ", misses " << stats.misses << ", evictions " << stats.evictions
+              << ", write-backs " << stats.writeBacks << std::endl;
+}
+
 void FileSystem::ln(std::string file1, std::string file2)
 {
     read(file1, "temp_file.txt");
@@ -991,17 +1558,13 @@ void FileSystem::ln(std::string file1, std::string file2)
 }
 void FileSystem::lnsym(std::string file1, std::string file2)
 {
-    Directory dir1 = cd(getPath(file1));
-    Directory dir2 = cd(getPath(file2));
-
-    uint16_t inode = dir1.getFile(getFile(file1));
+    block_t inode = resolve(cd(getPath(file1)), getFile(file1));
+    block_t dir2 = cd(getPath(file2));
 
     Directory::DirectoryEntry entry(inode, getFile(file2).c_str(), false);
 
-    dir2.addFile(entry);
-    uint32_t size;
-    char *data = dir2.write(&size);
-    writeData(dir2.getFile("."), data, size);
+    addEntry(dir2, entry);
+    dentries.invalidate(dir2, getFile(file2));
 }
 
 void FileSystem::fsck()
@@ -0,0 +1,156 @@
+/**
+ * cache of the parsed inodes, in front of the inode table. @see FileSystem::readInode()
+ * an inode is read from its block and parsed once, then copied from and to the cache. a written inode is only
+ * marked dirty, it is serialized into its block when it is evicted or flushed.
+ * holds at most <capacity> inodes, the least recently used one is evicted.
+ * flush writes the dirty inodes in the order of their numbers, so their blocks go forward on disc.
+ **/
+
+#ifndef INODE_CACHE_H
+#define INODE_CACHE_H
+
+#include <map>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include "inode.h"
+#include "block-manager.h"
+
+#define INODE_CACHE_ENTRIES 256
+
+class InodeCache
+{
+public:
+    InodeCache(BlockManager *table, unsigned int capacity = INODE_CACHE_ENTRIES);
+
+    InodeCache(const InodeCache &) = delete;
+    InodeCache &operator=(const InodeCache &) = delete;
+
+    void read(INode &inode, block_t number);  /* parsed from its block on a miss */
+    void write(INode &inode, block_t number); /* dirty until flushed */
+
+    /**
+     * writes all dirty inodes into the inode table.
+     **/
+    void flush();
+
+    /**
+     * forgets the inode without writing it, for the freed inodes.
+     **/
+    void discard(block_t number);
+
+    struct Stats
+    {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        unsigned long writeBacks;
+    };
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<INode> inode;
+        bool dirty;
+        std::list<block_t>::iterator age;
+    };
+
+    BlockManager *table;
+    unsigned int capacity;
+    std::map<block_t, Entry> entries; // ordered by inode number.
+    std::list<block_t> recent;        // most recently used first.
+    Stats stats;
+
+    Entry &find(block_t number, bool parse);
+    void writeBack(block_t number, Entry &);
+};
+
+InodeCache::InodeCache(BlockManager *_table, unsigned int _capacity) : table(_table), capacity(_capacity)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("inode cache needs at least one inode!");
+    stats = Stats{0, 0, 0, 0};
+}
+
+void InodeCache::read(INode &inode, block_t number)
+{
+    inode.copy(*find(number, true).inode);
+}
+
+void InodeCache::write(INode &inode, block_t number)
+{
+    Entry &entry = find(number, false);
+    entry.inode->copy(inode);
+    entry.dirty = true;
+}
+
+InodeCache::Entry &InodeCache::find(block_t number, bool parse)
+{
+    auto it = entries.find(number);
+    if (it != entries.end())
+    {
+        stats.hits++;
+        recent.splice(recent.begin(), recent, it->second.age);
+        return it->second;
+    }
+
+    stats.misses++;
+    std::unique_ptr<INode> inode(new INode());
+    if (parse) /* a written inode is overwritten as a whole */
+    {
+        BlockHandle block = table->getBlock(number);
+        inode->read(block.data());
+    }
+
+    if (entries.size() == capacity)
+    {
+        auto victim = entries.find(recent.back());
+        stats.evictions++;
+        if (victim->second.dirty)
+            writeBack(victim->first, victim->second);
+        recent.pop_back();
+        entries.erase(victim);
+    }
+
+    recent.push_front(number);
+    Entry &entry = entries[number];
+    entry.inode = std::move(inode);
+    entry.dirty = false;
+    entry.age = recent.begin();
+    return entry;
+}
+
+void InodeCache::writeBack(block_t number, Entry &entry)
+{
+    uint32_t size;
+    char *data = entry.inode->write(&size);
+    table->setBlock(number, data);
+    delete[] data;
+    entry.dirty = false;
+    stats.writeBacks++;
+}
+
+void InodeCache::flush()
+{
+    for (auto &entry : entries)
+        if (entry.second.dirty)
+            writeBack(entry.first, entry.second);
+}
+
+void InodeCache::discard(block_t number)
+{
+    auto it = entries.find(number);
+    if (it == entries.end())
+        return;
+    recent.erase(it->second.age);
+    entries.erase(it);
+}
+
+InodeCache::Stats InodeCache::getStats() const
+{
+    return stats;
+}
+
+#endif
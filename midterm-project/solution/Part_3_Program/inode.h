@@ -2,6 +2,7 @@
 #define INODE_H
 #include <ctime>
 #include "serializable.h"
+#include "extent.h"
 #include "string"
 #include <iostream>
 #include <cstring>
@@ -12,17 +13,20 @@
 
 /**
  * represents the i-node structure.
- * contains 5 different fields makes up to <input_size>*KB bytes in total. 
+ * contains 6 different fields makes up to <input_size>*KB bytes in total. 
  *  -> attributes field             : metadata about the field             : 328 bytes.
- *  -> data blocks field            : references to data blocks            : x - 334 bytes.
- *  -> single indirect block field  : reference to a block of references   : 2 bytes.
- *  -> double indirect block field  : reference to a block of references   : 2 bytes.
- *  -> triple indirect block field  : two level references                 : 2 bytes.
+ *  -> mapping field                : block references or extents          : 4 bytes.
+ *  -> data blocks field            : references to data blocks            : x - 344 bytes.
+ *  -> single indirect block field  : reference to a block of references   : 4 bytes.
+ *  -> double indirect block field  : reference to a block of references   : 4 bytes.
+ *  -> triple indirect block field  : two level references                 : 4 bytes.
  *                                                                         + ________
  *                                                <input_size>*KB            x bytes.
  * 
- * INode structure itself is 352 bytes in total. since 334 + 8 (data block *) = 352.
- * but of course, we are not interested in this.
+ * every reference is a 32-bit block number. an indirect block is a block of references, to the data blocks
+ * for the single one, to single indirect blocks for the double one and to double ones for the triple one.
+ * an inode of extents keeps the root of its extent tree in the place of the references instead. @see extent.h
+ * new inodes take the mapping given by setMapping, an inode read from disc keeps its own.
  *  
  **/
 
@@ -35,19 +39,31 @@ public:
     INode();
     ~INode();
 
-    /* forbidding of copying inodes */
+    /* forbidding of copying inodes, only on purpose */
     INode(INode &) = delete;
     INode &operator=(INode &) = delete;
+    void copy(const INode &);
 
-    void getBlocks(std::vector<uint16_t> blcks[4]) const;
-    void setBlocks(std::vector<uint16_t> blcks[4]);
+    /* the direct references in order, then the single, double and triple indirect ones */
+    block_t getReference(uint32_t) const;
+    void setReference(uint32_t, block_t);
 
     /* serialization */
     char *write(uint32_t *s);
     void read(char *);
 
     std::string info() const;
-    static void setSize(uint16_t);
+    static void setSize(uint32_t);
+
+    enum Mapping : uint32_t
+    {
+        BLOCK_MAP = 0, /* direct and indirect references */
+        EXTENT_MAP = 1 /* extent tree */
+    };
+    static void setMapping(Mapping); /* of the new inodes */
+    bool hasExtents() const;
+
+    ExtentNode extentRoot; /* only for the inodes of extents */
 
 private:
     class FileAttribute : public Serializable
@@ -72,14 +88,16 @@ private:
         char fileName[FILENAME_LENGTH_LIMIT];
     };
 
-    uint16_t *directBlock;
-    uint16_t indirectBlock[3]; // 3 block for indirect blocks.
+    uint32_t mapping;
+    block_t *directBlock;
+    block_t indirectBlock[3]; // 3 block for indirect blocks.
 
     /* those does not count in the inode block structure. (since they're static.) */
     static uint32_t size;
     static uint32_t size_metadata;
     static uint32_t size_directs;
     static uint32_t size_indirects;
+    static Mapping newMapping;
 
 public:
     FileAttribute metadata;
@@ -92,13 +110,14 @@ uint32_t INode::totalDirectBlocks;
 uint32_t INode::size_metadata;
 uint32_t INode::size_directs;
 uint32_t INode::size_indirects;
+INode::Mapping INode::newMapping = INode::BLOCK_MAP;
 
 INode::INode()
-    : metadata()
+    : extentRoot(size_directs + size_indirects), mapping(newMapping), metadata()
 {
     if (size == 0)
         throw std::logic_error("can't create an with uninitialized size!");
-    directBlock = new uint16_t[totalDirectBlocks];
+    directBlock = new block_t[totalDirectBlocks];
 }
 
 INode::~INode()
@@ -116,8 +135,19 @@ char *INode::write(uint32_t *s)
 
     /* merge */
     memcpy(buf, s_metadata, size_metadata);
-    memcpy(buf + size_metadata, directBlock, size_directs);
-    memcpy(buf + size_metadata + size_directs, indirectBlock, size_indirects);
+    memcpy(buf + size_metadata, &mapping, sizeof(mapping));
+    char *p = buf + size_metadata + sizeof(mapping);
+    if (hasExtents())
+    {
+        char *s_root = extentRoot.write(&_size);
+        memcpy(p, s_root, size_directs + size_indirects);
+        delete[] s_root;
+    }
+    else
+    {
+        memcpy(p, directBlock, size_directs);
+        memcpy(p + size_directs, indirectBlock, size_indirects);
+    }
 
     delete[] s_metadata;
     return buf;
@@ -126,100 +156,67 @@ char *INode::write(uint32_t *s)
 void INode::read(char *buf)
 {
     metadata.read(buf);
-    memcpy(directBlock, buf + size_metadata, size_directs);
-    memcpy(indirectBlock, buf + size_metadata + size_directs, size_indirects);
+    memcpy(&mapping, buf + size_metadata, sizeof(mapping));
+    buf += size_metadata + sizeof(mapping);
+    if (hasExtents())
+        extentRoot.read(buf);
+    else
+    {
+        memcpy(directBlock, buf, size_directs);
+        memcpy(indirectBlock, buf + size_directs, size_indirects);
+    }
+}
+
+void INode::copy(const INode &other)
+{
+    metadata = other.metadata;
+    mapping = other.mapping;
+    memcpy(directBlock, other.directBlock, size_directs);
+    memcpy(indirectBlock, other.indirectBlock, size_indirects);
+    extentRoot = other.extentRoot;
+}
+
+void INode::setMapping(Mapping _mapping)
+{
+    newMapping = _mapping;
 }
 
-void INode::setSize(uint16_t _size)
+bool INode::hasExtents() const
+{
+    return mapping == EXTENT_MAP;
+}
+
+void INode::setSize(uint32_t _size)
 {
     if (!(_size > 0 && ((_size & (_size - 1)) == 0)))
         throw std::invalid_argument("size must be power of 2!");
     size = _size;
-    totalDirectBlocks = (size - sizeof(metadata) - (sizeof(uint16_t) * 3)) / sizeof(uint16_t);
+    totalDirectBlocks = (size - sizeof(metadata) - sizeof(mapping) - (sizeof(block_t) * 3)) / sizeof(block_t);
     size_metadata = sizeof(FileAttribute);
-    size_directs = totalDirectBlocks * sizeof(uint16_t);
-    size_indirects = 3 * sizeof(uint16_t);
+    size_directs = totalDirectBlocks * sizeof(block_t);
+    size_indirects = 3 * sizeof(block_t);
 }
 
-void INode::getBlocks(std::vector<uint16_t> blcks[4]) const
+block_t INode::getReference(uint32_t i) const
 {
-    uint32_t total_blocks = (metadata.getSize() / size) + ((metadata.getSize() %size == 0)? 0: 1);
-    uint32_t ref_per_block = (size / sizeof(uint16_t));
-
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
-
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
-
-    /* collect the direct blocks */
-    uint32_t blk_total = std::min(total_blocks, totalDirectBlocks);
-    for (unsigned int i = 0; i < blk_total; i++)
-        blcks[0].push_back(directBlock[i]);
-    blcks[0].push_back(blk_total);
-
-    /* collect the indirect blocks */
-    if (single_indirect_used)
-    {
-        /* single indirect */
-        blk_total = std::min(total_blocks - blk_total, single_indirect_blocks);
-        blcks[1].push_back(indirectBlock[0]);
-        blcks[1].push_back(blk_total);
-
-        if (double_indirect_used)
-        {
-            /* double indirect */
-            blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-            blcks[2].push_back(indirectBlock[1]);
-            blcks[2].push_back(blk_total);
-            if (triple_indirect_used)
-            {
-                /* triple indirect */
-                blk_total = std::min(total_blocks - blk_total, double_indirect_blocks);
-                blcks[3].push_back(indirectBlock[2]);
-                blcks[3].push_back(blk_total);
-            }
-        }
-    }
+    if (i >= totalDirectBlocks + 3)
+        throw std::invalid_argument("no such block reference!");
+    return i < totalDirectBlocks ? directBlock[i] : indirectBlock[i - totalDirectBlocks];
 }
 
-std::string INode::info() const
+void INode::setReference(uint32_t i, block_t block)
 {
-    return std::to_string(metadata.getSize()) + "\t" + metadata.getLastModification() + "\t";
+    if (i >= totalDirectBlocks + 3)
+        throw std::invalid_argument("no such block reference!");
+    if (i < totalDirectBlocks)
+        directBlock[i] = block;
+    else
+        indirectBlock[i - totalDirectBlocks] = block;
 }
 
-void INode::setBlocks(std::vector<uint16_t> blcks[4])
+std::string INode::info() const
 {
-    uint32_t total_blocks = (metadata.getSize() / size) + ((metadata.getSize() %size == 0)? 0: 1);
-    uint32_t ref_per_block = (size / sizeof(uint16_t));
-
-    /* total number of blocks indirects references */
-    uint32_t single_indirect_blocks = ref_per_block;
-    uint32_t double_indirect_blocks = ref_per_block * single_indirect_blocks;
-
-    /* find the used blocks */
-    const bool single_indirect_used = total_blocks > totalDirectBlocks;
-    const bool double_indirect_used = total_blocks > single_indirect_blocks;
-    const bool triple_indirect_used = total_blocks > double_indirect_blocks;
-
-    /* set the direct blocks */
-    uint32_t blk_total = std::min(total_blocks, totalDirectBlocks);
-    for (unsigned int i = 0; i < blk_total; i++)
-        directBlock[i] = blcks[0][i];
-
-    if (single_indirect_used)
-    {
-        indirectBlock[0] = blcks[1][0];
-        if (double_indirect_used)
-        {
-            indirectBlock[1] = blcks[2][0];
-            if (triple_indirect_used)
-                indirectBlock[2] = blcks[3][0];
-        }
-    }
+    return std::to_string(metadata.getSize()) + "\t" + metadata.getLastModification() + "\t";
 }
 
 /* FileAttribute Implementation */
@@ -0,0 +1,244 @@
+/**
+ * input-output communicator of the disc: reads and writes the blocks of a block table.
+ * one block at a time through the data reference, or a run of blocks in a row at once with a single
+ * vectored call, straight into the buffers of the caller.
+ * the disc is a file descriptor, so every read sees every write before it without a flush.
+ * a flush makes the writes durable, they are on the storage under the disc file then.
+ ***/
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include "serializable.h"
+
+#ifndef IOCOMMUNICATOR_H
+#define IOCOMMUNICATOR_H
+
+class IOCommunicator
+{
+public:
+    /*
+     * creates an input-output communicator.
+     **/
+    IOCommunicator();
+
+    /**
+     * destroys the connection io disc. must be called at some point to free the resources.
+     **/
+    void closeDisc();
+
+    /**
+     * gets the size of block in bytes.
+     **/
+    unsigned int getSize();
+
+    /**
+     * gets the index of block in block table.
+     **/
+    block_t getIndex();
+
+    /**
+     * sets the index of block in block table.
+     **/
+    void setIndex(block_t);
+
+    void setData(void *);
+    void *getData() const;
+
+    /**
+     * factory functions for io-communicator.
+     */
+    IOCommunicator &initDisc(std::string);
+    IOCommunicator &initSize(unsigned int);
+    IOCommunicator &initOffset(uint64_t);
+
+    void checkInitialized() const;
+
+    void readFromDisc();
+    void writeToDisc();
+
+    /**
+     * the blocks from first on in a row, into or from the buffers of the vector in order.
+     * the buffers must be as long as the blocks in total.
+     **/
+    void readRun(block_t first, std::vector<struct iovec> &);
+    void writeRun(block_t first, std::vector<struct iovec> &);
+
+    /**
+     * the writes go to the disc file directly, another stream on it already sees them.
+     * syncs them to the storage, so they survive a crash.
+     **/
+    void flushDisc();
+
+private:
+    void *data; // there won't any allocation. only a reference.
+    int disc;
+    unsigned int size; // block size, will be same for all block in one session;
+    uint64_t offset;   // data blocks start offset in disc.
+    block_t index;
+
+    bool sizeInitialized;
+    bool offsetInitialized;
+    bool discInitialized;
+
+    uint64_t position(block_t) const; /* 64-bit, the disc can be far beyond 4GB */
+    void transfer(block_t first, std::vector<struct iovec> &, bool write);
+};
+
+IOCommunicator::IOCommunicator()
+    : data(nullptr),
+      disc(-1),
+      size(0),
+      offset(0),
+      index(0),
+      sizeInitialized(false),
+      offsetInitialized(false),
+      discInitialized(false)
+{ /* intentionally left blank */
+}
+
+uint64_t IOCommunicator::position(block_t block) const
+{
+    return offset + (uint64_t)block * size;
+}
+
+void IOCommunicator::readFromDisc()
+{
+    std::vector<struct iovec> buffer(1, iovec{getData(), getSize()});
+    readRun(getIndex(), buffer);
+}
+
+void IOCommunicator::writeToDisc()
+{
+    std::vector<struct iovec> buffer(1, iovec{getData(), getSize()});
+    writeRun(getIndex(), buffer);
+}
+
+void IOCommunicator::readRun(block_t first, std::vector<struct iovec> &buffers)
+{
+    transfer(first, buffers, false);
+}
+
+void IOCommunicator::writeRun(block_t first, std::vector<struct iovec> &buffers)
+{
+    transfer(first, buffers, true);
+}
+
+void IOCommunicator::transfer(block_t first, std::vector<struct iovec> &buffers, bool write)
+{
+    checkInitialized();
+    off_t at = position(first);
+
+    /* at most IOV_MAX buffers a call, a short transfer goes on from where it stopped */
+    for (size_t i = 0; i < buffers.size();)
+    {
+        int count = std::min<size_t>(buffers.size() - i, IOV_MAX);
+        ssize_t done = write ? pwritev(disc, &buffers[i], count, at) : preadv(disc, &buffers[i], count, at);
+        if (done < 0 && errno == EINTR) /* a signal before anything is transferred, once more */
+            continue;
+        if (done < 0)
+            throw std::logic_error(write ? "can't write to the disc!" : "can't read from the disc!");
+        if (done == 0 && !write) /* after the end of the disc, reads as zero */
+        {
+            for (; i < buffers.size(); i++)
+                memset(buffers[i].iov_base, 0, buffers[i].iov_len);
+            return;
+        }
+
+        at += done;
+        for (; i < buffers.size() && (size_t)done >= buffers[i].iov_len; i++)
+            done -= buffers[i].iov_len;
+        if (done > 0)
+        {
+            buffers[i].iov_base = (char *)buffers[i].iov_base + done;
+            buffers[i].iov_len -= done;
+        }
+    }
+}
+
+void IOCommunicator::flushDisc()
+{
+    checkInitialized();
+    while (fsync(disc) < 0)
+        if (errno != EINTR)
+            throw std::logic_error("can't sync the disc!");
+}
+
+IOCommunicator &IOCommunicator::initSize(unsigned int _size)
+{
+    if (sizeInitialized)
+        throw std::logic_error("can't initialize size once more!");
+    if (_size == 0)
+        throw std::invalid_argument("size can't be zero!");
+    size = _size;
+    sizeInitialized = true;
+    return *this;
+}
+
+IOCommunicator &IOCommunicator::initOffset(uint64_t _offset)
+{
+    if (offsetInitialized)
+        throw std::logic_error("can't initialize offset once more!");
+    offset = _offset;
+    offsetInitialized = true;
+    return *this;
+}
+
+IOCommunicator &IOCommunicator::initDisc(std::string discName)
+{
+    if (discInitialized)
+        throw std::logic_error("can't initialize disc once more!");
+    disc = open(discName.c_str(), O_RDWR);
+    if (disc < 0)
+        throw std::logic_error("can't open the disc " + discName);
+    discInitialized = true;
+    return *this;
+}
+
+void IOCommunicator::closeDisc()
+{
+    checkInitialized();
+    close(disc);
+    disc = -1;
+}
+
+unsigned int IOCommunicator::getSize()
+{
+    return size;
+}
+
+void IOCommunicator::setIndex(block_t _index)
+{
+    index = _index;
+}
+
+block_t IOCommunicator::getIndex()
+{
+    return index;
+}
+
+void IOCommunicator::checkInitialized() const
+{
+    if (!(sizeInitialized && offsetInitialized && discInitialized))
+        throw std::logic_error("unitialized state in communicator!");
+}
+
+void *IOCommunicator::getData() const
+{
+    return data;
+}
+
+void IOCommunicator::setData(void *_data)
+{
+    data = _data;
+}
+
+#endif
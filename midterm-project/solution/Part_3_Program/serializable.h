@@ -1,6 +1,10 @@
 #ifndef SERIALIZABLE_H
 #define SERIALIZABLE_H
 
+#include <stdint.h>
+
+/* number of a block or an i-node on the disc */
+typedef uint32_t block_t;
 
 /* serializable interface for read and write operations */
 class Serializable